@@ -0,0 +1,393 @@
+/**
+ * @bench.c
+ *
+ * @brief Benchmark
+ * @details Parser and responder throughput. Output: one JSON object per line
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "libGS232.h"
+#include "gs232_server.h"
+#include "gs232_binary.h"
+#include "gs232_gateway.h"
+
+#define BENCH_MIN_TIME         0.2 /*!< default minimum seconds per measure */
+#define BENCH_SERVER_PIPELINE  8   /*!< pipelined C2 commands per client and round */
+
+typedef struct bench_command_s {
+    const char *name;  /*!< command name */
+          char *input; /*!< command buffer */
+      uint32_t len;    /*!< command buffer length */
+} bench_command_t;
+
+static double min_time = BENCH_MIN_TIME;
+static volatile uint32_t sink;
+static bool server_stop;
+static uint64_t hardware_reads;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void report(const char *benchmark, const char *name, uint32_t payload, uint64_t iterations, uint64_t elapsed) {
+    double ns_op = (double) elapsed / iterations;
+
+    printf("{\"benchmark\":\"%s\",\"command\":\"%s\",\"payload_bytes\":%u,\"iterations\":%lu,\"ns_per_command\":%.2f,\"commands_per_sec\":%.0f}\n",
+            benchmark, name, payload, (unsigned long) iterations, ns_op, 1e9 / ns_op);
+    fflush(stdout);
+}
+
+// track upload: Wttt aaa eee ... (points = number of values)
+static bench_command_t track_command(const char *name, char type, uint32_t points) {
+    bench_command_t cmd;
+    uint32_t pos = 0;
+
+    cmd.name = name;
+    cmd.input = malloc(4 * points + 2);
+    cmd.input[pos++] = type;
+    for (uint32_t n = 0; n < points; n++)
+        pos += sprintf(cmd.input + pos, "%03u ", (type == 'W' && n > 0 && n % 2 == 0) ? (n * 7) % 181 : (n * 13) % 361);
+    cmd.input[pos - 1] = '\r';
+    cmd.len = pos;
+
+    return cmd;
+}
+
+static bench_command_t simple_command(const char *name, const char *input) {
+    bench_command_t cmd = { name, strdup(input), strlen(input) };
+    return cmd;
+}
+
+static void bench_parse(gs232_t *ctx, bench_command_t *cmd) {
+    uint64_t iterations = 1000, start, elapsed;
+
+    for (;;) {
+        start = now_ns();
+        for (uint64_t n = 0; n < iterations; n++)
+            sink += gs232_parse_command(&ctx, cmd->input, cmd->len);
+        elapsed = now_ns() - start;
+
+        if (elapsed >= min_time * 1e9)
+            break;
+
+        iterations *= 2;
+    }
+
+    report("parse", cmd->name, cmd->len, iterations, elapsed);
+}
+
+static void bench_return_string(gs232_t *ctx, bench_command_t *cmd) {
+    uint64_t iterations = 1000, start, elapsed;
+    uint8_t command = gs232_parse_command(&ctx, cmd->input, cmd->len);
+    char *ret_str;
+
+    for (;;) {
+        start = now_ns();
+        for (uint64_t n = 0; n < iterations; n++) {
+            gs232_return_string(ctx, command, &ret_str);
+            sink += ret_str[0];
+            gs232_return_string_free(ctx, ret_str);
+        }
+        elapsed = now_ns() - start;
+
+        if (elapsed >= min_time * 1e9)
+            break;
+
+        iterations *= 2;
+    }
+
+    report("return_string", cmd->name, cmd->len, iterations, elapsed);
+}
+
+static void bench_return_buffer(gs232_t *ctx, bench_command_t *cmd) {
+    uint64_t iterations = 1000, start, elapsed;
+    uint8_t command = gs232_parse_command(&ctx, cmd->input, cmd->len);
+    char buffer[GS232_RESPONSE_MAX];
+    const char *response;
+    uint32_t response_len;
+
+    for (;;) {
+        start = now_ns();
+        for (uint64_t n = 0; n < iterations; n++) {
+            gs232_return_buffer(ctx, command, buffer, sizeof(buffer), &response, &response_len);
+            sink += response_len;
+        }
+        elapsed = now_ns() - start;
+
+        if (elapsed >= min_time * 1e9)
+            break;
+
+        iterations *= 2;
+    }
+
+    report("return_buffer", cmd->name, cmd->len, iterations, elapsed);
+}
+
+// pipelined burst parsed and answered by gs232_stream_batch (ns per command)
+static void bench_stream_batch(gs232_t *ctx, const char *name, const char *input, uint32_t commands) {
+    uint64_t iterations = 100, start, elapsed;
+    uint32_t len = strlen(input), used, response_len;
+    char *response = malloc(commands * GS232_RESPONSE_MAX);
+
+    for (;;) {
+        start = now_ns();
+        for (uint64_t n = 0; n < iterations; n++) {
+            gs232_stream_batch(&ctx, input, len, &used, response, commands * GS232_RESPONSE_MAX, &response_len);
+            sink += response_len;
+        }
+        elapsed = now_ns() - start;
+
+        if (elapsed >= min_time * 1e9)
+            break;
+
+        iterations *= 2;
+    }
+
+    report("stream_batch", name, len, iterations * commands, elapsed);
+    free(response);
+}
+
+// binary frame of ASCII track upload (same values), parsed and answered by gs232_binary_batch
+static void bench_binary_batch(gs232_t *ctx, bench_command_t *cmd, uint8_t command) {
+    uint64_t iterations = 100, start, elapsed;
+    uint32_t qty = (cmd->len - 1) / 4, len = GS232_BINARY_HEADER + 2 * qty, used, response_len;
+    char *frame = malloc(len), response[GS232_BINARY_REPLY_MAX];
+
+    frame[0] = (char) GS232_BINARY_SYNC;
+    frame[1] = command;
+    frame[2] = qty & 0xff;
+    frame[3] = qty >> 8;
+    for (uint32_t n = 0; n < qty; n++) {
+        uint16_t value = atoi(cmd->input + 1 + 4 * n);
+
+        frame[GS232_BINARY_HEADER + 2 * n] = value & 0xff;
+        frame[GS232_BINARY_HEADER + 2 * n + 1] = value >> 8;
+    }
+
+    for (;;) {
+        start = now_ns();
+        for (uint64_t n = 0; n < iterations; n++) {
+            gs232_binary_batch(&ctx, frame, len, &used, response, sizeof(response), &response_len);
+            sink += response[1];
+        }
+        elapsed = now_ns() - start;
+
+        if (elapsed >= min_time * 1e9)
+            break;
+
+        iterations *= 2;
+    }
+
+    report("binary_batch", cmd->name, len, iterations, elapsed);
+    free(frame);
+}
+
+static uint16_t get_position(void) {
+    __atomic_fetch_add(&hardware_reads, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static void* server_thread(void *arg) {
+    gs232_server_t *server = arg;
+
+    while (!__atomic_load_n(&server_stop, __ATOMIC_ACQUIRE))
+        gs232_server_run(&server, 10);
+
+    return NULL;
+}
+
+// loopback: clients (socketpairs) pipeline C2 commands to the epoll server running on its own thread
+// gateway: all clients share one context, hardware reads are reported
+static void bench_server(uint32_t clients, bool gateway) {
+    const char request[] = "C2\rC2\rC2\rC2\rC2\rC2\rC2\rC2\r";
+    const uint32_t reply_len = BENCH_SERVER_PIPELINE * 14; // "AZ=000EL=000\r\n"
+    gs232_server_t *server = NULL;
+    gs232_connection_t *connection;
+    gs232_gateway_t shared;
+    gs232_t *ctx = NULL;
+    uint64_t rounds = 1, start, elapsed;
+    pthread_t thread;
+    int *fds = malloc(clients * sizeof(int));
+    char reply[BENCH_SERVER_PIPELINE * 14];
+    char name[32];
+    int sv[2];
+
+    if (gs232_server_init(&server, clients) != GS232_OK)
+        return;
+
+    if (gateway) {
+        if (gs232_init(&ctx) != GS232_OK || gs232_gateway_init(&shared, ctx, GS232_GATEWAY_SHARED, GS232_GATEWAY_WINDOW, GS232_GATEWAY_HOLD) != GS232_OK)
+            return;
+
+        ctx->b_protocol = true;
+        ctx->fn.get_azimuth = get_position;
+        ctx->fn.get_elevation = get_position;
+        gs232_server_gateway(&server, &shared);
+        hardware_reads = 0;
+    }
+
+    for (uint32_t c = 0; c < clients; c++) {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0 || gs232_server_add(&server, sv[1], &connection) != GS232_OK) {
+            fprintf(stderr, "bench_server: can't create %u clients\n", clients);
+            clients = c;
+            break;
+        }
+
+        connection->ctx->b_protocol = true;
+        fds[c] = sv[0];
+    }
+
+    server_stop = false;
+    pthread_create(&thread, NULL, server_thread, server);
+
+    for (;;) {
+        start = now_ns();
+        for (uint64_t r = 0; r < rounds; r++) {
+            for (uint32_t c = 0; c < clients; c++)
+                write(fds[c], request, sizeof(request) - 1);
+
+            for (uint32_t c = 0; c < clients; c++)
+                for (uint32_t got = 0; got < reply_len;) {
+                    ssize_t n = read(fds[c], reply + got, reply_len - got);
+                    if (n <= 0)
+                        break;
+                    got += n;
+                }
+        }
+        elapsed = now_ns() - start;
+
+        if (elapsed >= min_time * 1e9)
+            break;
+
+        rounds *= 2;
+    }
+
+    __atomic_store_n(&server_stop, true, __ATOMIC_RELEASE);
+    pthread_join(thread, NULL);
+
+    snprintf(name, sizeof(name), gateway ? "C2_gateway_clients_%u" : "C2_clients_%u", clients);
+    report("server_loopback", name, sizeof(request) - 1, rounds * clients * BENCH_SERVER_PIPELINE, elapsed);
+    if (gateway)
+        report("gateway_hardware_reads", name, 0, hardware_reads, elapsed);
+
+    for (uint32_t c = 0; c < clients; c++)
+        close(fds[c]);
+
+    gs232_server_deinit(&server);
+    if (gateway) {
+        gs232_gateway_deinit(&shared);
+        gs232_deinit(&ctx);
+    }
+    free(fds);
+}
+
+int main(int argc, char *const argv[]) {
+    gs232_t *ctx = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:")) != -1) {
+        switch (opt) {
+            case 't':
+                min_time = atof(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-t min_seconds_per_measure]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    bench_command_t commands[] = {
+            simple_command("R", "R\r"),
+            simple_command("U", "U\r"),
+            simple_command("L", "L\r"),
+            simple_command("D", "D\r"),
+            simple_command("A", "A\r"),
+            simple_command("E", "E\r"),
+            simple_command("C", "C\r"),
+            simple_command("C2", "C2\r"),
+            simple_command("M", "M123\r"),
+            simple_command("W", "W123 045\r"),
+            simple_command("N", "N\r"),
+            simple_command("T", "T\r"),
+            simple_command("X1", "X1\r"),
+            simple_command("X2", "X2\r"),
+            simple_command("X3", "X3\r"),
+            simple_command("X4", "X4\r"),
+            simple_command("O", "O\r"),
+            simple_command("O2", "O2\r"),
+            simple_command("F", "F\r"),
+            simple_command("F2", "F2\r"),
+            simple_command("B", "B\r"),
+            simple_command("S", "S\r"),
+            simple_command("H", "H\r"),
+            simple_command("H2", "H2\r"),
+            simple_command("H3", "H3\r"),
+            simple_command("P36", "P36\r"),
+            simple_command("P45", "P45\r"),
+            simple_command("Z", "Z\r"),
+            simple_command("unknown", "Q\r"),
+            track_command("M_timed_10", 'M', 11),
+            track_command("M_timed_100", 'M', 101),
+            track_command("M_timed_1000", 'M', 1001),
+            track_command("M_timed_3799", 'M', 3800),
+            track_command("W_timed_10", 'W', 21),
+            track_command("W_timed_100", 'W', 201),
+            track_command("W_timed_1899", 'W', 3799),
+    };
+
+    if (gs232_init(&ctx) != GS232_OK)
+        return 1;
+
+    ctx->b_protocol = true;
+
+    for (uint32_t n = 0; n < sizeof(commands) / sizeof(commands[0]); n++)
+        bench_parse(ctx, &commands[n]);
+
+    for (uint32_t n = 0; n < sizeof(commands) / sizeof(commands[0]); n++)
+        bench_return_string(ctx, &commands[n]);
+
+    for (uint32_t n = 0; n < sizeof(commands) / sizeof(commands[0]); n++)
+        bench_return_buffer(ctx, &commands[n]);
+
+    bench_stream_batch(ctx, "C2_x16", "C2\rC2\rC2\rC2\rC2\rC2\rC2\rC2\rC2\rC2\rC2\rC2\rC2\rC2\rC2\rC2\r", 16);
+    bench_stream_batch(ctx, "C2_M_C2", "C2\rM123\rC2\r", 3);
+
+    for (uint32_t n = 0; n < sizeof(commands) / sizeof(commands[0]); n++)
+        if (strncmp(commands[n].name, "W_timed", 7) == 0)
+            bench_binary_batch(ctx, &commands[n], GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH_AND_ELEVATION);
+
+    bench_server(1, false);
+    bench_server(10, false);
+    bench_server(100, false);
+    bench_server(400, false);
+
+    bench_server(1, true);
+    bench_server(10, true);
+    bench_server(100, true);
+    bench_server(400, true);
+
+    for (uint32_t n = 0; n < sizeof(commands) / sizeof(commands[0]); n++)
+        free(commands[n].input);
+
+    gs232_deinit(&ctx);
+
+    return 0;
+}
@@ -0,0 +1,254 @@
+/**
+ * @gs232_actuator.c
+ *
+ * @brief Asynchronous actuation for libGS232
+ * @details Records ring drained by a worker thread calling the hardware functions. Producers (parser and track tick threads)
+ *          are serialized by a mutex, the worker reads the ring without locking (acquire/release head and tail)
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "libGS232.h"
+#include "gs232_trace.h"
+#include "gs232_position.h"
+#include "gs232_planner.h"
+#include "gs232_actuator.h"
+#include "gs232_metrics.h"
+
+#define GS232_ACTUATOR_MASK (GS232_ACTUATOR_QUEUE - 1)
+
+static void gs232_actuator_hardware(gs232_actuator_t *actuator, const gs232_actuator_record_t *record) {
+    gs232_t *ctx = actuator->ctx;
+    uint16_t azimuth = record->azimuth, elevation = record->elevation;
+
+    switch (record->command) {
+        case GS232_OFFSET_CALIBRATION_AZIMUTH:
+            if (ctx->fn.offset_calibration_azimuth != NULL)
+                ctx->fn.offset_calibration_azimuth(&actuator->ctx);
+            return;
+
+        case GS232_OFFSET_CALIBRATION_ELEVATION:
+            if (ctx->fn.offset_calibration_elevation != NULL)
+                ctx->fn.offset_calibration_elevation(&actuator->ctx);
+            return;
+
+        case GS232_FULL_SCALE_CALIBRATION_AZIMUTH:
+            if (ctx->fn.full_scale_calibration_azimuth != NULL)
+                ctx->fn.full_scale_calibration_azimuth(&actuator->ctx);
+            return;
+
+        case GS232_FULL_SCALE_CALIBRATION_ELEVATION:
+            if (ctx->fn.full_scale_calibration_elevation != NULL)
+                ctx->fn.full_scale_calibration_elevation(&actuator->ctx);
+            return;
+    }
+
+    if (record->axes & GS232_ACTUATOR_HOLD) {
+        gs232_position_get(ctx, &azimuth, &elevation);
+        if (ctx->fn.get_azimuth != NULL)
+            azimuth = ctx->fn.get_azimuth();
+        if (ctx->fn.get_elevation != NULL)
+            elevation = ctx->fn.get_elevation();
+    }
+
+    if ((record->axes & GS232_ACTUATOR_AZIMUTH) && ctx->fn.set_azimuth != NULL) {
+        if (record->axes & GS232_ACTUATOR_ROUTE)
+            azimuth = gs232_planner_target(ctx, azimuth);
+        ctx->fn.set_azimuth(azimuth);
+    }
+
+    if ((record->axes & GS232_ACTUATOR_ELEVATION) && ctx->fn.set_elevation != NULL)
+        ctx->fn.set_elevation(elevation);
+}
+
+static void gs232_actuator_apply(gs232_actuator_t *actuator, const gs232_actuator_record_t *record) {
+    uint64_t start = GS232_METRIC_BEGIN(actuator->ctx, GS232_METRICS_HOOK);
+
+    gs232_actuator_hardware(actuator, record);
+    GS232_METRIC(gs232_metrics_end(actuator->ctx, GS232_METRICS_HOOK, start));
+}
+
+static void* gs232_actuator_worker(void *arg) {
+    gs232_actuator_t *actuator = arg;
+    gs232_actuator_record_t batch[GS232_ACTUATOR_QUEUE];
+    uint8_t later[GS232_ACTUATOR_QUEUE]; // axes targeted by later records of batch
+    uint32_t head, epoch, n;
+    uint8_t axes;
+
+    for (;;) {
+        head = __atomic_load_n(&actuator->head, __ATOMIC_ACQUIRE);
+        n = head - actuator->tail;
+        for (uint32_t i = 0; i < n; i++)
+            batch[i] = actuator->records[(actuator->tail + i) & GS232_ACTUATOR_MASK];
+        __atomic_store_n(&actuator->tail, head, __ATOMIC_RELEASE);
+
+        // loaded after the records: no record of batch is newer than epoch
+        epoch = __atomic_load_n(&actuator->stop_epoch, __ATOMIC_ACQUIRE);
+        if (epoch != actuator->applied_epoch) {
+            gs232_actuator_record_t stop = { GS232_ALL_STOP, GS232_ACTUATOR_AZIMUTH | GS232_ACTUATOR_ELEVATION | GS232_ACTUATOR_HOLD, 0, 0, epoch };
+
+            gs232_actuator_apply(actuator, &stop);
+            actuator->applied_epoch = epoch;
+        }
+
+        if (n == 0) {
+            if (!__atomic_load_n(&actuator->running, __ATOMIC_ACQUIRE))
+                break;
+
+            sem_wait(&actuator->wake);
+            continue;
+        }
+
+        // coalesce: a target is dropped when later records target all of its axes
+        axes = 0;
+        for (uint32_t i = n; i-- > 0;) {
+            later[i] = axes;
+            axes |= batch[i].axes & (GS232_ACTUATOR_AZIMUTH | GS232_ACTUATOR_ELEVATION);
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            uint8_t record_axes = batch[i].axes & (GS232_ACTUATOR_AZIMUTH | GS232_ACTUATOR_ELEVATION);
+
+            // submitted before a stop (or a stop arrived while applying)
+            if (batch[i].epoch != epoch || __atomic_load_n(&actuator->stop_epoch, __ATOMIC_ACQUIRE) != epoch
+                    || (record_axes != 0 && (later[i] & record_axes) == record_axes)) {
+                __atomic_fetch_add(&actuator->skipped, 1, __ATOMIC_RELAXED);
+                continue;
+            }
+
+            gs232_actuator_apply(actuator, &batch[i]);
+            __atomic_fetch_add(&actuator->applied, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    return NULL;
+}
+
+uint8_t gs232_actuator_init(gs232_actuator_t *actuator, gs232_t *ctx) {
+    memset(actuator, 0, sizeof(gs232_actuator_t));
+    actuator->ctx = ctx;
+    actuator->running = true;
+
+    if (sem_init(&actuator->wake, 0, 0) != 0)
+        return GS232_FAIL;
+
+    pthread_mutex_init(&actuator->lock, NULL);
+
+    if (pthread_create(&actuator->thread, NULL, gs232_actuator_worker, actuator) != 0) {
+        pthread_mutex_destroy(&actuator->lock);
+        sem_destroy(&actuator->wake);
+        return GS232_FAIL;
+    }
+
+    ctx->actuator = actuator;
+    return GS232_OK;
+}
+
+uint8_t gs232_actuator_deinit(gs232_actuator_t *actuator) {
+    actuator->ctx->actuator = NULL;
+
+    __atomic_store_n(&actuator->running, false, __ATOMIC_RELEASE);
+    sem_post(&actuator->wake);
+    pthread_join(actuator->thread, NULL);
+    pthread_mutex_destroy(&actuator->lock);
+    sem_destroy(&actuator->wake);
+
+    return GS232_OK;
+}
+
+uint8_t gs232_actuator_submit(gs232_actuator_t *actuator, uint8_t command, uint8_t axes, uint16_t azimuth, uint16_t elevation) {
+    gs232_actuator_record_t *record;
+    uint32_t head;
+
+    // parser and track tick may run on different threads: one writer of head at a time
+    pthread_mutex_lock(&actuator->lock);
+    head = actuator->head;
+
+    if (head - __atomic_load_n(&actuator->tail, __ATOMIC_ACQUIRE) >= GS232_ACTUATOR_QUEUE) {
+        pthread_mutex_unlock(&actuator->lock);
+        GS232_TRACE(GS232_TRACE_ERROR, GS232_TRACE_EVENT_ACTUATOR_FULL, actuator->ctx, command, axes);
+        return GS232_BUFFERTOOSMALL;
+    }
+
+    record = &actuator->records[head & GS232_ACTUATOR_MASK];
+    record->command = command;
+    record->axes = axes;
+    record->azimuth = azimuth;
+    record->elevation = elevation;
+    record->epoch = __atomic_load_n(&actuator->stop_epoch, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&actuator->head, head + 1, __ATOMIC_RELEASE);
+    actuator->submitted++;
+    pthread_mutex_unlock(&actuator->lock);
+    sem_post(&actuator->wake);
+
+    return GS232_OK;
+}
+
+uint8_t gs232_actuator_stop(gs232_actuator_t *actuator) {
+    __atomic_fetch_add(&actuator->stop_epoch, 1, __ATOMIC_RELEASE);
+    sem_post(&actuator->wake);
+
+    return GS232_OK;
+}
+
+uint8_t gs232_actuator_command(gs232_t **ctx, uint8_t command) {
+    gs232_actuator_t *actuator = (*ctx)->actuator;
+
+    if (actuator == NULL)
+        return GS232_OK;
+
+    switch (command) {
+        case GS232_CLOCKWISE_ROTATION: // R
+            return gs232_actuator_submit(actuator, command, GS232_ACTUATOR_AZIMUTH,
+                    gs232_planner_value(*ctx, __atomic_load_n(&(*ctx)->is_450_degrees, __ATOMIC_RELAXED) ? 450 : 360), 0);
+
+        case GS232_COUNTER_CLOCKWISE_ROTATION: // L
+            return gs232_actuator_submit(actuator, command, GS232_ACTUATOR_AZIMUTH, gs232_planner_value(*ctx, 0), 0);
+
+        case GS232_UP_DIRECTION_ROTATION: // U
+            return gs232_actuator_submit(actuator, command, GS232_ACTUATOR_ELEVATION, 0, 180);
+
+        case GS232_DOWN_DIRECTION_ROTATION: // D
+            return gs232_actuator_submit(actuator, command, GS232_ACTUATOR_ELEVATION, 0, 0);
+
+        case GS232_CW_CCW_ROTATION_STOP: // A
+            return gs232_actuator_submit(actuator, command, GS232_ACTUATOR_AZIMUTH | GS232_ACTUATOR_HOLD, 0, 0);
+
+        case GS232_UP_DOWN_DIRECTION_ROTATION_STOP: // E
+            return gs232_actuator_submit(actuator, command, GS232_ACTUATOR_ELEVATION | GS232_ACTUATOR_HOLD, 0, 0);
+
+        case GS232_ALL_STOP: // S
+            return gs232_actuator_stop(actuator);
+
+        case GS232_TURN_DEGREES_AZIMUTH: // Maaa
+            return gs232_actuator_submit(actuator, command, GS232_ACTUATOR_AZIMUTH | GS232_ACTUATOR_ROUTE, (*ctx)->memory[0], 0);
+
+        case GS232_TURN_DEGREES_AZIMUTH_AND_ELEVATION: // Waaa eee
+            // Waaa: no elevation value (memory[1] is stale)
+            if ((*ctx)->memory_qty < 2)
+                return gs232_actuator_submit(actuator, command, GS232_ACTUATOR_AZIMUTH | GS232_ACTUATOR_ROUTE, (*ctx)->memory[0], 0);
+
+            return gs232_actuator_submit(actuator, command, GS232_ACTUATOR_AZIMUTH | GS232_ACTUATOR_ELEVATION | GS232_ACTUATOR_ROUTE,
+                    (*ctx)->memory[0], (*ctx)->memory[1]);
+
+        case GS232_OFFSET_CALIBRATION_AZIMUTH:       // O
+        case GS232_OFFSET_CALIBRATION_ELEVATION:     // O2
+        case GS232_FULL_SCALE_CALIBRATION_AZIMUTH:   // F
+        case GS232_FULL_SCALE_CALIBRATION_ELEVATION: // F2
+            return gs232_actuator_submit(actuator, command, 0, 0, 0);
+    }
+
+    return GS232_OK;
+}
@@ -0,0 +1,130 @@
+/**
+ * @gs232_actuator.h
+ *
+ * @brief Asynchronous actuation for libGS232
+ * @details Motion commands (R/L/U/D/A/E/S/M/W/O/F) and timed track points are queued on a ring and applied to the hardware
+ *          functions by a worker thread, so slow drivers never stall parsing. Targets superseded by later ones on the same
+ *          axis are dropped, S (all stop) preempts every pending record.
+ *          Producers are the thread calling gs232_parse_command and the thread calling gs232_track_tick (may be another one):
+ *          they are serialized by a producer lock, the worker reads the ring without locking.
+ *
+ *          Hardware functions are only set_azimuth/set_elevation, so motion commands are applied as targets:
+ *          R/L to the azimuth limits, U/D to the elevation limits, A/E/S to the current position (get_azimuth/get_elevation).
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#ifndef GS232_ACTUATOR_H_
+#define GS232_ACTUATOR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "libGS232.h"
+
+#define GS232_ACTUATOR_QUEUE 64 /*!< queued records (power of 2) */
+
+/**
+ * @enum GS232_ACTUATOR_AXES
+ * @brief Record axes
+ *
+ */
+enum GS232_ACTUATOR_AXES {
+    GS232_ACTUATOR_AZIMUTH   = 0x01, /*!< azimuth target */
+    GS232_ACTUATOR_ELEVATION = 0x02, /*!< elevation target */
+    GS232_ACTUATOR_HOLD      = 0x04, /*!< target is current position (stop) */
+    GS232_ACTUATOR_ROUTE     = 0x08, /*!< azimuth is a direction routed by gs232_planner when applied */
+};
+
+/**
+ * @typedef gs232_actuator_record_t
+ * @brief Actuation record
+ *
+ */
+typedef struct gs232_actuator_record_s {
+     uint8_t command;   /*!< GS232_COMMAND */
+     uint8_t axes;      /*!< GS232_ACTUATOR_AXES (0: calibration) */
+    uint16_t azimuth;   /*!< azimuth target */
+    uint16_t elevation; /*!< elevation target */
+    uint32_t epoch;     /*!< stop epoch at submit */
+} gs232_actuator_record_t; /*!< actuation record */
+
+/**
+ * @typedef gs232_actuator_t
+ * @brief Actuator: records ring and worker thread
+ *
+ */
+typedef struct gs232_actuator_s {
+                    gs232_t *ctx;                             /*!< context */
+    gs232_actuator_record_t records[GS232_ACTUATOR_QUEUE];    /*!< ring */
+                   uint32_t head __attribute__((aligned(64))); /*!< next record to write (producers, lock) */
+                   uint32_t stop_epoch;                       /*!< incremented by S (producer) */
+                   uint32_t submitted;                        /*!< records queued (producers, lock) */
+            pthread_mutex_t lock;                             /*!< producers lock */
+                   uint32_t tail __attribute__((aligned(64))); /*!< next record to read (worker) */
+                   uint32_t applied_epoch;                    /*!< last stop applied (worker) */
+                   uint32_t applied;                          /*!< records applied */
+                   uint32_t skipped;                          /*!< records superseded or preempted */
+                       bool running;                          /*!< worker running */
+                      sem_t wake;                             /*!< worker wake up */
+                  pthread_t thread;                           /*!< worker */
+} gs232_actuator_t; /*!< actuator */
+
+/**
+ * @fn uint8_t gs232_actuator_init(gs232_actuator_t *actuator, gs232_t *ctx)
+ * @brief Start actuator worker and attach it to context (parsed commands and track points are queued)
+ *
+ * @param actuator Actuator
+ * @param ctx Context
+ * @return GS232_ERROR
+ */
+uint8_t gs232_actuator_init(gs232_actuator_t *actuator, gs232_t *ctx);
+
+/**
+ * @fn uint8_t gs232_actuator_deinit(gs232_actuator_t *actuator)
+ * @brief Apply pending records, stop worker and detach actuator from context
+ *
+ * @param actuator Actuator
+ * @return GS232_ERROR
+ */
+uint8_t gs232_actuator_deinit(gs232_actuator_t *actuator);
+
+/**
+ * @fn uint8_t gs232_actuator_submit(gs232_actuator_t *actuator, uint8_t command, uint8_t axes, uint16_t azimuth, uint16_t elevation)
+ * @brief Queue record
+ *
+ * @param actuator Actuator
+ * @param command Command
+ * @param axes GS232_ACTUATOR_AXES
+ * @param azimuth Azimuth target
+ * @param elevation Elevation target
+ * @return GS232_ERROR (GS232_BUFFERTOOSMALL: queue full)
+ */
+uint8_t gs232_actuator_submit(gs232_actuator_t *actuator, uint8_t command, uint8_t axes, uint16_t azimuth, uint16_t elevation);
+
+/**
+ * @fn uint8_t gs232_actuator_stop(gs232_actuator_t *actuator)
+ * @brief All stop: drop pending records and hold current position. Never blocked by a full queue
+ *
+ * @param actuator Actuator
+ * @return GS232_ERROR
+ */
+uint8_t gs232_actuator_stop(gs232_actuator_t *actuator);
+
+/**
+ * @fn uint8_t gs232_actuator_command(gs232_t **ctx, uint8_t command)
+ * @brief Queue parsed motion command on context actuator (other commands are ignored)
+ *
+ * @param ctx Context
+ * @param command Parsed command
+ * @return GS232_ERROR
+ */
+uint8_t gs232_actuator_command(gs232_t **ctx, uint8_t command);
+
+#endif /* GS232_ACTUATOR_H_ */
@@ -0,0 +1,173 @@
+/**
+ * @gs232_alloc.c
+ *
+ * @brief Allocators for libGS232
+ * @details Global allocator, fixed size blocks pool and bump arena
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "libGS232.h"
+#include "gs232_alloc.h"
+
+#define ALIGNMENT 16 /*!< allocations alignment */
+#define ALIGN(size) (((size) + ALIGNMENT - 1) & ~((size_t) ALIGNMENT - 1))
+
+static void* gs232_malloc(void *arg, size_t size) {
+    return malloc(size);
+}
+
+static void gs232_malloc_free(void *arg, void *ptr, size_t size) {
+    free(ptr);
+}
+
+static gs232_allocator_t global_allocator = { gs232_malloc, gs232_malloc_free, NULL };
+
+void gs232_set_allocator(const gs232_allocator_t *allocator) {
+    if (allocator == NULL) {
+        global_allocator.alloc = gs232_malloc;
+        global_allocator.free = gs232_malloc_free;
+        global_allocator.arg = NULL;
+    } else
+        global_allocator = *allocator;
+}
+
+void* gs232_alloc(const gs232_allocator_t *allocator, size_t size) {
+    if (allocator == NULL)
+        allocator = &global_allocator;
+
+    return allocator->alloc(allocator->arg, size);
+}
+
+void gs232_free(const gs232_allocator_t *allocator, void *ptr, size_t size) {
+    if (ptr == NULL)
+        return;
+
+    if (allocator == NULL)
+        allocator = &global_allocator;
+
+    allocator->free(allocator->arg, ptr, size);
+}
+
+/////////////////// pool ///////////////////
+
+static bool gs232_pool_owns(gs232_pool_t *pool, void *ptr) {
+    return (uint8_t*) ptr >= pool->memory && (uint8_t*) ptr < pool->memory + pool->memory_size;
+}
+
+static void* gs232_pool_alloc(void *arg, size_t size) {
+    gs232_pool_t *pool = arg;
+    void *block = NULL;
+
+    if (size <= pool->block_size) {
+        pthread_mutex_lock(&pool->lock);
+        if ((block = pool->free_list) != NULL)
+            pool->free_list = *(void**) block;
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    if (block == NULL && pool->fallback != NULL)
+        block = gs232_alloc(pool->fallback, size);
+
+    return block;
+}
+
+static void gs232_pool_free(void *arg, void *ptr, size_t size) {
+    gs232_pool_t *pool = arg;
+
+    if (!gs232_pool_owns(pool, ptr)) {
+        if (pool->fallback != NULL)
+            gs232_free(pool->fallback, ptr, size);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    *(void**) ptr = pool->free_list;
+    pool->free_list = ptr;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+uint8_t gs232_pool_init(gs232_pool_t *pool, void *memory, size_t memory_size, size_t block_size, const gs232_allocator_t *fallback,
+        gs232_allocator_t *allocator) {
+    uint8_t *aligned = (uint8_t*) ALIGN((uintptr_t) memory);
+
+    if (pool == NULL || memory == NULL || allocator == NULL || block_size == 0)
+        return GS232_FAIL;
+
+    block_size = ALIGN(block_size);
+    if (memory_size < (size_t) (aligned - (uint8_t*) memory) + block_size)
+        return GS232_FAIL;
+
+    pool->memory = aligned;
+    pool->memory_size = memory_size - (aligned - (uint8_t*) memory);
+    pool->block_size = block_size;
+    pool->free_list = NULL;
+    pool->fallback = fallback;
+    pthread_mutex_init(&pool->lock, NULL);
+
+    // free list in address order
+    for (size_t n = pool->memory_size / block_size; n > 0; n--) {
+        void *block = pool->memory + (n - 1) * block_size;
+        *(void**) block = pool->free_list;
+        pool->free_list = block;
+    }
+
+    allocator->alloc = gs232_pool_alloc;
+    allocator->free = gs232_pool_free;
+    allocator->arg = pool;
+
+    return GS232_OK;
+}
+
+/////////////////// arena ///////////////////
+
+static void* gs232_arena_alloc(void *arg, size_t size) {
+    gs232_arena_t *arena = arg;
+    size_t used = __atomic_fetch_add(&arena->used, ALIGN(size), __ATOMIC_RELAXED);
+
+    if (used + ALIGN(size) <= arena->size)
+        return arena->memory + used;
+
+    return arena->fallback != NULL ? gs232_alloc(arena->fallback, size) : NULL;
+}
+
+static void gs232_arena_free(void *arg, void *ptr, size_t size) {
+    gs232_arena_t *arena = arg;
+
+    if ((uint8_t*) ptr >= arena->memory && (uint8_t*) ptr < arena->memory + arena->size)
+        return;
+
+    if (arena->fallback != NULL)
+        gs232_free(arena->fallback, ptr, size);
+}
+
+uint8_t gs232_arena_init(gs232_arena_t *arena, void *memory, size_t size, const gs232_allocator_t *fallback, gs232_allocator_t *allocator) {
+    uint8_t *aligned = (uint8_t*) ALIGN((uintptr_t) memory);
+
+    if (arena == NULL || memory == NULL || allocator == NULL || size < (size_t) (aligned - (uint8_t*) memory))
+        return GS232_FAIL;
+
+    arena->memory = aligned;
+    arena->size = size - (aligned - (uint8_t*) memory);
+    arena->used = 0;
+    arena->fallback = fallback;
+
+    allocator->alloc = gs232_arena_alloc;
+    allocator->free = gs232_arena_free;
+    allocator->arg = arena;
+
+    return GS232_OK;
+}
+
+void gs232_arena_reset(gs232_arena_t *arena) {
+    __atomic_store_n(&arena->used, 0, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,125 @@
+/**
+ * @gs232_alloc.h
+ *
+ * @brief Allocators for libGS232
+ * @details Every library allocation goes through an allocator: the global one (default malloc/free) or the one of the context.
+ *          Fixed size block pool and bump arena implementations work on caller memory, so after startup a session
+ *          can run without general purpose heap calls.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#ifndef GS232_ALLOC_H_
+#define GS232_ALLOC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/**
+ * @typedef gs232_allocator_t
+ * @brief Allocator
+ *
+ */
+typedef struct gs232_allocator_s {
+    void* (*alloc)(void *arg, size_t size);          /*!< allocate (NULL on error) */
+     void (*free)(void *arg, void *ptr, size_t size); /*!< free (size: allocated size) */
+    void *arg;                                       /*!< user argument */
+} gs232_allocator_t; /*!< allocator */
+
+/**
+ * @typedef gs232_pool_t
+ * @brief Fixed size blocks pool on caller memory
+ *
+ */
+typedef struct gs232_pool_s {
+                    uint8_t *memory;     /*!< blocks memory */
+                     size_t memory_size; /*!< blocks memory size */
+                     size_t block_size;  /*!< block size */
+                       void *free_list;  /*!< free blocks */
+            pthread_mutex_t lock;        /*!< lock */
+    const gs232_allocator_t *fallback;   /*!< for bigger sizes or exhausted pool (NULL: fail) */
+} gs232_pool_t; /*!< pool */
+
+/**
+ * @typedef gs232_arena_t
+ * @brief Bump arena on caller memory. Free is a no-op, memory is recovered with gs232_arena_reset
+ *
+ */
+typedef struct gs232_arena_s {
+                    uint8_t *memory;   /*!< arena memory */
+                     size_t size;      /*!< arena memory size */
+                     size_t used;      /*!< used memory */
+    const gs232_allocator_t *fallback; /*!< for exhausted arena (NULL: fail) */
+} gs232_arena_t; /*!< arena */
+
+/**
+ * @fn void gs232_set_allocator(const gs232_allocator_t *allocator)
+ * @brief Set global allocator (NULL: malloc/free). Set it before creating contexts
+ *
+ * @param allocator Allocator
+ */
+void gs232_set_allocator(const gs232_allocator_t *allocator);
+
+/**
+ * @fn void* gs232_alloc(const gs232_allocator_t *allocator, size_t size)
+ * @brief Allocate
+ *
+ * @param allocator Allocator (NULL: global)
+ * @param size Size
+ * @return Memory, NULL on error
+ */
+void* gs232_alloc(const gs232_allocator_t *allocator, size_t size);
+
+/**
+ * @fn void gs232_free(const gs232_allocator_t *allocator, void *ptr, size_t size)
+ * @brief Free
+ *
+ * @param allocator Allocator (NULL: global)
+ * @param ptr Memory
+ * @param size Allocated size
+ */
+void gs232_free(const gs232_allocator_t *allocator, void *ptr, size_t size);
+
+/**
+ * @fn uint8_t gs232_pool_init(gs232_pool_t *pool, void *memory, size_t memory_size, size_t block_size, const gs232_allocator_t *fallback,
+        gs232_allocator_t *allocator)
+ * @brief Initialize fixed size blocks pool
+ *
+ * @param pool Pool
+ * @param memory Blocks memory
+ * @param memory_size Blocks memory size
+ * @param block_size Block size
+ * @param fallback Allocator for bigger sizes or exhausted pool (NULL: fail)
+ * @param allocator Pool allocator
+ * @return GS232_ERROR
+ */
+uint8_t gs232_pool_init(gs232_pool_t *pool, void *memory, size_t memory_size, size_t block_size, const gs232_allocator_t *fallback,
+        gs232_allocator_t *allocator);
+
+/**
+ * @fn uint8_t gs232_arena_init(gs232_arena_t *arena, void *memory, size_t size, const gs232_allocator_t *fallback, gs232_allocator_t *allocator)
+ * @brief Initialize bump arena
+ *
+ * @param arena Arena
+ * @param memory Arena memory
+ * @param size Arena memory size
+ * @param fallback Allocator for exhausted arena (NULL: fail)
+ * @param allocator Arena allocator
+ * @return GS232_ERROR
+ */
+uint8_t gs232_arena_init(gs232_arena_t *arena, void *memory, size_t size, const gs232_allocator_t *fallback, gs232_allocator_t *allocator);
+
+/**
+ * @fn void gs232_arena_reset(gs232_arena_t *arena)
+ * @brief Release all arena allocations
+ *
+ * @param arena Arena
+ */
+void gs232_arena_reset(gs232_arena_t *arena);
+
+#endif /* GS232_ALLOC_H_ */
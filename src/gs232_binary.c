@@ -0,0 +1,217 @@
+/**
+ * @gs232_binary.c
+ *
+ * @brief Binary protocol for libGS232
+ * @details Length prefixed frames of GS232_COMMAND with packed values and fixed size position replies
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "libGS232.h"
+#include "gs232_alloc.h"
+#include "gs232_trace.h"
+#include "gs232_track.h"
+#include "gs232_position.h"
+#include "gs232_binary.h"
+#include "gs232_metrics.h"
+#include "gs232_capture.h"
+
+static inline uint16_t gs232_binary_u16(const char *p) {
+    return (uint8_t) p[0] | (uint16_t) (uint8_t) p[1] << 8;
+}
+
+static inline void gs232_binary_put_u16(char *p, uint16_t value) {
+    p[0] = value & 0xff;
+    p[1] = value >> 8;
+}
+
+bool gs232_binary_detect(gs232_t **ctx, const char *data, uint32_t data_len) {
+    if ((*ctx)->stream.protocol == GS232_PROTOCOL_DETECT && data_len > 0)
+        (*ctx)->stream.protocol = (uint8_t) data[0] == GS232_BINARY_SYNC ? GS232_PROTOCOL_BINARY : GS232_PROTOCOL_ASCII;
+
+    return (*ctx)->stream.protocol == GS232_PROTOCOL_BINARY;
+}
+
+static uint8_t gs232_binary_response(gs232_t *ctx, uint8_t command, char *buffer, uint32_t buffer_size, uint32_t *len) {
+    uint16_t a = 0, b = 0;
+    bool record = true;
+
+    if (buffer_size < GS232_BINARY_REPLY_MAX)
+        return GS232_BUFFERTOOSMALL;
+
+    buffer[0] = (char) GS232_BINARY_SYNC;
+    buffer[1] = command;
+    *len = GS232_BINARY_HEADER;
+
+    switch (command) {
+        case GS232_RETURN_CURRENT_AZIMUTH:
+        case GS232_RETURN_AZIMUTH_AND_ELEVATION:
+        case GS232_RETURN_CURRENT_ELEVATION:
+            if (ctx->fn.get_azimuth != NULL || ctx->fn.get_elevation != NULL)
+                gs232_position_sample(&ctx, gs232_now(), command != GS232_RETURN_CURRENT_ELEVATION, command != GS232_RETURN_CURRENT_AZIMUTH);
+            gs232_position_get(ctx, &a, &b);
+            break;
+
+        case GS232_TOTAL_NUMBER_OF_SETTING_ANGLES:
+            a = __atomic_load_n(&ctx->memory_current_point, __ATOMIC_RELAXED);
+            b = gs232_track_points(ctx);
+            break;
+
+        default:
+            record = false;
+            break;
+    }
+
+    if (!record) {
+        gs232_binary_put_u16(buffer + 2, 0);
+    } else {
+        gs232_binary_put_u16(buffer + 2, 4);
+        gs232_binary_put_u16(buffer + 4, a);
+        gs232_binary_put_u16(buffer + 6, b);
+        *len += 4;
+    }
+
+    GS232_TRACE(GS232_TRACE_DEBUG, GS232_TRACE_EVENT_RESPONSE, ctx, command, *len);
+    return GS232_OK;
+}
+
+uint8_t gs232_binary_reply(gs232_t *ctx, uint8_t command, char *buffer, uint32_t buffer_size, uint32_t *len) {
+    uint64_t start = GS232_METRIC_BEGIN(ctx, GS232_METRICS_RESPOND);
+    uint8_t res = gs232_binary_response(ctx, command, buffer, buffer_size, len);
+
+    GS232_METRIC(gs232_metrics_end(ctx, GS232_METRICS_RESPOND, start));
+    if (res == GS232_OK)
+        GS232_METRIC(gs232_metrics_response(ctx, *len));
+    if (res == GS232_OK && ctx->capture.log != NULL)
+        gs232_capture_record(ctx, GS232_CAPTURE_OUT, buffer, *len);
+    return res;
+}
+
+/*
+ * Framing: returns GS232_OK when a complete frame is available, GS232_FAIL when more data is needed
+ * and GS232_TOOMANYVALUES when an overlong frame was dropped. Frames complete on a single chunk are not copied.
+ */
+static uint8_t gs232_binary_next(gs232_stream_t *stream, const gs232_allocator_t *allocator, const char *data, uint32_t data_len, uint32_t *used,
+        const char **frame) {
+    uint32_t pos = 0, need, chunk;
+
+    // dropping values of overlong frame (len: bytes left)
+    if (stream->discard) {
+        chunk = data_len < stream->len ? data_len : stream->len;
+        stream->len -= chunk;
+        *used = chunk;
+        if (stream->len != 0)
+            return GS232_FAIL;
+
+        stream->discard = false;
+        return GS232_TOOMANYVALUES;
+    }
+
+    // resynchronize
+    if (stream->len == 0) {
+        while (pos < data_len && (uint8_t) data[pos] != GS232_BINARY_SYNC)
+            ++pos;
+
+        if (pos + GS232_BINARY_HEADER <= data_len) {
+            uint16_t qty = gs232_binary_u16(data + pos + 2);
+
+            if (qty > MEMORY_POINTS) {
+                GS232_TRACE(GS232_TRACE_ERROR, GS232_TRACE_EVENT_STREAM_OVERFLOW, stream, qty, 0);
+                stream->discard = true;
+                stream->len = 2 * qty;
+                *used = pos + GS232_BINARY_HEADER;
+                return GS232_FAIL;
+            }
+
+            if (pos + GS232_BINARY_HEADER + 2 * qty <= data_len) {
+                *frame = data + pos;
+                *used = pos + GS232_BINARY_HEADER + 2 * qty;
+                return GS232_OK;
+            }
+        }
+    }
+
+    if (stream->buffer == NULL && (stream->buffer = gs232_alloc(allocator, GS232_FRAME_MAX)) == NULL) {
+        *used = data_len;
+        return GS232_FAIL;
+    }
+
+    // partial frame: header, then values
+    need = stream->len < GS232_BINARY_HEADER ? GS232_BINARY_HEADER : GS232_BINARY_HEADER + 2 * gs232_binary_u16(stream->buffer + 2);
+    chunk = data_len - pos < need - stream->len ? data_len - pos : need - stream->len;
+    memcpy(stream->buffer + stream->len, data + pos, chunk);
+    stream->len += chunk;
+    *used = pos + chunk;
+
+    if (stream->len < GS232_BINARY_HEADER)
+        return GS232_FAIL;
+
+    if (stream->len == GS232_BINARY_HEADER) {
+        uint16_t qty = gs232_binary_u16(stream->buffer + 2);
+
+        if (qty > MEMORY_POINTS) {
+            GS232_TRACE(GS232_TRACE_ERROR, GS232_TRACE_EVENT_STREAM_OVERFLOW, stream, qty, 0);
+            stream->discard = true;
+            stream->len = 2 * qty;
+            return GS232_FAIL;
+        }
+
+        if (qty != 0)
+            return GS232_FAIL;
+    } else if (stream->len < need) {
+        return GS232_FAIL;
+    }
+
+    *frame = stream->buffer;
+    stream->len = 0;
+
+    return GS232_OK;
+}
+
+uint8_t gs232_binary_batch(gs232_t **ctx, const char *data, uint32_t data_len, uint32_t *data_used, char *response, uint32_t response_size,
+        uint32_t *response_len) {
+    const char *frame;
+    uint32_t used, reply_len;
+    uint8_t res, command;
+
+    *data_used = 0;
+    *response_len = 0;
+
+    if (data == NULL || response == NULL)
+        return GS232_FAIL;
+
+    while (*data_used < data_len) {
+        if (response_size - *response_len < GS232_BINARY_REPLY_MAX)
+            return GS232_BUFFERTOOSMALL;
+
+        res = gs232_binary_next(&(*ctx)->stream, (*ctx)->allocator, data + *data_used, data_len - *data_used, &used, &frame);
+        *data_used += used;
+
+        if (res == GS232_FAIL)
+            continue;
+
+        if (res == GS232_OK)
+            command = gs232_parse_binary(ctx, (uint8_t) frame[1], (const uint8_t*) frame + GS232_BINARY_HEADER, gs232_binary_u16(frame + 2));
+        else {
+            command = GS232_TOOMANYVALUES;
+            GS232_METRIC(gs232_metrics_command(*ctx, command, 0));
+            if ((*ctx)->capture.log != NULL)
+                gs232_capture_record(*ctx, GS232_CAPTURE_DROP, NULL, 0);
+        }
+        if (gs232_binary_reply(*ctx, command, response + *response_len, response_size - *response_len, &reply_len) != GS232_OK)
+            return GS232_FAIL;
+
+        *response_len += reply_len;
+    }
+
+    return GS232_OK;
+}
@@ -0,0 +1,74 @@
+/**
+ * @gs232_binary.h
+ *
+ * @brief Binary protocol for libGS232
+ * @details Length prefixed frames carrying the GS232_COMMAND set, for controllers that do not need ASCII.
+ *          Request: sync, command (GS232_COMMAND), values quantity (uint16), values (uint16 each, same order of ASCII values).
+ *          Reply: sync, command or GS232_ERROR, payload length (uint16), payload. Position commands (C, C2, B) reply
+ *          azimuth and elevation (uint16 each), N replies executed points and points, other commands have empty payload.
+ *          Integers are little endian. Protocol is detected on first byte of a connection (sync: binary, other: ASCII).
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#ifndef GS232_BINARY_H_
+#define GS232_BINARY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libGS232.h"
+
+#define GS232_BINARY_SYNC      0xa5                        /*!< frame start (never first byte of ASCII commands) */
+#define GS232_BINARY_HEADER    4                           /*!< sync, command, quantity/length */
+#define GS232_BINARY_REPLY_MAX (GS232_BINARY_HEADER + 4)   /*!< maximum reply length */
+#define GS232_BINARY_FRAME_MAX (GS232_BINARY_HEADER + 2 * MEMORY_POINTS) /*!< maximum request length */
+
+/**
+ * @fn bool gs232_binary_detect(gs232_t **ctx, const char *data, uint32_t data_len)
+ * @brief Detect protocol of connection on first received data
+ *
+ * @param ctx Context
+ * @param data Received data
+ * @param data_len Received data length
+ * @return true: binary protocol
+ */
+bool gs232_binary_detect(gs232_t **ctx, const char *data, uint32_t data_len);
+
+/**
+ * @fn uint8_t gs232_binary_reply(gs232_t *ctx, uint8_t command, char *buffer, uint32_t buffer_size, uint32_t *len)
+ * @brief Render reply frame of parsed command
+ *
+ * @param ctx Context
+ * @param command Parsed command or GS232_ERROR
+ * @param buffer Reply buffer (GS232_BINARY_REPLY_MAX)
+ * @param buffer_size Reply buffer size
+ * @param len Reply length
+ * @return GS232_ERROR
+ */
+uint8_t gs232_binary_reply(gs232_t *ctx, uint8_t command, char *buffer, uint32_t buffer_size, uint32_t *len);
+
+/**
+ * @fn uint8_t gs232_binary_batch(gs232_t **ctx, const char *data, uint32_t data_len, uint32_t *data_used, char *response,
+ *          uint32_t response_size, uint32_t *response_len)
+ * @brief Parse binary frames from stream data and append reply frames (see gs232_stream_batch)
+ * @details Frames complete on data are executed in place (values are copied once, to context memory).
+ *          Bytes out of frames are skipped until sync, frames with more than MEMORY_POINTS values are dropped (GS232_TOOMANYVALUES reply).
+ *
+ * @param ctx Context
+ * @param data Received data
+ * @param data_len Received data length
+ * @param data_used Consumed data (less than data_len when response buffer is full)
+ * @param response Reply buffer
+ * @param response_size Reply buffer size
+ * @param response_len Reply length
+ * @return GS232_OK if all data was consumed, GS232_BUFFERTOOSMALL if response buffer is full
+ */
+uint8_t gs232_binary_batch(gs232_t **ctx, const char *data, uint32_t data_len, uint32_t *data_used, char *response, uint32_t response_size,
+        uint32_t *response_len);
+
+#endif /* GS232_BINARY_H_ */
@@ -0,0 +1,402 @@
+/**
+ * @gs232_capture.c
+ *
+ * @brief Session capture for libGS232
+ * @details Buffered binary log of parsed frames, responses and positions of contexts, and its reader.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "libGS232.h"
+#include "gs232_binary.h"
+#include "gs232_position.h"
+#include "gs232_gateway.h"
+#include "gs232_capture.h"
+
+#define GS232_CAPTURE_VARINT 10 /*!< maximum varint length (uint64) */
+#define GS232_CAPTURE_RECORD (1 + 3 * GS232_CAPTURE_VARINT) /*!< maximum record header length */
+
+static inline uint32_t gs232_capture_varint(uint8_t *p, uint64_t value) {
+    uint32_t len = 0;
+
+    while (value >= 0x80) {
+        p[len++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    p[len++] = (uint8_t) value;
+
+    return len;
+}
+
+static inline void gs232_capture_put_u16(uint8_t *p, uint16_t value) {
+    p[0] = (uint8_t) value;
+    p[1] = (uint8_t) (value >> 8);
+}
+
+static inline void gs232_capture_put_u32(uint8_t *p, uint32_t value) {
+    for (int n = 0; n < 4; n++)
+        p[n] = (uint8_t) (value >> (8 * n));
+}
+
+static inline void gs232_capture_put_u64(uint8_t *p, uint64_t value) {
+    for (int n = 0; n < 8; n++)
+        p[n] = (uint8_t) (value >> (8 * n));
+}
+
+static inline uint64_t gs232_capture_get_u64(const uint8_t *p) {
+    uint64_t value = 0;
+
+    for (int n = 7; n >= 0; n--)
+        value = value << 8 | p[n];
+
+    return value;
+}
+
+// write to file (lock held)
+static uint8_t gs232_capture_output(gs232_capture_t *capture, const void *data, uint32_t len) {
+    uint32_t pos = 0;
+    ssize_t w;
+
+    while (pos < len && !capture->error) {
+        if ((w = write(capture->fd, (const char*) data + pos, len - pos)) < 0) {
+            if (errno != EINTR)
+                capture->error = true;
+            continue;
+        }
+        pos += w;
+    }
+
+    capture->bytes += pos;
+
+    return capture->error ? GS232_FAIL : GS232_OK;
+}
+
+// write buffer to file (lock held)
+static uint8_t gs232_capture_drain(gs232_capture_t *capture) {
+    uint8_t res = gs232_capture_output(capture, capture->buffer, capture->len);
+
+    capture->len = 0;
+    return res;
+}
+
+// append record of two data parts (lock held)
+static void gs232_capture_append(gs232_capture_t *capture, uint8_t type, uint32_t session, const void *data, uint32_t len,
+        const void *more, uint32_t more_len) {
+    uint8_t header[GS232_CAPTURE_RECORD];
+    uint32_t header_len = 0;
+    uint64_t now;
+
+    if (capture->error)
+        return;
+
+    // time is read inside the lock: deltas are never negative
+    now = gs232_now();
+    header[header_len++] = type;
+    header_len += gs232_capture_varint(header + header_len, now - capture->last);
+    header_len += gs232_capture_varint(header + header_len, session);
+    header_len += gs232_capture_varint(header + header_len, (uint64_t) len + more_len);
+    capture->last = now;
+
+    if (GS232_CAPTURE_BUFFER - capture->len < (uint64_t) header_len + len + more_len && gs232_capture_drain(capture) != GS232_OK)
+        return;
+
+    // frames longer than buffer (complete on one read) are written through
+    if ((uint64_t) header_len + len + more_len > GS232_CAPTURE_BUFFER) {
+        if (gs232_capture_output(capture, header, header_len) == GS232_OK && gs232_capture_output(capture, data, len) == GS232_OK
+                && gs232_capture_output(capture, more, more_len) == GS232_OK)
+            capture->records++;
+        return;
+    }
+
+    memcpy(capture->buffer + capture->len, header, header_len);
+    capture->len += header_len;
+    if (len != 0)
+        memcpy(capture->buffer + capture->len, data, len);
+    capture->len += len;
+    if (more_len != 0)
+        memcpy(capture->buffer + capture->len, more, more_len);
+    capture->len += more_len;
+    capture->records++;
+}
+
+static void gs232_capture_write(gs232_capture_t *capture, uint8_t type, uint32_t session, const void *data, uint32_t len,
+        const void *more, uint32_t more_len) {
+    pthread_mutex_lock(&capture->lock);
+    gs232_capture_append(capture, type, session, data, len, more, more_len);
+    pthread_mutex_unlock(&capture->lock);
+}
+
+uint8_t gs232_capture_open(gs232_capture_t *capture, const char *path) {
+    struct timespec ts;
+    uint8_t header[GS232_CAPTURE_HEADER];
+
+    memset(capture, 0, sizeof(gs232_capture_t));
+
+    if ((capture->buffer = gs232_alloc(NULL, GS232_CAPTURE_BUFFER)) == NULL)
+        return GS232_FAIL;
+
+    if ((capture->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0) {
+        gs232_free(NULL, capture->buffer, GS232_CAPTURE_BUFFER);
+        return GS232_FAIL;
+    }
+
+    pthread_mutex_init(&capture->lock, NULL);
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    capture->last = gs232_now();
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, GS232_CAPTURE_MAGIC, 8);
+    gs232_capture_put_u32(header + 8, GS232_CAPTURE_VERSION);
+    gs232_capture_put_u64(header + 16, capture->last);
+    gs232_capture_put_u64(header + 24, (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+    memcpy(capture->buffer, header, sizeof(header));
+    capture->len = sizeof(header);
+
+    return GS232_OK;
+}
+
+uint8_t gs232_capture_close(gs232_capture_t *capture) {
+    uint8_t res;
+
+    if (capture->buffer == NULL)
+        return GS232_OK;
+
+    res = gs232_capture_flush(capture);
+    close(capture->fd);
+    pthread_mutex_destroy(&capture->lock);
+    gs232_free(NULL, capture->buffer, GS232_CAPTURE_BUFFER);
+    capture->buffer = NULL;
+
+    return res;
+}
+
+uint8_t gs232_capture_flush(gs232_capture_t *capture) {
+    uint8_t res;
+
+    pthread_mutex_lock(&capture->lock);
+    res = gs232_capture_drain(capture);
+    pthread_mutex_unlock(&capture->lock);
+
+    return res;
+}
+
+uint8_t gs232_capture_attach(gs232_t **ctx, gs232_capture_t *capture, const gs232_gateway_t *gateway) {
+    gs232_t *context = *ctx;
+    uint8_t data[17];
+    uint16_t azimuth, elevation;
+
+    if (capture == NULL || capture->buffer == NULL)
+        return GS232_FAIL;
+
+    gs232_position_get(context, &azimuth, &elevation);
+    data[0] = __atomic_load_n(&context->b_protocol, __ATOMIC_RELAXED);
+    data[1] = __atomic_load_n(&context->is_450_degrees, __ATOMIC_RELAXED);
+    data[2] = __atomic_load_n(&context->azimuth_nord_south, __ATOMIC_RELAXED);
+    data[3] = __atomic_load_n(&context->rotation_speed, __ATOMIC_RELAXED);
+    gs232_capture_put_u16(data + 4, azimuth);
+    gs232_capture_put_u16(data + 6, elevation);
+    data[8] = gateway != NULL ? gateway->policy : GS232_CAPTURE_NONE;
+    gs232_capture_put_u64(data + 9, gateway != NULL ? gateway->hold : 0);
+
+    pthread_mutex_lock(&capture->lock);
+    context->capture.context = ++capture->contexts;
+    context->capture.session = 0;
+    gs232_capture_append(capture, GS232_CAPTURE_CONTEXT, context->capture.context, data, sizeof(data), NULL, 0);
+    pthread_mutex_unlock(&capture->lock);
+
+    __atomic_store_n(&context->capture.log, capture, __ATOMIC_RELEASE);
+
+    return GS232_OK;
+}
+
+uint8_t gs232_capture_detach(gs232_t **ctx) {
+    __atomic_store_n(&(*ctx)->capture.log, NULL, __ATOMIC_RELEASE);
+
+    return GS232_OK;
+}
+
+uint32_t gs232_capture_connect(gs232_t **ctx, uint8_t priority) {
+    gs232_capture_t *capture = (*ctx)->capture.log;
+    uint8_t data[5];
+    uint32_t session;
+
+    if (capture == NULL)
+        return 0;
+
+    gs232_capture_put_u32(data, (*ctx)->capture.context);
+    data[4] = priority;
+
+    pthread_mutex_lock(&capture->lock);
+    session = ++capture->sessions;
+    gs232_capture_append(capture, GS232_CAPTURE_OPEN, session, data, sizeof(data), NULL, 0);
+    pthread_mutex_unlock(&capture->lock);
+
+    (*ctx)->capture.session = session;
+
+    return session;
+}
+
+uint8_t gs232_capture_switch(gs232_t **ctx, uint32_t session) {
+    (*ctx)->capture.session = session;
+
+    return GS232_OK;
+}
+
+uint8_t gs232_capture_disconnect(gs232_t **ctx, uint32_t session) {
+    if ((*ctx)->capture.log == NULL)
+        return GS232_FAIL;
+
+    gs232_capture_write((*ctx)->capture.log, GS232_CAPTURE_CLOSE, session, NULL, 0, NULL, 0);
+
+    return GS232_OK;
+}
+
+void gs232_capture_record(gs232_t *ctx, uint8_t type, const void *data, uint32_t len) {
+    gs232_capture_t *capture = __atomic_load_n(&ctx->capture.log, __ATOMIC_ACQUIRE);
+
+    if (capture != NULL)
+        gs232_capture_write(capture, type, ctx->capture.session, data, len, NULL, 0);
+}
+
+void gs232_capture_frame(gs232_t *ctx, uint8_t command, const uint8_t *values, uint16_t qty) {
+    gs232_capture_t *capture = __atomic_load_n(&ctx->capture.log, __ATOMIC_ACQUIRE);
+    uint8_t header[GS232_BINARY_HEADER];
+
+    if (capture == NULL)
+        return;
+
+    header[0] = GS232_BINARY_SYNC;
+    header[1] = command;
+    gs232_capture_put_u16(header + 2, qty);
+    gs232_capture_write(capture, GS232_CAPTURE_IN, ctx->capture.session, header, sizeof(header), values, 2 * (uint32_t) qty);
+}
+
+void gs232_capture_position(gs232_t *ctx, uint16_t azimuth, uint16_t elevation, uint8_t read) {
+    gs232_capture_t *capture = __atomic_load_n(&ctx->capture.log, __ATOMIC_ACQUIRE);
+    uint8_t data[5];
+
+    if (capture == NULL)
+        return;
+
+    gs232_capture_put_u16(data, azimuth);
+    gs232_capture_put_u16(data + 2, elevation);
+    data[4] = read;
+    gs232_capture_write(capture, GS232_CAPTURE_POSITION, ctx->capture.session, data, sizeof(data), NULL, 0);
+}
+
+void gs232_capture_tick(gs232_t *ctx, uint64_t elapsed, uint16_t point) {
+    gs232_capture_t *capture = __atomic_load_n(&ctx->capture.log, __ATOMIC_ACQUIRE);
+    uint8_t data[10];
+
+    if (capture == NULL)
+        return;
+
+    gs232_capture_put_u64(data, elapsed);
+    gs232_capture_put_u16(data + 8, point);
+    gs232_capture_write(capture, GS232_CAPTURE_TICK, ctx->capture.session, data, sizeof(data), NULL, 0);
+}
+
+uint8_t gs232_capture_reader_open(gs232_capture_reader_t *reader, const char *path) {
+    struct stat st;
+    ssize_t r;
+    int fd;
+
+    memset(reader, 0, sizeof(gs232_capture_reader_t));
+
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+        return GS232_FAIL;
+
+    if (fstat(fd, &st) < 0 || (reader->data = gs232_alloc(NULL, st.st_size + 1)) == NULL) {
+        close(fd);
+        return GS232_FAIL;
+    }
+
+    while (reader->size < (size_t) st.st_size) {
+        if ((r = read(fd, reader->data + reader->size, st.st_size - reader->size)) <= 0) {
+            if (r < 0 && errno == EINTR)
+                continue;
+            break;
+        }
+        reader->size += r;
+    }
+    close(fd);
+
+    if (reader->size < GS232_CAPTURE_HEADER || memcmp(reader->data, GS232_CAPTURE_MAGIC, 8) != 0
+            || reader->data[8] != GS232_CAPTURE_VERSION) {
+        gs232_capture_reader_close(reader);
+        return GS232_OUTOFRANGE;
+    }
+
+    reader->start = gs232_capture_get_u64(reader->data + 16);
+    reader->realtime = gs232_capture_get_u64(reader->data + 24);
+    reader->time = reader->start;
+    reader->pos = GS232_CAPTURE_HEADER;
+
+    return GS232_OK;
+}
+
+uint8_t gs232_capture_reader_close(gs232_capture_reader_t *reader) {
+    if (reader->data != NULL)
+        gs232_free(NULL, reader->data, reader->size + 1);
+
+    memset(reader, 0, sizeof(gs232_capture_reader_t));
+
+    return GS232_OK;
+}
+
+static bool gs232_capture_get_varint(gs232_capture_reader_t *reader, uint64_t *value) {
+    uint32_t shift = 0;
+    uint8_t byte;
+
+    *value = 0;
+    do {
+        if (reader->pos >= reader->size || shift >= 64)
+            return false;
+
+        byte = reader->data[reader->pos++];
+        *value |= (uint64_t) (byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    return true;
+}
+
+uint8_t gs232_capture_read(gs232_capture_reader_t *reader, gs232_capture_record_t *record) {
+    uint64_t delta, session, len;
+    size_t pos = reader->pos;
+
+    if (reader->pos >= reader->size)
+        return GS232_FAIL;
+
+    record->type = reader->data[reader->pos++];
+    if (!gs232_capture_get_varint(reader, &delta) || !gs232_capture_get_varint(reader, &session) || !gs232_capture_get_varint(reader, &len)
+            || len > reader->size - reader->pos) {
+        reader->pos = pos;
+        return GS232_OUTOFRANGE;
+    }
+
+    reader->time += delta;
+    record->time = reader->time;
+    record->session = (uint32_t) session;
+    record->len = (uint32_t) len;
+    record->data = reader->data + reader->pos;
+    reader->pos += len;
+
+    return GS232_OK;
+}
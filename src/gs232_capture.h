@@ -0,0 +1,252 @@
+/**
+ * @gs232_capture.h
+ *
+ * @brief Session capture for libGS232
+ * @details Compact binary log of the I/O of contexts: every frame parsed (inbound), every response (outbound), every
+ *          position read and every timed track tick that changed the track, timestamped and tagged with the session (client connection) it belongs to. Logs are replayed
+ *          by gs232_replay to reproduce traffic offline and to verify that responses are byte-identical.
+ *
+ *          File: header (GS232_CAPTURE_MAGIC, version, start time), then records
+ *          `type (uint8), time delta (varint, ns), session (varint), length (varint), data`.
+ *          Varints are unsigned LEB128, multi byte values little endian.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#ifndef GS232_CAPTURE_H_
+#define GS232_CAPTURE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "libGS232.h"
+#include "gs232_gateway.h"
+
+#define GS232_CAPTURE_MAGIC   "GS232CAP" /*!< file magic */
+#define GS232_CAPTURE_VERSION 2          /*!< file version */
+#define GS232_CAPTURE_BUFFER  65536      /*!< write buffer size */
+#define GS232_CAPTURE_HEADER  32         /*!< file header size */
+#define GS232_CAPTURE_NONE    0xff       /*!< no gateway policy (context record) */
+
+/**
+ * @enum GS232_CAPTURE_RECORD
+ * @brief Record types
+ *
+ */
+enum GS232_CAPTURE_RECORD {
+    GS232_CAPTURE_CONTEXT,  /*!< context attached (session: context number). Data: b_protocol, is_450_degrees, azimuth_nord_south,
+                                 rotation_speed (uint8), azimuth, elevation (uint16), gateway policy (uint8, GS232_CAPTURE_NONE:
+                                 not shared), gateway hold (uint64, ns) */
+    GS232_CAPTURE_OPEN,     /*!< session started. Data: context number (uint32), priority (uint8) */
+    GS232_CAPTURE_CLOSE,    /*!< session ended */
+    GS232_CAPTURE_IN,       /*!< frame parsed (ASCII frame or binary frame with header) */
+    GS232_CAPTURE_OUT,      /*!< response */
+    GS232_CAPTURE_DROP,     /*!< overlong frame dropped by stream */
+    GS232_CAPTURE_POSITION, /*!< position stored on context. Data: azimuth, elevation (uint16), axes read (uint8, bit 0: azimuth, bit 1: elevation) */
+    GS232_CAPTURE_TICK,     /*!< track tick executed a point or stopped the track. Data: tick time from track start (uint64, ns),
+                                 executed points after tick (uint16) */
+};
+
+/**
+ * @typedef gs232_capture_t
+ * @brief Capture log writer
+ *
+ */
+typedef struct gs232_capture_s {
+                int fd;       /*!< log file */
+               char *buffer;  /*!< records not written (GS232_CAPTURE_BUFFER) */
+           uint32_t len;      /*!< buffer length */
+           uint64_t last;     /*!< time of last record (ns) */
+           uint32_t contexts; /*!< attached contexts */
+           uint32_t sessions; /*!< started sessions */
+           uint64_t records;  /*!< written records */
+           uint64_t bytes;    /*!< written bytes */
+               bool error;    /*!< write error (records are dropped) */
+    pthread_mutex_t lock;     /*!< records lock (contexts may be used from any thread) */
+} gs232_capture_t; /*!< capture log */
+
+/**
+ * @typedef gs232_capture_record_t
+ * @brief Record read from capture log
+ *
+ */
+typedef struct gs232_capture_record_s {
+           uint8_t type;    /*!< GS232_CAPTURE_RECORD */
+          uint32_t session; /*!< session (context number on GS232_CAPTURE_CONTEXT) */
+          uint64_t time;    /*!< time (ns, gs232_now clock of capture) */
+          uint32_t len;     /*!< data length */
+    const uint8_t *data;    /*!< data (valid until gs232_capture_reader_close) */
+} gs232_capture_record_t; /*!< capture record */
+
+/**
+ * @typedef gs232_capture_reader_t
+ * @brief Capture log reader
+ *
+ */
+typedef struct gs232_capture_reader_s {
+     uint8_t *data;     /*!< log contents */
+      size_t size;      /*!< log size */
+      size_t pos;       /*!< next record */
+    uint64_t start;     /*!< capture start (ns, gs232_now clock of capture) */
+    uint64_t time;      /*!< time of last record (ns) */
+    uint64_t realtime;  /*!< capture start (CLOCK_REALTIME ns) */
+} gs232_capture_reader_t; /*!< capture reader */
+
+/**
+ * @fn uint8_t gs232_capture_open(gs232_capture_t *capture, const char *path)
+ * @brief Create capture log (truncated if exists)
+ *
+ * @param capture Capture
+ * @param path Log file
+ * @return GS232_ERROR
+ */
+uint8_t gs232_capture_open(gs232_capture_t *capture, const char *path);
+
+/**
+ * @fn uint8_t gs232_capture_close(gs232_capture_t *capture)
+ * @brief Write pending records and close log. Attached contexts must be detached or destroyed before
+ *
+ * @param capture Capture
+ * @return GS232_ERROR
+ */
+uint8_t gs232_capture_close(gs232_capture_t *capture);
+
+/**
+ * @fn uint8_t gs232_capture_flush(gs232_capture_t *capture)
+ * @brief Write pending records
+ *
+ * @param capture Capture
+ * @return GS232_ERROR
+ */
+uint8_t gs232_capture_flush(gs232_capture_t *capture);
+
+/**
+ * @fn uint8_t gs232_capture_attach(gs232_t **ctx, gs232_capture_t *capture, const gs232_gateway_t *gateway)
+ * @brief Capture I/O of context
+ * @details Records context state at attach. Records are written on sessions started with gs232_capture_connect.
+ *
+ * @param ctx Context
+ * @param capture Capture
+ * @param gateway Gateway of context (NULL: context of one client)
+ * @return GS232_ERROR
+ */
+uint8_t gs232_capture_attach(gs232_t **ctx, gs232_capture_t *capture, const gs232_gateway_t *gateway);
+
+/**
+ * @fn uint8_t gs232_capture_detach(gs232_t **ctx)
+ * @brief Stop capture of context
+ *
+ * @param ctx Context
+ * @return GS232_ERROR
+ */
+uint8_t gs232_capture_detach(gs232_t **ctx);
+
+/**
+ * @fn uint32_t gs232_capture_connect(gs232_t **ctx, uint8_t priority)
+ * @brief Start session (client) on attached context, the session is the current one of context
+ *
+ * @param ctx Context
+ * @param priority Client priority (gateway)
+ * @return Session (0: context not attached)
+ */
+uint32_t gs232_capture_connect(gs232_t **ctx, uint8_t priority);
+
+/**
+ * @fn uint8_t gs232_capture_switch(gs232_t **ctx, uint32_t session)
+ * @brief Records of context belong to session (shared context, before parsing data of client)
+ *
+ * @param ctx Context
+ * @param session Session
+ * @return GS232_ERROR
+ */
+uint8_t gs232_capture_switch(gs232_t **ctx, uint32_t session);
+
+/**
+ * @fn uint8_t gs232_capture_disconnect(gs232_t **ctx, uint32_t session)
+ * @brief End session
+ *
+ * @param ctx Context
+ * @param session Session
+ * @return GS232_ERROR
+ */
+uint8_t gs232_capture_disconnect(gs232_t **ctx, uint32_t session);
+
+/**
+ * @fn void gs232_capture_record(gs232_t *ctx, uint8_t type, const void *data, uint32_t len)
+ * @brief Write record of current session of context (called by the library on parse, response and position store)
+ *
+ * @param ctx Context
+ * @param type GS232_CAPTURE_RECORD
+ * @param data Data
+ * @param len Data length
+ */
+void gs232_capture_record(gs232_t *ctx, uint8_t type, const void *data, uint32_t len);
+
+/**
+ * @fn void gs232_capture_frame(gs232_t *ctx, uint8_t command, const uint8_t *values, uint16_t qty)
+ * @brief Write inbound record of binary frame
+ *
+ * @param ctx Context
+ * @param command Frame command
+ * @param values Frame values (little endian)
+ * @param qty Values quantity
+ */
+void gs232_capture_frame(gs232_t *ctx, uint8_t command, const uint8_t *values, uint16_t qty);
+
+/**
+ * @fn void gs232_capture_position(gs232_t *ctx, uint16_t azimuth, uint16_t elevation, uint8_t read)
+ * @brief Write position record
+ *
+ * @param ctx Context
+ * @param azimuth Azimuth
+ * @param elevation Elevation
+ * @param read Axes stored (bit 0: azimuth, bit 1: elevation)
+ */
+void gs232_capture_position(gs232_t *ctx, uint16_t azimuth, uint16_t elevation, uint8_t read);
+
+/**
+ * @fn void gs232_capture_tick(gs232_t *ctx, uint64_t elapsed, uint16_t point)
+ * @brief Write track tick record (ticks are replayed only where they were executed)
+ *
+ * @param ctx Context
+ * @param elapsed Tick time from track start (ns)
+ * @param point Executed points after tick
+ */
+void gs232_capture_tick(gs232_t *ctx, uint64_t elapsed, uint16_t point);
+
+/**
+ * @fn uint8_t gs232_capture_reader_open(gs232_capture_reader_t *reader, const char *path)
+ * @brief Load capture log
+ *
+ * @param reader Reader
+ * @param path Log file
+ * @return GS232_ERROR (GS232_OUTOFRANGE: not a capture log of this version)
+ */
+uint8_t gs232_capture_reader_open(gs232_capture_reader_t *reader, const char *path);
+
+/**
+ * @fn uint8_t gs232_capture_reader_close(gs232_capture_reader_t *reader)
+ * @brief Release capture log
+ *
+ * @param reader Reader
+ * @return GS232_ERROR
+ */
+uint8_t gs232_capture_reader_close(gs232_capture_reader_t *reader);
+
+/**
+ * @fn uint8_t gs232_capture_read(gs232_capture_reader_t *reader, gs232_capture_record_t *record)
+ * @brief Next record
+ *
+ * @param reader Reader
+ * @param record Record
+ * @return GS232_ERROR (GS232_FAIL: end of log, GS232_OUTOFRANGE: truncated record)
+ */
+uint8_t gs232_capture_read(gs232_capture_reader_t *reader, gs232_capture_record_t *record);
+
+#endif /* GS232_CAPTURE_H_ */
@@ -0,0 +1,117 @@
+/**
+ * @gs232_gateway.c
+ *
+ * @brief Gateway for libGS232
+ * @details One context shared by many clients: per-client streams, poll coalescing and arbitration of control commands.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "libGS232.h"
+#include "gs232_trace.h"
+#include "gs232_position.h"
+#include "gs232_gateway.h"
+
+static bool gs232_gateway_query(uint8_t command) {
+    switch (command) {
+        case GS232_RETURN_CURRENT_AZIMUTH:
+        case GS232_RETURN_AZIMUTH_AND_ELEVATION:
+        case GS232_RETURN_CURRENT_ELEVATION:
+        case GS232_TOTAL_NUMBER_OF_SETTING_ANGLES:
+        case GS232_LIST_OF_COMMANDS1:
+        case GS232_LIST_OF_COMMANDS2:
+        case GS232_LIST_OF_COMMANDS3:
+        case GS232_ALL_STOP:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static bool gs232_gateway_filter(gs232_t *ctx, uint8_t command, void *arg) {
+    gs232_gateway_t *gateway = arg;
+    uint64_t now;
+
+    if (gateway->policy == GS232_GATEWAY_SHARED || gateway->client == NULL || gs232_gateway_query(command))
+        return true;
+
+    now = gs232_now();
+    if (gateway->owner != NULL && gateway->owner != gateway->client && now < gateway->owner_until
+            && (gateway->policy == GS232_GATEWAY_EXCLUSIVE || gateway->priority <= gateway->owner_priority)) {
+        __atomic_fetch_add(&gateway->rejected, 1, __ATOMIC_RELAXED);
+        GS232_TRACE(GS232_TRACE_INFO, GS232_TRACE_EVENT_ARBITRATION, ctx, command, gateway->priority);
+        return false;
+    }
+
+    gateway->owner = gateway->client;
+    gateway->owner_priority = gateway->priority;
+    gateway->owner_until = now + gateway->hold;
+
+    return true;
+}
+
+uint8_t gs232_gateway_init(gs232_gateway_t *gateway, gs232_t *ctx, uint8_t policy, uint64_t window, uint64_t hold) {
+    if (gateway == NULL || ctx == NULL || policy > GS232_GATEWAY_PRIORITY)
+        return GS232_FAIL;
+
+    memset(gateway, 0, sizeof(gs232_gateway_t));
+    gateway->ctx = ctx;
+    gateway->policy = policy;
+    gateway->hold = hold;
+
+    gs232_position_max_age(&gateway->ctx, window);
+    ctx->filter.arg = gateway;
+    ctx->filter.fn = gs232_gateway_filter;
+
+    return GS232_OK;
+}
+
+uint8_t gs232_gateway_deinit(gs232_gateway_t *gateway) {
+    gateway->ctx->filter.fn = NULL;
+    gateway->ctx->filter.arg = NULL;
+
+    return GS232_OK;
+}
+
+uint8_t gs232_gateway_begin(gs232_gateway_t *gateway, gs232_stream_t *stream, const void *client, uint8_t priority) {
+    if (gateway->client != NULL)
+        return GS232_FAIL;
+
+    gateway->stream = gateway->ctx->stream;
+    gateway->ctx->stream = *stream;
+    gateway->client = client;
+    gateway->priority = priority;
+
+    return GS232_OK;
+}
+
+uint8_t gs232_gateway_end(gs232_gateway_t *gateway, gs232_stream_t *stream) {
+    if (gateway->client == NULL)
+        return GS232_FAIL;
+
+    *stream = gateway->ctx->stream;
+    gateway->ctx->stream = gateway->stream;
+    gateway->client = NULL;
+
+    return GS232_OK;
+}
+
+uint8_t gs232_gateway_leave(gs232_gateway_t *gateway, gs232_stream_t *stream, const void *client) {
+    if (gateway->owner == client)
+        gateway->owner = NULL;
+
+    gs232_free(gateway->ctx->allocator, stream->buffer, GS232_FRAME_MAX);
+    memset(stream, 0, sizeof(gs232_stream_t));
+
+    return GS232_OK;
+}
@@ -0,0 +1,116 @@
+/**
+ * @gs232_gateway.h
+ *
+ * @brief Gateway for libGS232
+ * @details One context (one physical rotator) shared by many clients. Every client has its own stream framing state and
+ *          protocol, position polls of all clients inside the coalescing window are answered from one hardware read
+ *          (position cache) and control commands are admitted by an arbitration policy. Gateway functions are called
+ *          from the parser thread of the context (e.g. the server loop, see gs232_server_gateway).
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#ifndef GS232_GATEWAY_H_
+#define GS232_GATEWAY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libGS232.h"
+#include "gs232_position.h"
+
+#define GS232_GATEWAY_WINDOW GS232_POSITION_MAX_AGE /*!< default poll coalescing window (ns) */
+#define GS232_GATEWAY_HOLD   5000000000ULL           /*!< default control hold of exclusive and priority policies (ns) */
+
+/**
+ * @enum GS232_GATEWAY_POLICY
+ * @brief Arbitration of control commands
+ * @details Position and help queries (C, C2, B, N, H) and all stop (S) are accepted from every client with any policy.
+ *
+ */
+enum GS232_GATEWAY_POLICY {
+    GS232_GATEWAY_SHARED,    /*!< every client controls the rotator, commands are executed in arrival order */
+    GS232_GATEWAY_EXCLUSIVE, /*!< first client with a control command owns the rotator until idle for hold time or disconnected */
+    GS232_GATEWAY_PRIORITY,  /*!< as exclusive, a client of higher priority takes control at once */
+};
+
+/**
+ * @typedef gs232_gateway_t
+ * @brief Gateway
+ *
+ */
+typedef struct gs232_gateway_s {
+           gs232_t *ctx;            /*!< shared context */
+           uint8_t policy;          /*!< GS232_GATEWAY_POLICY */
+          uint64_t hold;            /*!< control hold after last admitted command (ns) */
+    gs232_stream_t stream;          /*!< context stream, saved while a client stream is in use */
+        const void *client;         /*!< client of commands being parsed (NULL: none) */
+           uint8_t priority;        /*!< priority of client */
+        const void *owner;          /*!< client in control (NULL: none) */
+           uint8_t owner_priority;  /*!< priority of owner */
+          uint64_t owner_until;     /*!< end of control hold (ns) */
+          uint64_t rejected;        /*!< rejected control commands */
+} gs232_gateway_t; /*!< gateway */
+
+/**
+ * @fn uint8_t gs232_gateway_init(gs232_gateway_t *gateway, gs232_t *ctx, uint8_t policy, uint64_t window, uint64_t hold)
+ * @brief Share context among clients
+ * @details Installs the arbitration filter and sets the position cache maximum age to window: hardware is read at most
+ *          once per window whatever the number of polling clients.
+ *
+ * @param gateway Gateway
+ * @param ctx Context
+ * @param policy GS232_GATEWAY_POLICY
+ * @param window Poll coalescing window (ns, 0: every poll reads hardware)
+ * @param hold Control hold (ns, exclusive and priority policies)
+ * @return GS232_ERROR
+ */
+uint8_t gs232_gateway_init(gs232_gateway_t *gateway, gs232_t *ctx, uint8_t policy, uint64_t window, uint64_t hold);
+
+/**
+ * @fn uint8_t gs232_gateway_deinit(gs232_gateway_t *gateway)
+ * @brief Remove arbitration filter (context is not destroyed)
+ *
+ * @param gateway Gateway
+ * @return GS232_ERROR
+ */
+uint8_t gs232_gateway_deinit(gs232_gateway_t *gateway);
+
+/**
+ * @fn uint8_t gs232_gateway_begin(gs232_gateway_t *gateway, gs232_stream_t *stream, const void *client, uint8_t priority)
+ * @brief Start parsing data of client: client stream is used by context stream functions until gs232_gateway_end
+ *
+ * @param gateway Gateway
+ * @param stream Client stream (zero initialized on first use)
+ * @param client Client identifier
+ * @param priority Client priority (GS232_GATEWAY_PRIORITY, higher wins)
+ * @return GS232_ERROR
+ */
+uint8_t gs232_gateway_begin(gs232_gateway_t *gateway, gs232_stream_t *stream, const void *client, uint8_t priority);
+
+/**
+ * @fn uint8_t gs232_gateway_end(gs232_gateway_t *gateway, gs232_stream_t *stream)
+ * @brief End parsing data of client
+ *
+ * @param gateway Gateway
+ * @param stream Client stream (same of gs232_gateway_begin)
+ * @return GS232_ERROR
+ */
+uint8_t gs232_gateway_end(gs232_gateway_t *gateway, gs232_stream_t *stream);
+
+/**
+ * @fn uint8_t gs232_gateway_leave(gs232_gateway_t *gateway, gs232_stream_t *stream, const void *client)
+ * @brief Client disconnected: release control and stream buffer
+ *
+ * @param gateway Gateway
+ * @param stream Client stream
+ * @param client Client identifier
+ * @return GS232_ERROR
+ */
+uint8_t gs232_gateway_leave(gs232_gateway_t *gateway, gs232_stream_t *stream, const void *client);
+
+#endif /* GS232_GATEWAY_H_ */
@@ -0,0 +1,147 @@
+/**
+ * @gs232_memory.c
+ *
+ * @brief Track memory pool for libGS232
+ * @details Memory for M/W values shared by all contexts
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "libGS232.h"
+#include "gs232_seqlock.h"
+#include "gs232_memory.h"
+
+typedef struct gs232_memory_block_s {
+    struct gs232_memory_block_s *next;
+} gs232_memory_block_t;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static gs232_memory_block_t *pool[GS232_MEMORY_CLASSES];
+
+static uint8_t gs232_memory_class(uint16_t values, uint16_t *size) {
+    uint8_t class = 0;
+
+    for (*size = 16; *size < values && class < GS232_MEMORY_CLASSES - 1; *size <<= 2)
+        ++class;
+
+    if (class == GS232_MEMORY_CLASSES - 1)
+        *size = MEMORY_POINTS;
+
+    return class;
+}
+
+uint16_t* gs232_memory_acquire(const gs232_allocator_t *allocator, uint16_t values, uint16_t *size) {
+    gs232_memory_block_t *block;
+    uint8_t class;
+
+    if (values > MEMORY_POINTS)
+        return NULL;
+
+    class = gs232_memory_class(values, size);
+
+    if (allocator != NULL)
+        return gs232_alloc(allocator, *size * sizeof(uint16_t));
+
+    pthread_mutex_lock(&pool_lock);
+    block = pool[class];
+    if (block != NULL)
+        pool[class] = block->next;
+    pthread_mutex_unlock(&pool_lock);
+
+    if (block == NULL)
+        block = gs232_alloc(NULL, *size * sizeof(uint16_t));
+
+    return (uint16_t*) block;
+}
+
+void gs232_memory_release(const gs232_allocator_t *allocator, uint16_t *memory, uint16_t size) {
+    gs232_memory_block_t *block = (gs232_memory_block_t*) memory;
+    uint16_t class_size;
+    uint8_t class;
+
+    if (memory == NULL)
+        return;
+
+    class = gs232_memory_class(size, &class_size);
+
+    if (allocator != NULL) {
+        gs232_free(allocator, memory, class_size * sizeof(uint16_t));
+        return;
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    block->next = pool[class];
+    pool[class] = block;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+void gs232_memory_publish(gs232_t **ctx, uint16_t *memory, uint16_t size, uint16_t qty, uint8_t command) {
+    gs232_t *context = *ctx;
+    uint16_t *previous = context->memory;
+    uint16_t previous_size = context->memory_size;
+
+    gs232_seqlock_write_begin(&context->memory_sequence);
+    __atomic_store_n(&context->memory, memory, __ATOMIC_RELAXED);
+    __atomic_store_n(&context->memory_size, size, __ATOMIC_RELAXED);
+    __atomic_store_n(&context->memory_qty, qty, __ATOMIC_RELAXED);
+    __atomic_store_n(&context->track.command, command, __ATOMIC_RELAXED);
+    gs232_seqlock_write_end(&context->memory_sequence);
+
+    // grace period: readers started before the swap may still use previous memory
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&context->memory_readers, __ATOMIC_SEQ_CST) != 0)
+        sched_yield();
+
+    if (previous == context->memory_inline[0] || previous == context->memory_inline[1] || previous == memory)
+        return;
+
+    // retired block is kept for next upload
+    if (context->memory_spare == NULL || context->memory_spare_size < previous_size) {
+        gs232_memory_release(context->allocator, context->memory_spare, context->memory_spare_size);
+        context->memory_spare = previous;
+        context->memory_spare_size = previous_size;
+    } else
+        gs232_memory_release(context->allocator, previous, previous_size);
+}
+
+void gs232_memory_read_lock(gs232_t *ctx) {
+    __atomic_fetch_add(&ctx->memory_readers, 1, __ATOMIC_SEQ_CST);
+}
+
+void gs232_memory_read_unlock(gs232_t *ctx) {
+    __atomic_fetch_sub(&ctx->memory_readers, 1, __ATOMIC_RELEASE);
+}
+
+void gs232_memory_snapshot(gs232_t *ctx, gs232_memory_snapshot_t *snapshot) {
+    uint32_t sequence;
+
+    do {
+        sequence = gs232_seqlock_read_begin(&ctx->memory_sequence);
+        snapshot->memory = __atomic_load_n(&ctx->memory, __ATOMIC_RELAXED);
+        snapshot->qty = __atomic_load_n(&ctx->memory_qty, __ATOMIC_RELAXED);
+        snapshot->command = __atomic_load_n(&ctx->track.command, __ATOMIC_RELAXED);
+    } while (gs232_seqlock_read_retry(&ctx->memory_sequence, sequence));
+}
+
+void gs232_memory_trim(void) {
+    gs232_memory_block_t *block;
+
+    pthread_mutex_lock(&pool_lock);
+    for (uint8_t class = 0; class < GS232_MEMORY_CLASSES; class++) {
+        while ((block = pool[class]) != NULL) {
+            pool[class] = block->next;
+            gs232_free(NULL, block, (class == GS232_MEMORY_CLASSES - 1 ? MEMORY_POINTS : 16 << (2 * class)) * sizeof(uint16_t));
+        }
+    }
+    pthread_mutex_unlock(&pool_lock);
+}
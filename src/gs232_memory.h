@@ -0,0 +1,104 @@
+/**
+ * @gs232_memory.h
+ *
+ * @brief Track memory pool for libGS232
+ * @details Memory for M/W values is taken only when needed from size classes shared by all contexts.
+ *          Released blocks are kept for reuse.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#ifndef GS232_MEMORY_H_
+#define GS232_MEMORY_H_
+
+#include <stdint.h>
+
+#include "gs232_alloc.h"
+
+#define GS232_MEMORY_INLINE  4 /*!< values stored on context (Maaa, Waaa eee) */
+#define GS232_MEMORY_CLASSES 5 /*!< block size classes: 16, 64, 256, 1024, MEMORY_POINTS values */
+
+typedef struct gs232_s gs232_t;
+
+/**
+ * @typedef gs232_memory_snapshot_t
+ * @brief Consistent view of context memory
+ *
+ */
+typedef struct gs232_memory_snapshot_s {
+    const uint16_t *memory; /*!< values (valid until gs232_memory_read_unlock) */
+          uint16_t qty;     /*!< values quantity */
+           uint8_t command; /*!< timed track command (GS232_UNKNOWN_COMMAND: none) */
+} gs232_memory_snapshot_t; /*!< memory snapshot */
+
+/**
+ * @fn uint16_t* gs232_memory_acquire(const gs232_allocator_t *allocator, uint16_t values, uint16_t *size)
+ * @brief Get memory block from pool
+ *
+ * @param allocator Context allocator (NULL: shared pool on global allocator, else allocated without pool)
+ * @param values Minimum values (up to MEMORY_POINTS)
+ * @param size Block size (values)
+ * @return Block, NULL on error
+ */
+uint16_t* gs232_memory_acquire(const gs232_allocator_t *allocator, uint16_t values, uint16_t *size);
+
+/**
+ * @fn void gs232_memory_release(const gs232_allocator_t *allocator, uint16_t *memory, uint16_t size)
+ * @brief Return memory block to pool
+ *
+ * @param allocator Context allocator (same of gs232_memory_acquire)
+ * @param memory Block
+ * @param size Block size (values)
+ */
+void gs232_memory_release(const gs232_allocator_t *allocator, uint16_t *memory, uint16_t size);
+
+/**
+ * @fn void gs232_memory_publish(gs232_t **ctx, uint16_t *memory, uint16_t size, uint16_t qty, uint8_t command)
+ * @brief Replace context memory (RCU style): new values are published at once, previous block is released
+ *        when no reader holds it. Called by the thread parsing commands of the context
+ *
+ * @param ctx Context
+ * @param memory New values (inline memory of context or block from gs232_memory_acquire)
+ * @param size Block size (values)
+ * @param qty Values quantity
+ * @param command Timed track command (GS232_UNKNOWN_COMMAND: none)
+ */
+void gs232_memory_publish(gs232_t **ctx, uint16_t *memory, uint16_t size, uint16_t qty, uint8_t command);
+
+/**
+ * @fn void gs232_memory_read_lock(gs232_t *ctx)
+ * @brief Start memory read section: snapshot memory is not released until gs232_memory_read_unlock
+ *
+ * @param ctx Context
+ */
+void gs232_memory_read_lock(gs232_t *ctx);
+
+/**
+ * @fn void gs232_memory_read_unlock(gs232_t *ctx)
+ * @brief End memory read section
+ *
+ * @param ctx Context
+ */
+void gs232_memory_read_unlock(gs232_t *ctx);
+
+/**
+ * @fn void gs232_memory_snapshot(gs232_t *ctx, gs232_memory_snapshot_t *snapshot)
+ * @brief Consistent view of memory, quantity and timed track command (values only valid inside a read section)
+ *
+ * @param ctx Context
+ * @param snapshot Snapshot
+ */
+void gs232_memory_snapshot(gs232_t *ctx, gs232_memory_snapshot_t *snapshot);
+
+/**
+ * @fn void gs232_memory_trim(void)
+ * @brief Free all unused blocks on pool
+ *
+ */
+void gs232_memory_trim(void);
+
+#endif /* GS232_MEMORY_H_ */
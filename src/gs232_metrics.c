@@ -0,0 +1,293 @@
+/**
+ * @gs232_metrics.c
+ *
+ * @brief Metrics for libGS232
+ * @details Command counters, parse errors by reason, bytes in/out and log-linear latency histograms of parse, response and
+ *          hardware functions.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "libGS232.h"
+#include "gs232_metrics.h"
+
+_Static_assert(GS232_METRICS_COMMANDS == GS232_UNKNOWN_COMMAND + 1, "GS232_METRICS_COMMANDS");
+_Static_assert(GS232_METRICS_ERRORS == GS232_BUFFERTOOSMALL - GS232_FAIL + 1, "GS232_METRICS_ERRORS");
+_Static_assert(sizeof(gs232_metrics_t) % sizeof(uint64_t) == 0, "gs232_metrics_t is not an array of counters");
+
+#define GS232_METRICS_WORDS    (sizeof(gs232_metrics_t) / sizeof(uint64_t))
+#define GS232_HISTOGRAM_SUBS   (1U << GS232_HISTOGRAM_SUB_BITS)
+
+/*
+ * Global metrics: every thread writes its own shard (plain load and store, no locked instruction). Shards are never freed,
+ * the shard of a finished thread is taken by the next new thread and keeps its counters.
+ */
+typedef struct gs232_metrics_shard_s {
+                 gs232_metrics_t metrics; /*!< counters of owner thread */
+                            bool owned;   /*!< in use by a thread */
+    struct gs232_metrics_shard_s *next;   /*!< next shard */
+} gs232_metrics_shard_t;
+
+static gs232_metrics_shard_t *shards = NULL;
+static __thread gs232_metrics_shard_t *shard __attribute__((tls_model("initial-exec"))) = NULL;
+static pthread_key_t shard_key;
+static pthread_once_t shard_once = PTHREAD_ONCE_INIT;
+
+static void gs232_metrics_shard_release(void *arg) {
+    gs232_metrics_shard_t *released = arg;
+
+    __atomic_store_n(&released->owned, false, __ATOMIC_RELEASE);
+}
+
+static void gs232_metrics_shard_key(void) {
+    pthread_key_create(&shard_key, gs232_metrics_shard_release);
+}
+
+static gs232_metrics_t* gs232_metrics_shard(void) {
+    gs232_metrics_shard_t *s;
+
+    if (shard != NULL)
+        return &shard->metrics;
+
+    pthread_once(&shard_once, gs232_metrics_shard_key);
+
+    for (s = __atomic_load_n(&shards, __ATOMIC_ACQUIRE); s != NULL; s = s->next)
+        if (!__atomic_load_n(&s->owned, __ATOMIC_RELAXED) && !__atomic_exchange_n(&s->owned, true, __ATOMIC_ACQUIRE))
+            break;
+
+    if (s == NULL) {
+        if ((s = gs232_alloc(NULL, sizeof(gs232_metrics_shard_t))) == NULL)
+            return NULL;
+
+        memset(s, 0, sizeof(gs232_metrics_shard_t));
+        s->owned = true;
+        s->next = __atomic_load_n(&shards, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&shards, &s->next, s, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            ;
+    }
+
+    pthread_setspecific(shard_key, s);
+    shard = s;
+
+    return &shard->metrics;
+}
+
+static inline void gs232_metrics_store(uint64_t *counter, uint64_t value) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+/*
+ * Shard counters have a single writer. Context counters of parse (commands, errors, bytes in and parse latency) are written
+ * by the parser thread of context, responses and hardware functions may run on any thread.
+ */
+static inline void gs232_metrics_add(uint64_t *ctx_counter, uint64_t *shard_counter, uint64_t value, bool shared) {
+    if (shared)
+        __atomic_fetch_add(ctx_counter, value, __ATOMIC_RELAXED);
+    else
+        gs232_metrics_store(ctx_counter, value);
+
+    gs232_metrics_store(shard_counter, value);
+}
+
+// context counters are allocated on first update: contexts stay small and the histograms of idle contexts take no memory
+static gs232_metrics_t* gs232_metrics_context(gs232_t *ctx) {
+#if GS232_METRICS
+    gs232_metrics_t *metrics = __atomic_load_n(&ctx->metrics, __ATOMIC_ACQUIRE), *expected = NULL;
+
+    if (metrics != NULL)
+        return metrics;
+
+    if ((metrics = gs232_alloc(ctx->allocator, sizeof(gs232_metrics_t))) == NULL)
+        return NULL;
+
+    memset(metrics, 0, sizeof(gs232_metrics_t));
+    if (!__atomic_compare_exchange_n(&ctx->metrics, &expected, metrics, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        gs232_free(ctx->allocator, metrics, sizeof(gs232_metrics_t));
+        metrics = expected;
+    }
+
+    return metrics;
+#else
+    return NULL;
+#endif
+}
+
+static uint64_t gs232_metrics_clock(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void gs232_metrics_command(gs232_t *ctx, uint8_t command, uint32_t bytes) {
+    gs232_metrics_t *global = gs232_metrics_shard(), *local = gs232_metrics_context(ctx);
+
+    if (global == NULL || local == NULL)
+        return;
+
+    if (command <= GS232_UNKNOWN_COMMAND)
+        gs232_metrics_add(&local->commands[command], &global->commands[command], 1, false);
+    else if (command >= GS232_FAIL && command <= GS232_BUFFERTOOSMALL)
+        gs232_metrics_add(&local->errors[command - GS232_FAIL], &global->errors[command - GS232_FAIL], 1, false);
+
+    gs232_metrics_add(&local->bytes_in, &global->bytes_in, bytes, false);
+}
+
+void gs232_metrics_error(gs232_t *ctx, uint8_t error) {
+    gs232_metrics_t *global = gs232_metrics_shard(), *local = gs232_metrics_context(ctx);
+
+    if (global == NULL || local == NULL || error < GS232_FAIL || error > GS232_BUFFERTOOSMALL)
+        return;
+
+    gs232_metrics_add(&local->errors[error - GS232_FAIL], &global->errors[error - GS232_FAIL], 1, false);
+}
+
+void gs232_metrics_response(gs232_t *ctx, uint32_t bytes) {
+    gs232_metrics_t *global = gs232_metrics_shard(), *local = gs232_metrics_context(ctx);
+
+    if (global == NULL || local == NULL)
+        return;
+
+    gs232_metrics_add(&local->bytes_out, &global->bytes_out, bytes, true);
+}
+
+uint64_t gs232_metrics_begin(gs232_t *ctx, uint8_t latency) {
+    gs232_metrics_t *global = gs232_metrics_shard(), *local = gs232_metrics_context(ctx);
+    uint64_t events, now;
+
+    if (global == NULL || local == NULL)
+        return 0;
+
+    if (latency == GS232_METRICS_PARSE) {
+        events = __atomic_load_n(&local->latency[latency].events, __ATOMIC_RELAXED);
+        __atomic_store_n(&local->latency[latency].events, events + 1, __ATOMIC_RELAXED);
+    } else
+        events = __atomic_fetch_add(&local->latency[latency].events, 1, __ATOMIC_RELAXED);
+    gs232_metrics_store(&global->latency[latency].events, 1);
+
+    if ((events & (GS232_METRICS_SAMPLING - 1)) != 0)
+        return 0;
+
+    now = gs232_metrics_clock();
+    return now != 0 ? now : 1;
+}
+
+void gs232_metrics_end(gs232_t *ctx, uint8_t latency, uint64_t start) {
+    gs232_metrics_t *global, *local;
+    uint64_t elapsed;
+    uint32_t bucket;
+    bool shared;
+
+    if (start == 0 || (global = gs232_metrics_shard()) == NULL || (local = gs232_metrics_context(ctx)) == NULL)
+        return;
+
+    elapsed = gs232_metrics_clock() - start;
+    bucket = gs232_histogram_bucket(elapsed);
+
+    shared = latency != GS232_METRICS_PARSE;
+    gs232_metrics_add(&local->latency[latency].count, &global->latency[latency].count, 1, shared);
+    gs232_metrics_add(&local->latency[latency].sum, &global->latency[latency].sum, elapsed, shared);
+    gs232_metrics_add(&local->latency[latency].buckets[bucket], &global->latency[latency].buckets[bucket], 1, shared);
+}
+
+uint8_t gs232_metrics_snapshot(gs232_t *ctx, gs232_metrics_t *snapshot) {
+    uint64_t *to = (uint64_t*) snapshot;
+    const uint64_t *from;
+
+    if (snapshot == NULL)
+        return GS232_FAIL;
+
+    memset(snapshot, 0, sizeof(gs232_metrics_t));
+
+    if (ctx != NULL) {
+#if GS232_METRICS
+        // not allocated: no updates yet
+        if ((from = (const uint64_t*) __atomic_load_n(&ctx->metrics, __ATOMIC_ACQUIRE)) != NULL)
+            for (size_t n = 0; n < GS232_METRICS_WORDS; n++)
+                to[n] = __atomic_load_n(&from[n], __ATOMIC_RELAXED);
+#endif
+        return GS232_OK;
+    }
+
+    for (gs232_metrics_shard_t *s = __atomic_load_n(&shards, __ATOMIC_ACQUIRE); s != NULL; s = s->next) {
+        from = (const uint64_t*) &s->metrics;
+        for (size_t n = 0; n < GS232_METRICS_WORDS; n++)
+            to[n] += __atomic_load_n(&from[n], __ATOMIC_RELAXED);
+    }
+
+    return GS232_OK;
+}
+
+uint8_t gs232_metrics_reset(gs232_t **ctx) {
+#if GS232_METRICS
+    uint64_t *counters = (uint64_t*) __atomic_load_n(&(*ctx)->metrics, __ATOMIC_ACQUIRE);
+
+    if (counters != NULL)
+        for (size_t n = 0; n < GS232_METRICS_WORDS; n++)
+            __atomic_store_n(&counters[n], 0, __ATOMIC_RELAXED);
+#endif
+
+    return GS232_OK;
+}
+
+uint32_t gs232_histogram_bucket(uint64_t value) {
+    uint32_t exponent, bucket;
+
+    if (value < GS232_HISTOGRAM_SUBS)
+        return (uint32_t) value;
+
+    exponent = 63 - __builtin_clzll(value);
+    bucket = ((exponent - GS232_HISTOGRAM_SUB_BITS + 1) << GS232_HISTOGRAM_SUB_BITS)
+            | ((value >> (exponent - GS232_HISTOGRAM_SUB_BITS)) & (GS232_HISTOGRAM_SUBS - 1));
+
+    return bucket < GS232_HISTOGRAM_BUCKETS ? bucket : GS232_HISTOGRAM_BUCKETS - 1;
+}
+
+uint64_t gs232_histogram_lower(uint32_t bucket) {
+    uint32_t exponent;
+
+    if (bucket < GS232_HISTOGRAM_SUBS)
+        return bucket;
+
+    exponent = (bucket >> GS232_HISTOGRAM_SUB_BITS) + GS232_HISTOGRAM_SUB_BITS - 1;
+    return (uint64_t) (GS232_HISTOGRAM_SUBS | (bucket & (GS232_HISTOGRAM_SUBS - 1))) << (exponent - GS232_HISTOGRAM_SUB_BITS);
+}
+
+uint64_t gs232_histogram_percentile(const gs232_histogram_t *histogram, double percentile) {
+    uint64_t total = 0, rank, seen = 0;
+    uint32_t bucket;
+
+    // total of buckets: count may differ on a snapshot taken while measuring
+    for (bucket = 0; bucket < GS232_HISTOGRAM_BUCKETS; bucket++)
+        total += histogram->buckets[bucket];
+
+    if (total == 0)
+        return 0;
+
+    if (percentile < 0)
+        percentile = 0;
+    if (percentile > 100)
+        percentile = 100;
+
+    rank = (uint64_t) (total * percentile / 100.0 + 0.5);
+    if (rank == 0)
+        rank = 1;
+
+    for (bucket = 0; bucket < GS232_HISTOGRAM_BUCKETS - 1; bucket++) {
+        seen += histogram->buckets[bucket];
+        if (seen >= rank)
+            break;
+    }
+
+    return bucket < GS232_HISTOGRAM_BUCKETS - 1 ? gs232_histogram_lower(bucket + 1) - 1 : gs232_histogram_lower(bucket);
+}
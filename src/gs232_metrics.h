@@ -0,0 +1,181 @@
+/**
+ * @gs232_metrics.h
+ *
+ * @brief Metrics for libGS232
+ * @details Command counters, parse errors by reason, bytes in/out and log-linear latency histograms of parse, response and
+ *          hardware functions. Every context has its own counters (relaxed atomics, allocated with the context allocator on
+ *          first update), global counters are per-thread shards summed on snapshot. Updates never lock and a snapshot is a
+ *          copy of a few kilobytes. GS232_METRICS must have the same value on the library and its users (context layout).
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#ifndef GS232_METRICS_H_
+#define GS232_METRICS_H_
+
+#include <stdint.h>
+
+#ifndef GS232_METRICS
+#define GS232_METRICS 1 /*!< compiled metrics (0: every update is removed) */
+#endif
+
+#define GS232_METRICS_COMMANDS     31 /*!< command counters (GS232_COMMAND up to GS232_UNKNOWN_COMMAND) */
+#define GS232_METRICS_ERRORS       4  /*!< error counters (GS232_FAIL up to GS232_BUFFERTOOSMALL) */
+#define GS232_METRICS_SAMPLING     64 /*!< one latency measure every GS232_METRICS_SAMPLING events of each kind (power of 2) */
+#define GS232_HISTOGRAM_SUB_BITS   2  /*!< sub-buckets per power of two (2^GS232_HISTOGRAM_SUB_BITS) */
+#define GS232_HISTOGRAM_BUCKETS    128 /*!< latency buckets (up to 2^33 ns, longer latencies on last bucket) */
+
+typedef struct gs232_s gs232_t;
+
+/**
+ * @enum GS232_METRICS_LATENCY
+ * @brief Latency histograms
+ *
+ */
+enum GS232_METRICS_LATENCY {
+    GS232_METRICS_PARSE,   /*!< gs232_parse_command, gs232_parse_binary */
+    GS232_METRICS_RESPOND, /*!< gs232_return_buffer, gs232_binary_reply */
+    GS232_METRICS_HOOK,    /*!< hardware functions (actuator, timed track, position reads) */
+    //-----------------------//
+    GS232_METRICS_LATENCIES
+};
+
+/**
+ * @typedef gs232_histogram_t
+ * @brief Log-linear latency histogram (ns)
+ *
+ */
+typedef struct gs232_histogram_s {
+    uint64_t events;                           /*!< measured and not measured events */
+    uint64_t count;                            /*!< measures */
+    uint64_t sum;                              /*!< sum of measures (ns) */
+    uint64_t buckets[GS232_HISTOGRAM_BUCKETS]; /*!< measures by bucket (gs232_histogram_bucket) */
+} gs232_histogram_t; /*!< histogram */
+
+/**
+ * @typedef gs232_metrics_t
+ * @brief Metrics counters
+ *
+ */
+typedef struct gs232_metrics_s {
+    uint64_t commands[GS232_METRICS_COMMANDS];         /*!< parsed commands by GS232_COMMAND */
+    uint64_t errors[GS232_METRICS_ERRORS];             /*!< parse errors by GS232_ERROR (index: error - GS232_FAIL) */
+    uint64_t bytes_in;                                 /*!< parsed bytes (frames) */
+    uint64_t bytes_out;                                /*!< response bytes */
+    gs232_histogram_t latency[GS232_METRICS_LATENCIES]; /*!< latency by GS232_METRICS_LATENCY */
+} gs232_metrics_t; /*!< metrics */
+
+/**
+ * @fn void gs232_metrics_command(gs232_t *ctx, uint8_t command, uint32_t bytes)
+ * @brief Count parsed command
+ *
+ * @param ctx gs232 context
+ * @param command Parsed command or GS232_ERROR
+ * @param bytes Frame length
+ */
+void gs232_metrics_command(gs232_t *ctx, uint8_t command, uint32_t bytes);
+
+/**
+ * @fn void gs232_metrics_error(gs232_t *ctx, uint8_t error)
+ * @brief Count reason of failed command
+ * @details For commands parsed as GS232_UNKNOWN_COMMAND by a values error.
+ *
+ * @param ctx gs232 context
+ * @param error GS232_ERROR
+ */
+void gs232_metrics_error(gs232_t *ctx, uint8_t error);
+
+/**
+ * @fn void gs232_metrics_response(gs232_t *ctx, uint32_t bytes)
+ * @brief Count response bytes
+ *
+ * @param ctx gs232 context
+ * @param bytes Response length
+ */
+void gs232_metrics_response(gs232_t *ctx, uint32_t bytes);
+
+/**
+ * @fn uint64_t gs232_metrics_begin(gs232_t *ctx, uint8_t latency)
+ * @brief Start of measured event
+ * @details Only one of GS232_METRICS_SAMPLING events reads the clock.
+ *
+ * @param ctx gs232 context
+ * @param latency GS232_METRICS_LATENCY
+ * @return Start time (ns), 0: not measured
+ */
+uint64_t gs232_metrics_begin(gs232_t *ctx, uint8_t latency);
+
+/**
+ * @fn void gs232_metrics_end(gs232_t *ctx, uint8_t latency, uint64_t start)
+ * @brief End of measured event
+ *
+ * @param ctx gs232 context
+ * @param latency GS232_METRICS_LATENCY
+ * @param start Result of gs232_metrics_begin
+ */
+void gs232_metrics_end(gs232_t *ctx, uint8_t latency, uint64_t start);
+
+/**
+ * @fn uint8_t gs232_metrics_snapshot(gs232_t *ctx, gs232_metrics_t *snapshot)
+ * @brief Copy of metrics
+ * @details Counters are read one by one without stopping writers: each value is exact, values of different counters
+ *          may differ by the events in progress.
+ *
+ * @param ctx gs232 context (NULL: global metrics of all contexts)
+ * @param snapshot Metrics
+ * @return Error
+ */
+uint8_t gs232_metrics_snapshot(gs232_t *ctx, gs232_metrics_t *snapshot);
+
+/**
+ * @fn uint8_t gs232_metrics_reset(gs232_t **ctx)
+ * @brief Clear context metrics
+ *
+ * @param ctx gs232 context
+ * @return Error
+ */
+uint8_t gs232_metrics_reset(gs232_t **ctx);
+
+/**
+ * @fn uint32_t gs232_histogram_bucket(uint64_t value)
+ * @brief Bucket of value
+ * @details Exact below 2^GS232_HISTOGRAM_SUB_BITS, then 2^GS232_HISTOGRAM_SUB_BITS buckets for every power of two
+ *          (relative error under 25%).
+ *
+ * @param value Latency (ns)
+ * @return Bucket
+ */
+uint32_t gs232_histogram_bucket(uint64_t value);
+
+/**
+ * @fn uint64_t gs232_histogram_lower(uint32_t bucket)
+ * @brief Lower bound of bucket
+ *
+ * @param bucket Bucket
+ * @return Latency (ns)
+ */
+uint64_t gs232_histogram_lower(uint32_t bucket);
+
+/**
+ * @fn uint64_t gs232_histogram_percentile(const gs232_histogram_t *histogram, double percentile)
+ * @brief Latency percentile
+ *
+ * @param histogram Histogram (snapshot)
+ * @param percentile Percentile (0 .. 100)
+ * @return Upper bound of bucket of percentile (ns), 0: no measures
+ */
+uint64_t gs232_histogram_percentile(const gs232_histogram_t *histogram, double percentile);
+
+#if GS232_METRICS
+#define GS232_METRIC(call) call /*!< metrics update */
+#define GS232_METRIC_BEGIN(ctx, latency) gs232_metrics_begin(ctx, latency)
+#else
+#define GS232_METRIC(call) do { if (0) { call; } } while (0)
+#define GS232_METRIC_BEGIN(ctx, latency) 0
+#endif
+
+#endif /* GS232_METRICS_H_ */
@@ -0,0 +1,227 @@
+/**
+ * @gs232_path.c
+ *
+ * @brief Path generation for libGS232
+ * @details Straight az/el and great circle paths on caller buffers or iterator
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "libGS232.h"
+#include "gs232_path.h"
+
+#define RAD_TO_DEG 57.29577951308232f
+#define DEG_TO_RAD 0.017453292519943295f
+
+// angle in (-180, 180]
+static inline float gs232_path_wrap(float angle) {
+    angle = fmodf(angle, 360);
+    if (angle > 180)
+        angle -= 360;
+    else if (angle <= -180)
+        angle += 360;
+
+    return angle;
+}
+
+// unit vector (east, north, up) of az/el
+static inline void gs232_path_vector(float azimuth, float elevation, float *vector) {
+    float cos_elevation = cosf(elevation * DEG_TO_RAD);
+
+    vector[0] = cos_elevation * sinf(azimuth * DEG_TO_RAD);
+    vector[1] = cos_elevation * cosf(azimuth * DEG_TO_RAD);
+    vector[2] = sinf(elevation * DEG_TO_RAD);
+}
+
+static inline float gs232_path_dot(const float *a, const float *b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+uint8_t gs232_path_init(gs232_path_t *path, float start_azimuth, float start_elevation, float end_azimuth, float end_elevation, float resolution) {
+    float azimuth_diff = end_azimuth - start_azimuth;
+    float elevation_diff = end_elevation - start_elevation;
+
+    if (resolution <= 0)
+        resolution = GS232_PATH_RESOLUTION;
+
+    path->start_azimuth = start_azimuth;
+    path->start_elevation = start_elevation;
+    path->end_azimuth = end_azimuth;
+    path->end_elevation = end_elevation;
+    path->distance = sqrtf(azimuth_diff * azimuth_diff + elevation_diff * elevation_diff);
+    path->heading = atan2f(azimuth_diff, elevation_diff) * RAD_TO_DEG;
+    if (path->heading < 0)
+        path->heading += 360;
+
+    path->points = (uint32_t) ceilf(path->distance / resolution);
+    path->step_azimuth = path->points == 0 ? 0 : azimuth_diff / path->points;
+    path->step_elevation = path->points == 0 ? 0 : elevation_diff / path->points;
+    path->next = 1;
+    path->mode = GS232_PATH_LINEAR;
+    path->flip = false;
+
+    return GS232_OK;
+}
+
+uint8_t gs232_path_init_spherical(gs232_path_t *path, float start_azimuth, float start_elevation, float end_azimuth, float end_elevation,
+        float resolution, bool flip) {
+    float end[3], east[3], up[3], norm, angle, cosine;
+
+    if (resolution <= 0)
+        resolution = GS232_PATH_RESOLUTION;
+
+    gs232_path_init(path, start_azimuth, start_elevation, end_azimuth, end_elevation, resolution);
+    path->mode = GS232_PATH_SPHERICAL;
+
+    gs232_path_vector(start_azimuth, start_elevation, path->origin);
+    gs232_path_vector(end_azimuth, end_elevation, end);
+
+    // tangent: component of end orthogonal to origin
+    cosine = gs232_path_dot(path->origin, end);
+    for (int n = 0; n < 3; n++)
+        path->tangent[n] = end[n] - cosine * path->origin[n];
+
+    norm = sqrtf(gs232_path_dot(path->tangent, path->tangent));
+    angle = atan2f(norm, cosine);
+
+    // antipodal (or same) positions: any great circle, through zenith when possible
+    if (norm < 1e-6f) {
+        const float zenith[3] = { 0, 0, 1 }, north[3] = { 0, 1, 0 };
+        const float *towards = fabsf(path->origin[2]) < 0.999f ? zenith : north;
+
+        cosine = gs232_path_dot(path->origin, towards);
+        for (int n = 0; n < 3; n++)
+            path->tangent[n] = towards[n] - cosine * path->origin[n];
+        norm = sqrtf(gs232_path_dot(path->tangent, path->tangent));
+    }
+
+    for (int n = 0; n < 3; n++)
+        path->tangent[n] /= norm;
+
+    path->distance = angle * RAD_TO_DEG;
+    path->points = path->distance < 1e-4f ? 0 : (uint32_t) ceilf(path->distance / resolution);
+    path->step_angle = path->points == 0 ? 0 : angle / path->points;
+    path->step_azimuth = path->step_elevation = 0;
+
+    // initial course on local east/up basis of start
+    east[0] = cosf(start_azimuth * DEG_TO_RAD);
+    east[1] = -sinf(start_azimuth * DEG_TO_RAD);
+    east[2] = 0;
+    for (int n = 0; n < 3; n++)
+        up[n] = (n == 2 ? 1.0f : 0.0f) - path->origin[2] * path->origin[n];
+    path->heading = atan2f(gs232_path_dot(path->tangent, east), gs232_path_dot(path->tangent, up)) * RAD_TO_DEG;
+    if (path->heading < 0)
+        path->heading += 360;
+
+    // flip only passes through zenith: elsewhere the fold would be a slew of its own
+    if (flip) {
+        float top = atan2f(path->tangent[2], path->origin[2]);
+        float highest = path->origin[2];
+
+        if (top > 0 && top < angle)
+            highest = cosf(top) * path->origin[2] + sinf(top) * path->tangent[2];
+        else if (end[2] > highest)
+            highest = end[2];
+
+        flip = asinf(highest > 1 ? 1 : highest) * RAD_TO_DEG >= GS232_PATH_FLIP_ELEVATION;
+    }
+
+    path->flip = flip;
+    path->reference = flip ? start_azimuth + gs232_path_wrap(end_azimuth + 180 - start_azimuth) / 2 : start_azimuth;
+
+    return GS232_OK;
+}
+
+static uint32_t gs232_path_fill_spherical(const gs232_path_t *path, uint32_t first, uint32_t count, float *azimuth, float *elevation) {
+    double angle = (double) first * path->step_angle, sine = sin(angle), cosine = cos(angle);
+    double sine_step = sin(path->step_angle), cosine_step = cos(path->step_angle), rotated;
+
+    // angle of next point by rotation recurrence (no trigonometry per point)
+
+    for (uint32_t n = 0; n < count; n++) {
+        float x = (float) cosine * path->origin[0] + (float) sine * path->tangent[0];
+        float y = (float) cosine * path->origin[1] + (float) sine * path->tangent[1];
+        float z = (float) cosine * path->origin[2] + (float) sine * path->tangent[2];
+        float point_azimuth = atan2f(x, y) * RAD_TO_DEG;
+        float point_elevation = asinf(z > 1 ? 1 : (z < -1 ? -1 : z)) * RAD_TO_DEG;
+        float offset = gs232_path_wrap(point_azimuth - path->reference);
+
+        if (path->flip && fabsf(offset) > 90) {
+            offset = gs232_path_wrap(offset + 180);
+            point_elevation = 180 - point_elevation;
+        }
+
+        azimuth[n] = path->reference + offset;
+        elevation[n] = point_elevation;
+
+        rotated = cosine * cosine_step - sine * sine_step;
+        sine = sine * cosine_step + cosine * sine_step;
+        cosine = rotated;
+    }
+
+    return count;
+}
+
+uint32_t gs232_path_fill(const gs232_path_t *path, uint32_t first, uint32_t count, float *azimuth, float *elevation) {
+    uint32_t n = 0;
+
+    if (first > path->points)
+        return 0;
+
+    if (count > path->points + 1 - first)
+        count = path->points + 1 - first;
+
+    if (path->mode == GS232_PATH_SPHERICAL)
+        return gs232_path_fill_spherical(path, first, count, azimuth, elevation);
+
+#if defined(__GNUC__)
+    // four points per step (SoA)
+    typedef float gs232_v4sf __attribute__((vector_size(16)));
+    const gs232_v4sf lane = { 0, 1, 2, 3 };
+    const gs232_v4sf step_azimuth = { path->step_azimuth, path->step_azimuth, path->step_azimuth, path->step_azimuth };
+    const gs232_v4sf step_elevation = { path->step_elevation, path->step_elevation, path->step_elevation, path->step_elevation };
+    const gs232_v4sf start_azimuth = { path->start_azimuth, path->start_azimuth, path->start_azimuth, path->start_azimuth };
+    const gs232_v4sf start_elevation = { path->start_elevation, path->start_elevation, path->start_elevation, path->start_elevation };
+
+    for (; n + 4 <= count; n += 4) {
+        float k = (float) (first + n);
+        gs232_v4sf index = lane + (gs232_v4sf ) { k, k, k, k };
+        gs232_v4sf value;
+
+        value = start_azimuth + index * step_azimuth;
+        memcpy(azimuth + n, &value, sizeof(value));
+        value = start_elevation + index * step_elevation;
+        memcpy(elevation + n, &value, sizeof(value));
+    }
+#endif
+
+    for (; n < count; n++) {
+        azimuth[n] = path->start_azimuth + (first + n) * path->step_azimuth;
+        elevation[n] = path->start_elevation + (first + n) * path->step_elevation;
+    }
+
+    // last point is exactly the end
+    if (count != 0 && first + count - 1 == path->points && path->points != 0) {
+        azimuth[count - 1] = path->end_azimuth;
+        elevation[count - 1] = path->end_elevation;
+    }
+
+    return count;
+}
+
+bool gs232_path_next(gs232_path_t *path, float *azimuth, float *elevation) {
+    if (path->next > path->points)
+        return false;
+
+    gs232_path_fill(path, path->next++, 1, azimuth, elevation);
+    return true;
+}
@@ -0,0 +1,120 @@
+/**
+ * @gs232_path.h
+ *
+ * @brief Path generation for libGS232
+ * @details Straight az/el paths between two positions, without allocation: points are written on caller buffers
+ *          (structure of arrays, vectorized fill) or produced one by one with an iterator.
+ *          Point k is start + k * step (k = 0: start, k = points: end), step is at most the requested resolution.
+ *          Spherical paths follow the great circle (slerp of unit vectors) at constant angular speed, optionally with flipped
+ *          points (azimuth - 180, 180 - elevation) to pass through zenith without azimuth slew.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#ifndef GS232_PATH_H_
+#define GS232_PATH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define GS232_PATH_RESOLUTION     1.0f  /*!< default resolution (degrees between points) */
+#define GS232_PATH_FLIP_ELEVATION 80.0f /*!< spherical: minimum elevation reached by a path to be flipped */
+
+/**
+ * @enum GS232_PATH_MODE
+ * @brief Interpolation
+ *
+ */
+enum GS232_PATH_MODE {
+    GS232_PATH_LINEAR,    /*!< straight line on az/el plane */
+    GS232_PATH_SPHERICAL, /*!< great circle (slerp) */
+};
+
+/**
+ * @typedef gs232_path_t
+ * @brief Path
+ *
+ */
+typedef struct gs232_path_s {
+       float start_azimuth;   /*!< start azimuth */
+       float start_elevation; /*!< start elevation */
+       float end_azimuth;     /*!< end azimuth */
+       float end_elevation;   /*!< end elevation */
+       float step_azimuth;    /*!< azimuth step between points */
+       float step_elevation;  /*!< elevation step between points */
+       float heading;         /*!< direction of travel on az/el plane (degrees, 0: elevation up, 90: azimuth clockwise) */
+       float distance;        /*!< path length (degrees) */
+    uint32_t points;          /*!< points after start (last one is end, 0: start == end) */
+    uint32_t next;            /*!< next point of iterator */
+     uint8_t mode;            /*!< interpolation (GS232_PATH_MODE) */
+        bool flip;            /*!< spherical: points farther than 90 degrees of reference azimuth are flipped (elevation > 90) */
+       float reference;       /*!< spherical: azimuth around which points are unwrapped (and flipped) */
+       float origin[3];       /*!< spherical: start unit vector (east, north, up) */
+       float tangent[3];      /*!< spherical: unit vector orthogonal to origin on the great circle towards end */
+       float step_angle;      /*!< spherical: angle between points (radians) */
+} gs232_path_t; /*!< path */
+
+/**
+ * @fn uint8_t gs232_path_init(gs232_path_t *path, float start_azimuth, float start_elevation, float end_azimuth, float end_elevation,
+ *          float resolution)
+ * @brief Initialize path (and iterator)
+ *
+ * @param path Path
+ * @param start_azimuth Start azimuth
+ * @param start_elevation Start elevation
+ * @param end_azimuth End azimuth
+ * @param end_elevation End elevation
+ * @param resolution Maximum degrees between points (<= 0: GS232_PATH_RESOLUTION)
+ * @return GS232_ERROR
+ */
+uint8_t gs232_path_init(gs232_path_t *path, float start_azimuth, float start_elevation, float end_azimuth, float end_elevation, float resolution);
+
+/**
+ * @fn uint8_t gs232_path_init_spherical(gs232_path_t *path, float start_azimuth, float start_elevation, float end_azimuth,
+ *          float end_elevation, float resolution, bool flip)
+ * @brief Initialize great circle path (and iterator). Elevations over 90 are accepted (flipped positions)
+ * @details Without flip azimuths are unwrapped around start azimuth. With flip, paths reaching GS232_PATH_FLIP_ELEVATION keep
+ *          azimuths within 90 degrees of the mean of start azimuth and flipped end azimuth, so a pass through zenith is a single
+ *          elevation sweep from 0 to 180 (lower paths are not flipped).
+ *
+ * @param path Path
+ * @param start_azimuth Start azimuth
+ * @param start_elevation Start elevation
+ * @param end_azimuth End azimuth
+ * @param end_elevation End elevation
+ * @param resolution Maximum degrees between points (<= 0: GS232_PATH_RESOLUTION)
+ * @param flip Flip mode (path->flip: applied)
+ * @return GS232_ERROR
+ */
+uint8_t gs232_path_init_spherical(gs232_path_t *path, float start_azimuth, float start_elevation, float end_azimuth, float end_elevation,
+        float resolution, bool flip);
+
+/**
+ * @fn uint32_t gs232_path_fill(const gs232_path_t *path, uint32_t first, uint32_t count, float *azimuth, float *elevation)
+ * @brief Write points first .. first + count - 1 on caller buffers (clipped to end point)
+ *
+ * @param path Path
+ * @param first First point (0: start)
+ * @param count Points to write (buffers size)
+ * @param azimuth Azimuth buffer
+ * @param elevation Elevation buffer
+ * @return Written points
+ */
+uint32_t gs232_path_fill(const gs232_path_t *path, uint32_t first, uint32_t count, float *azimuth, float *elevation);
+
+/**
+ * @fn bool gs232_path_next(gs232_path_t *path, float *azimuth, float *elevation)
+ * @brief Next point of path (1 .. points)
+ *
+ * @param path Path
+ * @param azimuth Azimuth
+ * @param elevation Elevation
+ * @return false: path finished
+ */
+bool gs232_path_next(gs232_path_t *path, float *azimuth, float *elevation);
+
+#endif /* GS232_PATH_H_ */
@@ -0,0 +1,356 @@
+/**
+ * @gs232_persist.c
+ *
+ * @brief Persistent context state for libGS232
+ * @details Memory mapped state file with two checksummed slots written alternately.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libGS232.h"
+#include "gs232_memory.h"
+#include "gs232_track.h"
+#include "gs232_position.h"
+#include "gs232_trajectory.h"
+#include "gs232_persist.h"
+
+/*
+ * File: header page, then two slots (page aligned). A slot is valid when both checksums match, the valid slot with the
+ * highest sequence is the state. Host byte order.
+ */
+typedef struct gs232_persist_header_s {
+        char magic[8];     /*!< GS232_PERSIST_MAGIC */
+    uint32_t version;      /*!< GS232_PERSIST_VERSION */
+    uint32_t slot_size;    /*!< sizeof(gs232_persist_slot_t) */
+    uint32_t stride;       /*!< slot offset step */
+    uint32_t points;       /*!< MEMORY_POINTS */
+} gs232_persist_header_t;
+
+typedef struct gs232_persist_state_s {
+    uint64_t sequence;             /*!< update sequence (0: never written) */
+    uint64_t generation;           /*!< generation of values */
+     int64_t track_start;          /*!< timed track start (CLOCK_REALTIME ns) */
+    uint32_t crc;                  /*!< checksum of state (computed with crc = 0) */
+    uint32_t memory_crc;           /*!< checksum of values */
+    uint16_t azimuth;              /*!< last azimuth */
+    uint16_t elevation;            /*!< last elevation */
+    uint16_t memory_qty;           /*!< values */
+    uint16_t memory_current_point; /*!< executed points of timed track */
+     uint8_t b_protocol;           /*!< is GS-232B */
+     uint8_t is_450_degrees;       /*!< is 450 degrees mode */
+     uint8_t azimuth_nord_south;   /*!< center */
+     uint8_t rotation_speed;       /*!< rotation speed */
+     uint8_t track_command;        /*!< timed track command on values (GS232_UNKNOWN_COMMAND: none) */
+     uint8_t track_running;        /*!< timed track running */
+     uint8_t reserved[6];
+} gs232_persist_state_t;
+
+typedef struct gs232_persist_slot_s {
+    gs232_persist_state_t state;         /*!< state, written last */
+                 uint16_t memory[MEMORY_POINTS]; /*!< values */
+} gs232_persist_slot_t;
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void gs232_persist_crc_table(void) {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xedb88320U ^ (c >> 1) : c >> 1;
+        crc_table[n] = c;
+    }
+}
+
+uint32_t gs232_persist_crc32(uint32_t crc, const void *data, size_t len) {
+    const uint8_t *p = data;
+
+    pthread_once(&crc_once, gs232_persist_crc_table);
+
+    crc = ~crc;
+    while (len--)
+        crc = crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+    return ~crc;
+}
+
+static uint64_t gs232_persist_realtime(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline gs232_persist_slot_t* gs232_persist_slot(gs232_persist_t *persist, uint8_t slot) {
+    return (gs232_persist_slot_t*) ((char*) persist->map + persist->stride * (1 + slot));
+}
+
+static uint32_t gs232_persist_state_crc(const gs232_persist_state_t *state) {
+    gs232_persist_state_t copy = *state;
+
+    copy.crc = 0;
+    return gs232_persist_crc32(0, &copy, sizeof(copy));
+}
+
+static bool gs232_persist_valid(const gs232_persist_slot_t *slot) {
+    return slot->state.sequence != 0 && slot->state.crc == gs232_persist_state_crc(&slot->state) && slot->state.memory_qty <= MEMORY_POINTS
+            && slot->state.memory_crc == gs232_persist_crc32(0, slot->memory, slot->state.memory_qty * sizeof(uint16_t));
+}
+
+static void gs232_persist_restore(gs232_persist_t *persist, gs232_t **ctx, const gs232_persist_slot_t *slot) {
+    const gs232_persist_state_t *state = &slot->state;
+    gs232_t *context = *ctx;
+    uint16_t *memory, size, points;
+    uint64_t now, elapsed, end, realtime;
+
+    context->b_protocol = state->b_protocol;
+    context->is_450_degrees = state->is_450_degrees;
+    context->azimuth_nord_south = state->azimuth_nord_south;
+    context->rotation_speed = state->rotation_speed;
+    gs232_position_set(ctx, state->azimuth, state->elevation);
+
+    if (state->memory_qty != 0) {
+        if (state->memory_qty <= GS232_MEMORY_INLINE) {
+            memory = context->memory_inline[context->memory == context->memory_inline[0] ? 1 : 0];
+            size = GS232_MEMORY_INLINE;
+        } else if ((memory = gs232_memory_acquire(context->allocator, state->memory_qty, &size)) == NULL)
+            return;
+
+        memcpy(memory, slot->memory, state->memory_qty * sizeof(uint16_t));
+        gs232_memory_publish(ctx, memory, size, state->memory_qty, state->track_command);
+        if (state->track_command != GS232_UNKNOWN_COMMAND)
+            gs232_trajectory_build(ctx);
+    }
+
+    persist->memory_sequence = __atomic_load_n(&context->memory_sequence, __ATOMIC_RELAXED);
+    persist->memory_crc = state->memory_crc;
+
+    points = gs232_track_points(context);
+    if (!state->track_running || points == 0)
+        return;
+
+    // on schedule: elapsed wall clock time since start (start may be before the monotonic clock origin, tick arithmetic wraps)
+    now = gs232_now();
+    realtime = gs232_persist_realtime();
+    elapsed = realtime > (uint64_t) state->track_start ? realtime - (uint64_t) state->track_start : 0;
+    end = context->trajectory != NULL ? (context->trajectory->samples - 1) * context->trajectory->period
+                                      : (points - 1) * (uint64_t) context->memory[0] * 1000000000ULL;
+
+    pthread_mutex_lock(&context->track.lock);
+    if (elapsed > end) {
+        __atomic_store_n(&context->memory_current_point, points, __ATOMIC_RELAXED);
+    } else {
+        context->track.start = now - elapsed;
+        context->track.next = now;
+        __atomic_store_n(&context->memory_current_point, state->memory_current_point, __ATOMIC_RELAXED);
+        __atomic_store_n(&context->track.running, true, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&context->track.lock);
+}
+
+uint8_t gs232_persist_open(gs232_persist_t *persist, gs232_t **ctx, const char *path, bool sync, bool *restored) {
+    gs232_persist_header_t *header, expected;
+    gs232_persist_slot_t *slots[2];
+    gs232_memory_snapshot_t snapshot;
+    struct stat st;
+    long page = sysconf(_SC_PAGESIZE);
+    int current = -1;
+
+    if (restored != NULL)
+        *restored = false;
+
+    memset(persist, 0, sizeof(gs232_persist_t));
+    persist->sync = sync;
+    persist->ctx = *ctx;
+    persist->stride = (sizeof(gs232_persist_slot_t) + page - 1) / page * page;
+    persist->size = 3 * persist->stride;
+
+    memset(&expected, 0, sizeof(expected));
+    memcpy(expected.magic, GS232_PERSIST_MAGIC, sizeof(expected.magic));
+    expected.version = GS232_PERSIST_VERSION;
+    expected.slot_size = sizeof(gs232_persist_slot_t);
+    expected.stride = persist->stride;
+    expected.points = MEMORY_POINTS;
+
+    if ((persist->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644)) < 0)
+        return GS232_FAIL;
+
+    if (fstat(persist->fd, &st) < 0 || ((size_t) st.st_size != persist->size && ftruncate(persist->fd, persist->size) < 0)) {
+        close(persist->fd);
+        return GS232_FAIL;
+    }
+
+    persist->map = mmap(NULL, persist->size, PROT_READ | PROT_WRITE, MAP_SHARED, persist->fd, 0);
+    if (persist->map == MAP_FAILED) {
+        close(persist->fd);
+        return GS232_FAIL;
+    }
+
+    header = persist->map;
+    slots[0] = gs232_persist_slot(persist, 0);
+    slots[1] = gs232_persist_slot(persist, 1);
+
+    if ((size_t) st.st_size != persist->size || memcmp(header, &expected, sizeof(expected)) != 0) {
+        // new file or other layout: start empty
+        memset(&slots[0]->state, 0, sizeof(gs232_persist_state_t));
+        memset(&slots[1]->state, 0, sizeof(gs232_persist_state_t));
+        memcpy(header, &expected, sizeof(expected));
+        msync(persist->map, persist->size, MS_SYNC);
+    } else {
+        for (int n = 0; n < 2; n++) {
+            if (!gs232_persist_valid(slots[n]))
+                continue;
+
+            persist->slot_generation[n] = slots[n]->state.generation;
+            if (current < 0 || slots[n]->state.sequence > slots[current]->state.sequence)
+                current = n;
+        }
+    }
+
+    if (current >= 0) {
+        persist->slot = current;
+        persist->sequence = slots[current]->state.sequence;
+        // generations grow with sequence: the restored values are the newest generation
+        persist->generation = slots[current]->state.generation;
+        gs232_persist_restore(persist, ctx, slots[current]);
+
+        if (restored != NULL)
+            *restored = true;
+    } else {
+        // no slot holds values: first update copies them
+        persist->slot = 1;
+        persist->generation = 1;
+        persist->memory_sequence = __atomic_load_n(&(*ctx)->memory_sequence, __ATOMIC_RELAXED);
+        gs232_memory_snapshot(*ctx, &snapshot);
+        persist->memory_crc = gs232_persist_crc32(0, snapshot.memory, snapshot.qty * sizeof(uint16_t));
+    }
+
+    (*ctx)->persist = persist;
+
+    return GS232_OK;
+}
+
+uint8_t gs232_persist_close(gs232_persist_t *persist) {
+    if (persist->map == NULL)
+        return GS232_OK;
+
+    if (persist->ctx != NULL && persist->ctx->persist == persist)
+        persist->ctx->persist = NULL;
+
+    msync(persist->map, persist->size, MS_SYNC);
+    munmap(persist->map, persist->size);
+    close(persist->fd);
+    persist->map = NULL;
+
+    return GS232_OK;
+}
+
+bool gs232_persist_changed(gs232_t *ctx, uint8_t command) {
+    switch (command) {
+        case GS232_CW_CCW_ROTATION_STOP:
+        case GS232_UP_DOWN_DIRECTION_ROTATION_STOP:
+        case GS232_TURN_DEGREES_AZIMUTH:
+        case GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH:
+        case GS232_TURN_DEGREES_AZIMUTH_AND_ELEVATION:
+        case GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH_AND_ELEVATION:
+        case GS232_START_COMMAND_IN_TIME_INTERVAL:
+        case GS232_ROTATION_SPEED_LOW:
+        case GS232_ROTATION_SPEED_MIDDLE1:
+        case GS232_ROTATION_SPEED_MIDDLE2:
+        case GS232_ROTATION_SPEED_HIGH:
+        case GS232_ALL_STOP:
+        case GS232_AZIMUTH_TO_360:
+        case GS232_AZIMUTH_TO_450:
+        case GS232_TOGGLE_AZIMUTH_NORD_SOUTH:
+            return true;
+
+        default:
+            // values uploaded by other commands (e.g. binary frames)
+            return ctx->persist->memory_sequence != __atomic_load_n(&ctx->memory_sequence, __ATOMIC_RELAXED);
+    }
+}
+
+uint8_t gs232_persist_save(gs232_t **ctx) {
+    gs232_t *context = *ctx;
+    gs232_persist_t *persist = context->persist;
+    gs232_memory_snapshot_t snapshot;
+    gs232_persist_state_t state;
+    gs232_persist_slot_t *slot;
+    uint32_t memory_sequence;
+    uint64_t start, now;
+    uint8_t target;
+
+    if (persist == NULL)
+        return GS232_FAIL;
+
+    target = persist->slot ^ 1;
+    slot = gs232_persist_slot(persist, target);
+    memset(&state, 0, sizeof(state));
+
+    // memory is published by the parser thread (this thread): the snapshot is the current memory
+    gs232_memory_read_lock(context);
+    gs232_memory_snapshot(context, &snapshot);
+    memory_sequence = __atomic_load_n(&context->memory_sequence, __ATOMIC_RELAXED);
+    if (memory_sequence != persist->memory_sequence) {
+        persist->memory_sequence = memory_sequence;
+        persist->memory_crc = gs232_persist_crc32(0, snapshot.memory, snapshot.qty * sizeof(uint16_t));
+        persist->generation++;
+    }
+
+    if (persist->slot_generation[target] != persist->generation) {
+        memcpy(slot->memory, snapshot.memory, snapshot.qty * sizeof(uint16_t));
+        persist->slot_generation[target] = persist->generation;
+    }
+    gs232_memory_read_unlock(context);
+
+    gs232_position_get(context, &state.azimuth, &state.elevation);
+    state.generation = persist->generation;
+    state.memory_crc = persist->memory_crc;
+    state.memory_qty = snapshot.qty;
+    state.track_command = snapshot.command;
+    state.b_protocol = context->b_protocol;
+    state.is_450_degrees = __atomic_load_n(&context->is_450_degrees, __ATOMIC_RELAXED);
+    state.azimuth_nord_south = __atomic_load_n(&context->azimuth_nord_south, __ATOMIC_RELAXED);
+    state.rotation_speed = __atomic_load_n(&context->rotation_speed, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&context->track.lock);
+    state.track_running = context->track.running;
+    state.memory_current_point = __atomic_load_n(&context->memory_current_point, __ATOMIC_RELAXED);
+    start = context->track.start;
+    pthread_mutex_unlock(&context->track.lock);
+
+    if (state.track_running) {
+        now = gs232_now();
+        state.track_start = (int64_t) (gs232_persist_realtime() - (now - start));
+    }
+    state.sequence = persist->sequence + 1;
+    state.crc = gs232_persist_state_crc(&state);
+
+    // values are complete before the state that validates them
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&slot->state, &state, sizeof(state));
+
+    if (persist->sync && msync(slot, sizeof(gs232_persist_slot_t), MS_SYNC) < 0)
+        return GS232_FAIL;
+
+    persist->sequence = state.sequence;
+    persist->slot = target;
+
+    return GS232_OK;
+}
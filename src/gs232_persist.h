@@ -0,0 +1,105 @@
+/**
+ * @gs232_persist.h
+ *
+ * @brief Persistent context state for libGS232
+ * @details Modes, rotation speed, uploaded values and timed track of a context kept on a memory mapped file. The file has two
+ *          slots written alternately, each with a sequence number and checksums: an update is written on the older slot and
+ *          its header last, a crash while writing leaves the previous slot as the valid state. Running timed tracks are saved
+ *          with their wall clock start and resume on schedule.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#ifndef GS232_PERSIST_H_
+#define GS232_PERSIST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libGS232.h"
+
+#define GS232_PERSIST_MAGIC   "GS232PST" /*!< file magic */
+#define GS232_PERSIST_VERSION 1          /*!< file version (other versions are not restored) */
+
+/**
+ * @typedef gs232_persist_t
+ * @brief Persistent state file
+ *
+ */
+typedef struct gs232_persist_s {
+         int fd;                    /*!< state file */
+        void *map;                  /*!< file mapping */
+      size_t size;                  /*!< file size */
+      size_t stride;                /*!< slot offset step (page aligned) */
+        bool sync;                  /*!< every update is written to storage before returning (msync) */
+     uint8_t slot;                  /*!< slot of last update */
+    uint64_t sequence;              /*!< sequence of last update */
+    uint64_t generation;            /*!< generation of context memory values */
+    uint64_t slot_generation[2];    /*!< generation of memory values on each slot */
+    uint32_t memory_sequence;       /*!< context memory sequence of generation */
+    uint32_t memory_crc;            /*!< checksum of generation values */
+     gs232_t *ctx;                  /*!< context */
+} gs232_persist_t; /*!< persistent state */
+
+/**
+ * @fn uint8_t gs232_persist_open(gs232_persist_t *persist, gs232_t **ctx, const char *path, bool sync, bool *restored)
+ * @brief Map state file and restore context from it
+ * @details A missing file, a file of other version or a file without valid slots is initialized and the context is not
+ *          changed. After this call the library saves the context state after every command that changes it.
+ *
+ * @param persist Persistent state
+ * @param ctx Context (initialized, before commands)
+ * @param path State file
+ * @param sync Write every update to storage before returning (power loss safe, slower)
+ * @param restored Context state was restored (may be NULL)
+ * @return GS232_ERROR
+ */
+uint8_t gs232_persist_open(gs232_persist_t *persist, gs232_t **ctx, const char *path, bool sync, bool *restored);
+
+/**
+ * @fn uint8_t gs232_persist_close(gs232_persist_t *persist)
+ * @brief Unmap state file (state is kept)
+ *
+ * @param persist Persistent state
+ * @return GS232_ERROR
+ */
+uint8_t gs232_persist_close(gs232_persist_t *persist);
+
+/**
+ * @fn uint8_t gs232_persist_save(gs232_t **ctx)
+ * @brief Save context state
+ * @details Called by the parser thread after commands that change state (see gs232_persist_changed). Values are copied only
+ *          when they changed since the slot was written.
+ *
+ * @param ctx Context
+ * @return GS232_ERROR
+ */
+uint8_t gs232_persist_save(gs232_t **ctx);
+
+/**
+ * @fn bool gs232_persist_changed(gs232_t *ctx, uint8_t command)
+ * @brief Parsed command changed persistent state
+ *
+ * @param ctx Context
+ * @param command Parsed command or GS232_ERROR
+ * @return true: state must be saved (modes, speed, values or timed track changed)
+ */
+bool gs232_persist_changed(gs232_t *ctx, uint8_t command);
+
+/**
+ * @fn uint32_t gs232_persist_crc32(uint32_t crc, const void *data, size_t len)
+ * @brief CRC-32 (IEEE 802.3)
+ *
+ * @param crc Previous crc (0 on first block)
+ * @param data Data
+ * @param len Data length
+ * @return CRC
+ */
+uint32_t gs232_persist_crc32(uint32_t crc, const void *data, size_t len);
+
+#endif /* GS232_PERSIST_H_ */
@@ -0,0 +1,86 @@
+/**
+ * @gs232_planner.c
+ *
+ * @brief Azimuth route planner for libGS232
+ * @details Minimum time routes inside the mechanical range (360/450 degrees, north/south center)
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "libGS232.h"
+#include "gs232_position.h"
+#include "gs232_planner.h"
+
+// range of context mode: counter clockwise stop direction and span
+static inline void gs232_planner_range(gs232_t *ctx, uint16_t *stop, uint16_t *span) {
+    *stop = __atomic_load_n(&ctx->azimuth_nord_south, __ATOMIC_RELAXED) ? 0 : 180;
+    *span = __atomic_load_n(&ctx->is_450_degrees, __ATOMIC_RELAXED) ? 450 : 360;
+}
+
+uint16_t gs232_planner_mechanical(gs232_t *ctx, uint16_t azimuth) {
+    uint16_t stop, span, mechanical;
+
+    gs232_planner_range(ctx, &stop, &span);
+
+    // second turn values are mechanical positions (same value space on both centers)
+    if (azimuth >= 360)
+        return azimuth > span ? span : azimuth;
+
+    mechanical = (azimuth + 360 - stop) % 360;
+    return mechanical > span ? span : mechanical;
+}
+
+uint16_t gs232_planner_value(gs232_t *ctx, uint16_t mechanical) {
+    uint16_t stop, span;
+
+    gs232_planner_range(ctx, &stop, &span);
+
+    if (mechanical > span)
+        mechanical = span;
+
+    // past the first turn: value is the mechanical position (360 .. 450), never above the mode limit
+    return mechanical >= 360 ? mechanical : (stop + mechanical) % 360;
+}
+
+uint16_t gs232_planner_azimuth(gs232_t *ctx, uint16_t current, uint16_t target, int16_t *travel) {
+    uint16_t stop, span, from, best;
+
+    gs232_planner_range(ctx, &stop, &span);
+
+    from = gs232_planner_mechanical(ctx, current);
+
+    if (target >= 360 && target <= span) {
+        // explicit second turn position (M400 on 450 degrees mode): not routed
+        best = gs232_planner_mechanical(ctx, target);
+    } else {
+        best = (target % 360 + 360 - stop) % 360;
+
+        // same direction on the second turn (overlap, or the clockwise stop)
+        if (best + 360 <= span && abs(best + 360 - from) < abs(best - from))
+            best += 360;
+    }
+
+    if (travel != NULL)
+        *travel = (int16_t) best - (int16_t) from;
+
+    return gs232_planner_value(ctx, best);
+}
+
+uint16_t gs232_planner_target(gs232_t *ctx, uint16_t target) {
+    uint16_t azimuth, elevation;
+
+    // cached read (up to position max age): targets of every tick don't cost a hardware read
+    gs232_position_sample(&ctx, gs232_now(), true, false);
+    gs232_position_get(ctx, &azimuth, &elevation);
+
+    return gs232_planner_azimuth(ctx, azimuth, target, NULL);
+}
@@ -0,0 +1,70 @@
+/**
+ * @gs232_planner.h
+ *
+ * @brief Azimuth route planner for libGS232
+ * @details Chooses the minimum time route to an azimuth inside the mechanical range of the rotator.
+ *          The mechanical range starts at the counter clockwise stop and spans 360 or 450 (P45) degrees, the stop is at south
+ *          with north center and at north with south center (Z). Azimuths of hardware functions and timed tracks are
+ *          degrees clockwise from north plus 360 on the second turn of the range, so every mechanical position has one value
+ *          (e.g. 370 is north-east past the overlap with south center and 450 degrees).
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#ifndef GS232_PLANNER_H_
+#define GS232_PLANNER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libGS232.h"
+
+/**
+ * @fn uint16_t gs232_planner_mechanical(gs232_t *ctx, uint16_t azimuth)
+ * @brief Mechanical position (degrees from counter clockwise stop) of an azimuth value
+ * @details Values 0 .. 359 are directions, values from 360 are the mechanical position past the first turn (with south center
+ *          360 + direction, with north center 360 .. 450 are directions 180 .. 270 of the overlap).
+ *
+ * @param ctx Context (mode and center)
+ * @param azimuth Azimuth (0 .. 360 or 450)
+ * @return Mechanical position (0 .. 360 or 450)
+ */
+uint16_t gs232_planner_mechanical(gs232_t *ctx, uint16_t azimuth);
+
+/**
+ * @fn uint16_t gs232_planner_value(gs232_t *ctx, uint16_t mechanical)
+ * @brief Azimuth value of a mechanical position
+ *
+ * @param ctx Context (mode and center)
+ * @param mechanical Mechanical position (degrees from counter clockwise stop)
+ * @return Azimuth (0 .. 360 or 450, second turn: mechanical position)
+ */
+uint16_t gs232_planner_value(gs232_t *ctx, uint16_t mechanical);
+
+/**
+ * @fn uint16_t gs232_planner_azimuth(gs232_t *ctx, uint16_t current, uint16_t target, int16_t *travel)
+ * @brief Minimum time route from current position to target direction
+ *
+ * @param ctx Context (mode and center)
+ * @param current Current azimuth
+ * @param target Target azimuth (direction, or explicit second turn position from 360 up to the mode limit)
+ * @param travel Mechanical travel (degrees, positive clockwise). Can be NULL
+ * @return Azimuth to command
+ */
+uint16_t gs232_planner_azimuth(gs232_t *ctx, uint16_t current, uint16_t target, int16_t *travel);
+
+/**
+ * @fn uint16_t gs232_planner_target(gs232_t *ctx, uint16_t target)
+ * @brief Route from current position (get_azimuth read cached up to position max age, or context position) to target direction
+ *
+ * @param ctx Context
+ * @param target Target azimuth
+ * @return Azimuth to command
+ */
+uint16_t gs232_planner_target(gs232_t *ctx, uint16_t target);
+
+#endif /* GS232_PLANNER_H_ */
@@ -0,0 +1,141 @@
+/**
+ * @gs232_position.c
+ *
+ * @brief Position cache for libGS232
+ * @details Cached reads of get_azimuth/get_elevation hardware functions
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libGS232.h"
+#include "gs232_trace.h"
+#include "gs232_seqlock.h"
+#include "gs232_position.h"
+#include "gs232_metrics.h"
+#include "gs232_capture.h"
+
+// a read newer than now (made by a concurrent poller) is not stale
+static inline bool gs232_position_stale(gs232_t *ctx, uint64_t now, bool valid, uint64_t time) {
+    return !valid || (time <= now && now - time >= __atomic_load_n(&ctx->position.max_age, __ATOMIC_RELAXED));
+}
+
+uint8_t gs232_position_max_age(gs232_t **ctx, uint64_t max_age) {
+    __atomic_store_n(&(*ctx)->position.max_age, max_age, __ATOMIC_RELAXED);
+
+    return GS232_OK;
+}
+
+uint8_t gs232_position_invalidate(gs232_t **ctx) {
+    __atomic_store_n(&(*ctx)->position.azimuth_valid, false, __ATOMIC_RELAXED);
+    __atomic_store_n(&(*ctx)->position.elevation_valid, false, __ATOMIC_RELAXED);
+
+    return GS232_OK;
+}
+
+uint8_t gs232_position_get(gs232_t *ctx, uint16_t *azimuth, uint16_t *elevation) {
+    uint32_t sequence;
+
+    do {
+        sequence = gs232_seqlock_read_begin(&ctx->position.sequence);
+        *azimuth = __atomic_load_n(&ctx->azimuth, __ATOMIC_RELAXED);
+        *elevation = __atomic_load_n(&ctx->elevation, __ATOMIC_RELAXED);
+    } while (gs232_seqlock_read_retry(&ctx->position.sequence, sequence));
+
+    return GS232_OK;
+}
+
+uint8_t gs232_position_set(gs232_t **ctx, uint16_t azimuth, uint16_t elevation) {
+    gs232_seqlock_write_begin(&(*ctx)->position.sequence);
+    __atomic_store_n(&(*ctx)->azimuth, azimuth, __ATOMIC_RELAXED);
+    __atomic_store_n(&(*ctx)->elevation, elevation, __ATOMIC_RELAXED);
+    gs232_seqlock_write_end(&(*ctx)->position.sequence);
+
+    if ((*ctx)->capture.log != NULL)
+        gs232_capture_position(*ctx, azimuth, elevation, 3);
+
+    return GS232_OK;
+}
+
+uint8_t gs232_position_sample(gs232_t **ctx, uint64_t now, bool azimuth, bool elevation) {
+    gs232_t *context = *ctx;
+    uint16_t azimuth_value = 0, elevation_value = 0;
+    uint32_t read = 0;
+    uint64_t start;
+
+    azimuth = azimuth && context->fn.get_azimuth != NULL
+            && gs232_position_stale(context, now, __atomic_load_n(&context->position.azimuth_valid, __ATOMIC_RELAXED),
+                    __atomic_load_n(&context->position.azimuth_time, __ATOMIC_RELAXED));
+    elevation = elevation && context->fn.get_elevation != NULL
+            && gs232_position_stale(context, now, __atomic_load_n(&context->position.elevation_valid, __ATOMIC_RELAXED),
+                    __atomic_load_n(&context->position.elevation_time, __ATOMIC_RELAXED));
+
+    if (!azimuth && !elevation)
+        return GS232_OK;
+
+    // one sampler at a time: concurrent pollers report the cached position (or wait for the first read)
+    while (__atomic_exchange_n(&context->position.sampling, true, __ATOMIC_ACQUIRE)) {
+        if ((!azimuth || __atomic_load_n(&context->position.azimuth_valid, __ATOMIC_RELAXED))
+                && (!elevation || __atomic_load_n(&context->position.elevation_valid, __ATOMIC_RELAXED)))
+            return GS232_OK;
+
+        gs232_seqlock_pause();
+    }
+
+    // the previous sampler may have read the hardware since the check above
+    azimuth = azimuth
+            && gs232_position_stale(context, now, __atomic_load_n(&context->position.azimuth_valid, __ATOMIC_RELAXED),
+                    __atomic_load_n(&context->position.azimuth_time, __ATOMIC_RELAXED));
+    elevation = elevation
+            && gs232_position_stale(context, now, __atomic_load_n(&context->position.elevation_valid, __ATOMIC_RELAXED),
+                    __atomic_load_n(&context->position.elevation_time, __ATOMIC_RELAXED));
+
+    if (!azimuth && !elevation) {
+        __atomic_store_n(&context->position.sampling, false, __ATOMIC_RELEASE);
+        return GS232_OK;
+    }
+
+    start = GS232_METRIC_BEGIN(context, GS232_METRICS_HOOK);
+    if (azimuth) {
+        azimuth_value = context->fn.get_azimuth();
+        read |= 1;
+    }
+
+    if (elevation) {
+        elevation_value = context->fn.get_elevation();
+        read |= 2;
+    }
+    GS232_METRIC(gs232_metrics_end(context, GS232_METRICS_HOOK, start));
+
+    gs232_seqlock_write_begin(&context->position.sequence);
+    if (azimuth)
+        __atomic_store_n(&context->azimuth, azimuth_value, __ATOMIC_RELAXED);
+    if (elevation)
+        __atomic_store_n(&context->elevation, elevation_value, __ATOMIC_RELAXED);
+    gs232_seqlock_write_end(&context->position.sequence);
+
+    if (azimuth) {
+        __atomic_store_n(&context->position.azimuth_time, now, __ATOMIC_RELAXED);
+        __atomic_store_n(&context->position.azimuth_valid, true, __ATOMIC_RELAXED);
+    }
+
+    if (elevation) {
+        __atomic_store_n(&context->position.elevation_time, now, __ATOMIC_RELAXED);
+        __atomic_store_n(&context->position.elevation_valid, true, __ATOMIC_RELAXED);
+    }
+
+    __atomic_store_n(&context->position.sampling, false, __ATOMIC_RELEASE);
+
+    if (context->capture.log != NULL)
+        gs232_capture_position(context, azimuth_value, elevation_value, read);
+
+    GS232_TRACE(GS232_TRACE_DEBUG, GS232_TRACE_EVENT_POSITION, context, read, (uint32_t) azimuth_value << 16 | elevation_value);
+    return GS232_OK;
+}
@@ -0,0 +1,81 @@
+/**
+ * @gs232_position.h
+ *
+ * @brief Position cache for libGS232
+ * @details Position replies (C, C2, B) read azimuth and elevation from get_azimuth/get_elevation hardware functions.
+ *          Reads are cached on context and reused up to a maximum age, so polling bursts cost one hardware read.
+ *          Without hardware functions azimuth and elevation of context are reported as set by the application.
+ *          Azimuth and elevation are published under a sequence lock: any thread can read them with gs232_position_get
+ *          while a hardware thread updates them with gs232_position_set.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#ifndef GS232_POSITION_H_
+#define GS232_POSITION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libGS232.h"
+
+#define GS232_POSITION_MAX_AGE 100000000ULL /*!< default maximum age of hardware reads (ns) */
+
+/**
+ * @fn uint8_t gs232_position_max_age(gs232_t **ctx, uint64_t max_age)
+ * @brief Set maximum age of cached hardware reads
+ *
+ * @param ctx Context
+ * @param max_age Maximum age (ns, 0: read hardware on every reply)
+ * @return GS232_ERROR
+ */
+uint8_t gs232_position_max_age(gs232_t **ctx, uint64_t max_age);
+
+/**
+ * @fn uint8_t gs232_position_invalidate(gs232_t **ctx)
+ * @brief Discard cached hardware reads (next reply reads hardware)
+ *
+ * @param ctx Context
+ * @return GS232_ERROR
+ */
+uint8_t gs232_position_invalidate(gs232_t **ctx);
+
+/**
+ * @fn uint8_t gs232_position_get(gs232_t *ctx, uint16_t *azimuth, uint16_t *elevation)
+ * @brief Consistent read of azimuth and elevation of context (never blocks writers)
+ *
+ * @param ctx Context
+ * @param azimuth Azimuth
+ * @param elevation Elevation
+ * @return GS232_ERROR
+ */
+uint8_t gs232_position_get(gs232_t *ctx, uint16_t *azimuth, uint16_t *elevation);
+
+/**
+ * @fn uint8_t gs232_position_set(gs232_t **ctx, uint16_t azimuth, uint16_t elevation)
+ * @brief Publish azimuth and elevation of context (e.g. from a hardware thread without get functions)
+ *
+ * @param ctx Context
+ * @param azimuth Azimuth
+ * @param elevation Elevation
+ * @return GS232_ERROR
+ */
+uint8_t gs232_position_set(gs232_t **ctx, uint16_t azimuth, uint16_t elevation);
+
+/**
+ * @fn uint8_t gs232_position_sample(gs232_t **ctx, uint64_t now, bool azimuth, bool elevation)
+ * @brief Refresh azimuth and/or elevation of context from hardware functions when cached reads are older than maximum age
+ *
+ * @param ctx Context
+ * @param now Current time (ns)
+ * @param azimuth Refresh azimuth
+ * @param elevation Refresh elevation
+ * @return GS232_ERROR
+ */
+uint8_t gs232_position_sample(gs232_t **ctx, uint64_t now, bool azimuth, bool elevation);
+
+#endif /* GS232_POSITION_H_ */
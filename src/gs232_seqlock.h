@@ -0,0 +1,96 @@
+/**
+ * @gs232_seqlock.h
+ *
+ * @brief Sequence locks for libGS232
+ * @details Readers never block writers: a reader copies the protected fields and retries when a writer was active.
+ *          Writers exclude each other with a compare and swap on the sequence (odd: write in progress).
+ *          Protected fields are accessed with relaxed atomics.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#ifndef GS232_SEQLOCK_H_
+#define GS232_SEQLOCK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+static inline void gs232_seqlock_pause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/**
+ * @fn uint32_t gs232_seqlock_read_begin(const uint32_t *sequence)
+ * @brief Start read section (waits for an active writer)
+ *
+ * @param sequence Sequence
+ * @return Sequence for gs232_seqlock_read_retry
+ */
+static inline uint32_t gs232_seqlock_read_begin(const uint32_t *sequence) {
+    uint32_t start;
+
+    while ((start = __atomic_load_n(sequence, __ATOMIC_ACQUIRE)) & 1)
+        gs232_seqlock_pause();
+
+    return start;
+}
+
+/**
+ * @fn bool gs232_seqlock_read_retry(const uint32_t *sequence, uint32_t start)
+ * @brief End read section
+ *
+ * @param sequence Sequence
+ * @param start Sequence from gs232_seqlock_read_begin
+ * @return true: fields changed while reading, read again
+ */
+static inline bool gs232_seqlock_read_retry(const uint32_t *sequence, uint32_t start) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(sequence, __ATOMIC_RELAXED) != start;
+}
+
+/**
+ * @fn bool gs232_seqlock_write_try(uint32_t *sequence)
+ * @brief Start write section if no other writer is active
+ *
+ * @param sequence Sequence
+ * @return true: write section started
+ */
+static inline bool gs232_seqlock_write_try(uint32_t *sequence) {
+    uint32_t start = __atomic_load_n(sequence, __ATOMIC_RELAXED);
+
+    if ((start & 1) || !__atomic_compare_exchange_n(sequence, &start, start + 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return false;
+
+    // odd sequence is visible before any protected field
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @fn void gs232_seqlock_write_begin(uint32_t *sequence)
+ * @brief Start write section
+ *
+ * @param sequence Sequence
+ */
+static inline void gs232_seqlock_write_begin(uint32_t *sequence) {
+    while (!gs232_seqlock_write_try(sequence))
+        gs232_seqlock_pause();
+}
+
+/**
+ * @fn void gs232_seqlock_write_end(uint32_t *sequence)
+ * @brief End write section
+ *
+ * @param sequence Sequence
+ */
+static inline void gs232_seqlock_write_end(uint32_t *sequence) {
+    __atomic_fetch_add(sequence, 1, __ATOMIC_RELEASE);
+}
+
+#endif /* GS232_SEQLOCK_H_ */
@@ -0,0 +1,386 @@
+/**
+ * @gs232_server.c
+ *
+ * @brief Multiple rotator server for libGS232
+ * @details Event driven (epoll) server
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "libGS232.h"
+#include "gs232_track.h"
+#include "gs232_server.h"
+#include "gs232_binary.h"
+#include "gs232_capture.h"
+
+static uint8_t gs232_server_events(gs232_server_t *server, gs232_connection_t *connection, uint32_t events) {
+    struct epoll_event ev;
+
+    if (connection->events == events)
+        return GS232_OK;
+
+    ev.events = events;
+    ev.data.ptr = connection;
+    if (epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, connection->fd, &ev) < 0)
+        return GS232_FAIL;
+
+    connection->events = events;
+    return GS232_OK;
+}
+
+static uint8_t gs232_server_connection(gs232_server_t *server, int fd, bool listener, gs232_connection_t **connection) {
+    gs232_connection_t *conn;
+    struct epoll_event ev;
+    int flags;
+
+    if (server->connections_qty >= server->connections_max)
+        return GS232_TOOMANYVALUES;
+
+    if ((flags = fcntl(fd, F_GETFL)) < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+        return GS232_FAIL;
+
+    if ((conn = gs232_alloc(NULL, sizeof(gs232_connection_t))) == NULL)
+        return GS232_FAIL;
+
+    memset(conn, 0, sizeof(gs232_connection_t));
+
+    conn->fd = fd;
+    if (!listener) {
+        if (server->gateway != NULL)
+            conn->ctx = server->gateway->ctx;
+        else if (gs232_init(&conn->ctx) != GS232_OK) {
+            gs232_free(NULL, conn, sizeof(gs232_connection_t));
+            return GS232_FAIL;
+        }
+
+        if ((conn->output = gs232_alloc(NULL, GS232_SERVER_OUTPUT_SIZE)) == NULL) {
+            if (server->gateway == NULL)
+                gs232_deinit(&conn->ctx);
+            gs232_free(NULL, conn, sizeof(gs232_connection_t));
+            return GS232_FAIL;
+        }
+    }
+
+    conn->events = EPOLLIN;
+    ev.events = conn->events;
+    ev.data.ptr = conn;
+    if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        if (server->gateway == NULL)
+            gs232_deinit(&conn->ctx);
+        gs232_free(NULL, conn->output, GS232_SERVER_OUTPUT_SIZE);
+        gs232_free(NULL, conn, sizeof(gs232_connection_t));
+        return GS232_FAIL;
+    }
+
+    conn->index = server->connections_qty;
+    server->connections[server->connections_qty++] = conn;
+
+    if (connection != NULL)
+        *connection = conn;
+
+    return GS232_OK;
+}
+
+// write pending responses: GS232_OK all written, GS232_BUFFERTOOSMALL pending, GS232_FAIL error
+static uint8_t gs232_server_flush(gs232_connection_t *connection) {
+    ssize_t w;
+
+    while (connection->output_pos < connection->output_len) {
+        w = write(connection->fd, connection->output + connection->output_pos, connection->output_len - connection->output_pos);
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            return GS232_FAIL;
+        }
+
+        connection->output_pos += w;
+    }
+
+    if (connection->output_pos == connection->output_len) {
+        connection->output_pos = connection->output_len = 0;
+        return GS232_OK;
+    }
+
+    // keep free space at end
+    memmove(connection->output, connection->output + connection->output_pos, connection->output_len - connection->output_pos);
+    connection->output_len -= connection->output_pos;
+    connection->output_pos = 0;
+
+    return GS232_BUFFERTOOSMALL;
+}
+
+static void gs232_server_track(gs232_server_t *server, gs232_connection_t *connection, uint64_t now) {
+    uint64_t next;
+
+    if (!gs232_track_running(connection->ctx))
+        return;
+
+    gs232_track_tick(&connection->ctx, now, &next);
+    if (next < server->next)
+        server->next = next;
+}
+
+// parse and respond, received bytes not processed are kept until responses are written
+static uint8_t gs232_server_process(gs232_server_t *server, gs232_connection_t *connection, const char *data, uint32_t data_len) {
+    uint32_t used, response_len;
+    uint8_t res;
+
+    while (data_len > 0) {
+        if (GS232_SERVER_OUTPUT_SIZE - connection->output_len < GS232_RESPONSE_MAX) {
+            if ((res = gs232_server_flush(connection)) == GS232_FAIL)
+                return GS232_FAIL;
+
+            // at most one read is pending: reading stops until responses are written
+            if (res == GS232_BUFFERTOOSMALL) {
+                if (connection->input == NULL && (connection->input = gs232_alloc(NULL, GS232_SERVER_READ_SIZE)) == NULL)
+                    return GS232_FAIL;
+
+                memmove(connection->input, data, data_len);
+                connection->input_len = data_len;
+
+                return gs232_server_events(server, connection, EPOLLOUT);
+            }
+        }
+
+        // shared context: stream and arbitration of this connection
+        if (server->gateway != NULL)
+            gs232_gateway_begin(server->gateway, &connection->stream, connection, connection->priority);
+
+        // records of this connection
+        if (connection->session != 0)
+            gs232_capture_switch(&connection->ctx, connection->session);
+        else if (server->capture != NULL) {
+            if (connection->ctx->capture.log == NULL)
+                gs232_capture_attach(&connection->ctx, server->capture, server->gateway);
+            connection->session = gs232_capture_connect(&connection->ctx, connection->priority);
+        }
+
+        // protocol of connection from its first byte
+        if (gs232_binary_detect(&connection->ctx, data, data_len))
+            res = gs232_binary_batch(&connection->ctx, data, data_len, &used, connection->output + connection->output_len,
+                    GS232_SERVER_OUTPUT_SIZE - connection->output_len, &response_len);
+        else
+            res = gs232_stream_batch(&connection->ctx, data, data_len, &used, connection->output + connection->output_len,
+                    GS232_SERVER_OUTPUT_SIZE - connection->output_len, &response_len);
+
+        if (server->gateway != NULL)
+            gs232_gateway_end(server->gateway, &connection->stream);
+
+        if (res == GS232_FAIL)
+            return GS232_FAIL;
+
+        connection->output_len += response_len;
+        data += used;
+        data_len -= used;
+    }
+
+    gs232_server_track(server, connection, gs232_now());
+
+    if ((res = gs232_server_flush(connection)) == GS232_FAIL)
+        return GS232_FAIL;
+
+    return gs232_server_events(server, connection, res == GS232_OK ? EPOLLIN : EPOLLOUT);
+}
+
+static uint8_t gs232_server_readable(gs232_server_t *server, gs232_connection_t *connection) {
+    ssize_t r;
+
+    r = read(connection->fd, server->read_buffer, GS232_SERVER_READ_SIZE);
+    if (r < 0)
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? GS232_OK : GS232_FAIL;
+
+    if (r == 0)
+        return GS232_FAIL;
+
+    return gs232_server_process(server, connection, server->read_buffer, r);
+}
+
+static uint8_t gs232_server_writable(gs232_server_t *server, gs232_connection_t *connection) {
+    uint32_t input_len;
+    uint8_t res;
+
+    if ((res = gs232_server_flush(connection)) != GS232_OK)
+        return res == GS232_FAIL ? GS232_FAIL : GS232_OK;
+
+    if (connection->input_len == 0)
+        return gs232_server_events(server, connection, EPOLLIN);
+
+    input_len = connection->input_len;
+    connection->input_len = 0;
+
+    return gs232_server_process(server, connection, connection->input, input_len);
+}
+
+static void gs232_server_accept(gs232_server_t *server, gs232_connection_t *listener) {
+    gs232_connection_t *connection;
+    int fd;
+
+    while ((fd = accept4(listener->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        if (gs232_server_connection(server, fd, false, &connection) != GS232_OK) {
+            close(fd);
+            continue;
+        }
+
+        if (server->on_connect != NULL)
+            server->on_connect(connection, server->arg);
+    }
+}
+
+uint8_t gs232_server_init(gs232_server_t **server, uint32_t max_connections) {
+    if ((*server = gs232_alloc(NULL, sizeof(gs232_server_t))) == NULL)
+        return GS232_FAIL;
+
+    memset(*server, 0, sizeof(gs232_server_t));
+    (*server)->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    (*server)->connections = gs232_alloc(NULL, max_connections * sizeof(gs232_connection_t*));
+    (*server)->read_buffer = gs232_alloc(NULL, GS232_SERVER_READ_SIZE);
+    (*server)->connections_max = max_connections;
+    (*server)->next = GS232_TRACK_IDLE;
+
+    if ((*server)->epoll_fd < 0 || (*server)->connections == NULL || (*server)->read_buffer == NULL) {
+        gs232_server_deinit(server);
+        return GS232_FAIL;
+    }
+
+    return GS232_OK;
+}
+
+uint8_t gs232_server_deinit(gs232_server_t **server) {
+    if (*server == NULL)
+        return GS232_OK;
+
+    while ((*server)->connections_qty > 0)
+        gs232_server_remove(server, (*server)->connections[(*server)->connections_qty - 1]);
+
+    if ((*server)->epoll_fd >= 0)
+        close((*server)->epoll_fd);
+
+    gs232_free(NULL, (*server)->connections, (*server)->connections_max * sizeof(gs232_connection_t*));
+    gs232_free(NULL, (*server)->read_buffer, GS232_SERVER_READ_SIZE);
+    gs232_free(NULL, *server, sizeof(gs232_server_t));
+    *server = NULL;
+
+    return GS232_OK;
+}
+
+uint8_t gs232_server_add(gs232_server_t **server, int fd, gs232_connection_t **connection) {
+    return gs232_server_connection(*server, fd, false, connection);
+}
+
+uint8_t gs232_server_listen(gs232_server_t **server, int fd) {
+    return gs232_server_connection(*server, fd, true, NULL);
+}
+
+uint8_t gs232_server_gateway(gs232_server_t **server, gs232_gateway_t *gateway) {
+    for (uint32_t c = 0; c < (*server)->connections_qty; c++)
+        if ((*server)->connections[c]->ctx != NULL)
+            return GS232_FAIL;
+
+    (*server)->gateway = gateway;
+    return GS232_OK;
+}
+
+uint8_t gs232_server_capture(gs232_server_t **server, gs232_capture_t *capture) {
+    (*server)->capture = capture;
+    return GS232_OK;
+}
+
+uint8_t gs232_server_remove(gs232_server_t **server, gs232_connection_t *connection) {
+    gs232_server_t *srv = *server;
+    gs232_connection_t *last;
+
+    if (connection->ctx != NULL && srv->on_disconnect != NULL)
+        srv->on_disconnect(connection, srv->arg);
+
+    epoll_ctl(srv->epoll_fd, EPOLL_CTL_DEL, connection->fd, NULL);
+    close(connection->fd);
+
+    last = srv->connections[--srv->connections_qty];
+    srv->connections[connection->index] = last;
+    last->index = connection->index;
+
+    if (connection->session != 0)
+        gs232_capture_disconnect(&connection->ctx, connection->session);
+
+    if (srv->gateway != NULL && connection->ctx != NULL)
+        gs232_gateway_leave(srv->gateway, &connection->stream, connection);
+    else
+        gs232_deinit(&connection->ctx);
+    gs232_free(NULL, connection->output, GS232_SERVER_OUTPUT_SIZE);
+    gs232_free(NULL, connection->input, GS232_SERVER_READ_SIZE);
+    gs232_free(NULL, connection, sizeof(gs232_connection_t));
+
+    return GS232_OK;
+}
+
+int gs232_server_run(gs232_server_t **server, int timeout_ms) {
+    gs232_server_t *srv = *server;
+    struct epoll_event events[64];
+    gs232_connection_t *connection;
+    uint64_t now = gs232_now();
+    int n, track_ms;
+    uint8_t res;
+
+    if (srv->next != GS232_TRACK_IDLE) {
+        track_ms = (srv->next <= now) ? 0 : (int) ((srv->next - now + 999999) / 1000000);
+        if (timeout_ms < 0 || track_ms < timeout_ms)
+            timeout_ms = track_ms;
+    }
+
+    n = epoll_wait(srv->epoll_fd, events, sizeof(events) / sizeof(events[0]), timeout_ms);
+    if (n < 0)
+        return errno == EINTR ? 0 : -1;
+
+    for (int e = 0; e < n; e++) {
+        connection = events[e].data.ptr;
+
+        if (connection->ctx == NULL) {
+            gs232_server_accept(srv, connection);
+            continue;
+        }
+
+        res = GS232_OK;
+        if (events[e].events & EPOLLOUT)
+            res = gs232_server_writable(srv, connection);
+
+        if (res == GS232_OK && (events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && connection->events == EPOLLIN)
+            res = gs232_server_readable(srv, connection);
+
+        if (res == GS232_FAIL)
+            gs232_server_remove(server, connection);
+    }
+
+    // timed tracks
+    now = gs232_now();
+    if (srv->next != GS232_TRACK_IDLE && now >= srv->next) {
+        srv->next = GS232_TRACK_IDLE;
+        for (uint32_t c = 0; c < srv->connections_qty; c++)
+            if (srv->connections[c]->ctx != NULL) {
+                gs232_server_track(srv, srv->connections[c], now);
+                // one context for all connections
+                if (srv->gateway != NULL)
+                    break;
+            }
+    }
+
+    return n;
+}
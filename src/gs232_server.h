@@ -0,0 +1,160 @@
+/**
+ * @gs232_server.h
+ *
+ * @brief Multiple rotator server for libGS232
+ * @details Event driven (epoll) server: every pty, serial port or socket has its own context, non-blocking I/O
+ *          and its own responses buffer. Timed tracks of all contexts are executed from the same loop.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#ifndef GS232_SERVER_H_
+#define GS232_SERVER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libGS232.h"
+#include "gs232_gateway.h"
+#include "gs232_capture.h"
+
+#define GS232_SERVER_READ_SIZE   65536                     /*!< read size */
+#define GS232_SERVER_OUTPUT_SIZE (16 * GS232_RESPONSE_MAX) /*!< responses buffer size per connection */
+
+/**
+ * @typedef gs232_connection_t
+ * @brief Server connection
+ *
+ */
+typedef struct gs232_connection_s {
+         int fd;         /*!< file descriptor */
+     gs232_t *ctx;       /*!< context (NULL on listener) */
+    uint32_t index;      /*!< index on server connections */
+    uint32_t events;     /*!< epoll events */
+        char *output;    /*!< responses not written */
+    uint32_t output_pos; /*!< first response byte not written */
+    uint32_t output_len; /*!< responses length */
+        char *input;     /*!< received bytes not processed (responses buffer full, GS232_SERVER_READ_SIZE) */
+    uint32_t input_len;  /*!< received bytes not processed length */
+        void *user;      /*!< user data */
+    gs232_stream_t stream; /*!< client stream (gateway) */
+     uint8_t priority;   /*!< arbitration priority (gateway, GS232_GATEWAY_PRIORITY) */
+    uint32_t session;    /*!< capture session (0: not started) */
+} gs232_connection_t; /*!< connection */
+
+/**
+ * @fn void (*gs232_server_callback)(gs232_connection_t *connection, void *arg)
+ * @brief Connection event
+ *
+ * @param connection Connection
+ * @param arg User argument
+ */
+typedef void (*gs232_server_callback)(gs232_connection_t *connection, void *arg);
+
+/**
+ * @typedef gs232_server_t
+ * @brief Server
+ *
+ */
+typedef struct gs232_server_s {
+                      int epoll_fd;        /*!< epoll */
+      gs232_connection_t **connections;    /*!< connections */
+                 uint32_t connections_qty; /*!< connections used */
+                 uint32_t connections_max; /*!< maximum connections */
+                 uint64_t next;            /*!< nearest timed track deadline */
+                     char *read_buffer;    /*!< read buffer */
+    gs232_server_callback on_connect;      /*!< accepted connection (configure context here) */
+    gs232_server_callback on_disconnect;   /*!< connection closed */
+                     void *arg;            /*!< callbacks user argument */
+          gs232_gateway_t *gateway;        /*!< context shared by all connections (NULL: a context per connection) */
+          gs232_capture_t *capture;        /*!< capture log of connections (NULL: not captured) */
+} gs232_server_t; /*!< server */
+
+/**
+ * @fn uint8_t gs232_server_init(gs232_server_t **server, uint32_t max_connections)
+ * @brief Initialize server
+ *
+ * @param server Server
+ * @param max_connections Maximum connections (listeners included)
+ * @return GS232_ERROR
+ */
+uint8_t gs232_server_init(gs232_server_t **server, uint32_t max_connections);
+
+/**
+ * @fn uint8_t gs232_server_deinit(gs232_server_t **server)
+ * @brief Destroy server, close all connections
+ *
+ * @param server Server
+ * @return GS232_ERROR
+ */
+uint8_t gs232_server_deinit(gs232_server_t **server);
+
+/**
+ * @fn uint8_t gs232_server_add(gs232_server_t **server, int fd, gs232_connection_t **connection)
+ * @brief Serve a rotator on fd (pty, serial port, connected socket) with a new context. Server owns fd
+ *
+ * @param server Server
+ * @param fd File descriptor
+ * @param connection New connection (configure connection->ctx)
+ * @return GS232_ERROR
+ */
+uint8_t gs232_server_add(gs232_server_t **server, int fd, gs232_connection_t **connection);
+
+/**
+ * @fn uint8_t gs232_server_listen(gs232_server_t **server, int fd)
+ * @brief Accept connections from listening socket, each one with a new context (see on_connect). Server owns fd
+ *
+ * @param server Server
+ * @param fd Listening socket
+ * @return GS232_ERROR
+ */
+uint8_t gs232_server_listen(gs232_server_t **server, int fd);
+
+/**
+ * @fn uint8_t gs232_server_gateway(gs232_server_t **server, gs232_gateway_t *gateway)
+ * @brief Serve the context of gateway on every connection added or accepted after this call (gs232_gateway.h)
+ * @details Connections keep their own stream and protocol. The shared context is not destroyed with the connections.
+ *
+ * @param server Server
+ * @param gateway Initialized gateway (NULL: a new context per connection)
+ * @return GS232_ERROR (GS232_FAIL if there are connections)
+ */
+uint8_t gs232_server_gateway(gs232_server_t **server, gs232_gateway_t *gateway);
+
+/**
+ * @fn uint8_t gs232_server_capture(gs232_server_t **server, gs232_capture_t *capture)
+ * @brief Capture I/O of connections (gs232_capture.h)
+ * @details Every connection is a capture session, started on its first data: contexts configured on on_connect or after
+ *          gs232_server_add are recorded with that configuration.
+ *
+ * @param server Server
+ * @param capture Open capture log (NULL: stop capture of new sessions)
+ * @return GS232_ERROR
+ */
+uint8_t gs232_server_capture(gs232_server_t **server, gs232_capture_t *capture);
+
+/**
+ * @fn uint8_t gs232_server_remove(gs232_server_t **server, gs232_connection_t *connection)
+ * @brief Close connection and destroy its context
+ *
+ * @param server Server
+ * @param connection Connection
+ * @return GS232_ERROR
+ */
+uint8_t gs232_server_remove(gs232_server_t **server, gs232_connection_t *connection);
+
+/**
+ * @fn int gs232_server_run(gs232_server_t **server, int timeout_ms)
+ * @brief Wait and process I/O events and timed tracks once
+ *
+ * @param server Server
+ * @param timeout_ms Maximum wait (ms, -1: until event or track deadline)
+ * @return Processed events, -1 on error
+ */
+int gs232_server_run(gs232_server_t **server, int timeout_ms);
+
+#endif /* GS232_SERVER_H_ */
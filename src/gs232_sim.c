@@ -0,0 +1,286 @@
+/**
+ * @gs232_sim.c
+ *
+ * @brief Rotator simulator for libGS232
+ * @details Motor, stops, backlash and noise model behind the hardware functions, on a virtual clock
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "libGS232.h"
+#include "gs232_planner.h"
+#include "gs232_sim.h"
+
+#define NS_PER_SECOND 1000000000ULL
+
+static gs232_sim_t *gs232_sim_bound;
+
+static uint64_t gs232_sim_real(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * NS_PER_SECOND + ts.tv_nsec;
+}
+
+static inline float gs232_sim_span(gs232_sim_t *sim) {
+    return __atomic_load_n(&sim->ctx->is_450_degrees, __ATOMIC_RELAXED) ? 450 : 360;
+}
+
+// motor towards target within rate and acceleration, shaft within backlash, stops
+static void gs232_sim_axis_step(gs232_sim_axis_t *axis, float dt, float rate, float stop, float backlash) {
+    float error = axis->target - axis->motor;
+    float velocity = copysignf(fminf(rate, sqrtf(2 * GS232_SIM_ACCEL * fabsf(error))), error);
+
+    if (velocity > axis->velocity + GS232_SIM_ACCEL * dt)
+        velocity = axis->velocity + GS232_SIM_ACCEL * dt;
+    if (velocity < axis->velocity - GS232_SIM_ACCEL * dt)
+        velocity = axis->velocity - GS232_SIM_ACCEL * dt;
+
+    // settled
+    if (fabsf(error) < 0.05f && fabsf(velocity) <= GS232_SIM_ACCEL * dt) {
+        axis->motor = axis->target;
+        velocity = 0;
+    }
+
+    axis->velocity = velocity;
+    axis->motor += velocity * dt;
+
+    if (axis->motor < 0 || axis->motor > stop) {
+        axis->motor = axis->motor < 0 ? 0 : stop;
+        axis->velocity = 0;
+    }
+
+    if (axis->motor - axis->shaft > backlash / 2)
+        axis->shaft = axis->motor - backlash / 2;
+    else if (axis->shaft - axis->motor > backlash / 2)
+        axis->shaft = axis->motor + backlash / 2;
+}
+
+static inline bool gs232_sim_axis_idle(const gs232_sim_axis_t *axis) {
+    return axis->velocity == 0 && axis->motor == axis->target;
+}
+
+// integrate axes up to virtual now (locked)
+static void gs232_sim_update(gs232_sim_t *sim, uint64_t now) {
+    uint8_t speed = __atomic_load_n(&sim->ctx->rotation_speed, __ATOMIC_RELAXED);
+    float span = gs232_sim_span(sim), dt = (float) GS232_SIM_STEP / NS_PER_SECOND;
+
+    while (sim->updated + GS232_SIM_STEP <= now) {
+        // long idle periods (days of passes) cost nothing
+        if (gs232_sim_axis_idle(&sim->azimuth) && gs232_sim_axis_idle(&sim->elevation)) {
+            sim->updated = now;
+            break;
+        }
+
+        gs232_sim_axis_step(&sim->azimuth, dt, GS232_SIM_AZIMUTH_RATE * speed, span, sim->backlash);
+        gs232_sim_axis_step(&sim->elevation, dt, GS232_SIM_ELEVATION_RATE * speed, 180, sim->backlash);
+        sim->updated += GS232_SIM_STEP;
+    }
+}
+
+// sensor: calibrated shaft position with uniform noise (xorshift)
+static float gs232_sim_sensor(gs232_sim_t *sim, const gs232_sim_axis_t *axis) {
+    sim->seed ^= sim->seed << 13;
+    sim->seed ^= sim->seed >> 17;
+    sim->seed ^= sim->seed << 5;
+
+    return (axis->shaft - axis->offset) * axis->gain + sim->noise * ((float) sim->seed / UINT32_MAX * 2 - 1);
+}
+
+///////////////// hardware functions /////////////////
+
+static uint8_t gs232_sim_set_azimuth(uint16_t azimuth) {
+    gs232_sim_t *sim = gs232_sim_bound;
+
+    if (sim == NULL)
+        return 1;
+
+    pthread_mutex_lock(&sim->lock);
+    gs232_sim_update(sim, gs232_sim_clock());
+    sim->azimuth.target = gs232_planner_mechanical(sim->ctx, azimuth);
+    pthread_mutex_unlock(&sim->lock);
+
+    return 0;
+}
+
+static uint16_t gs232_sim_get_azimuth(void) {
+    gs232_sim_t *sim = gs232_sim_bound;
+    float azimuth;
+
+    if (sim == NULL)
+        return 0;
+
+    pthread_mutex_lock(&sim->lock);
+    gs232_sim_update(sim, gs232_sim_clock());
+    azimuth = gs232_sim_sensor(sim, &sim->azimuth);
+    pthread_mutex_unlock(&sim->lock);
+
+    azimuth = fminf(fmaxf(roundf(azimuth), 0), gs232_sim_span(sim));
+    return gs232_planner_value(sim->ctx, (uint16_t) azimuth);
+}
+
+static uint8_t gs232_sim_set_elevation(uint16_t elevation) {
+    gs232_sim_t *sim = gs232_sim_bound;
+
+    if (sim == NULL)
+        return 1;
+
+    pthread_mutex_lock(&sim->lock);
+    gs232_sim_update(sim, gs232_sim_clock());
+    sim->elevation.target = elevation > 180 ? 180 : elevation;
+    pthread_mutex_unlock(&sim->lock);
+
+    return 0;
+}
+
+static uint16_t gs232_sim_get_elevation(void) {
+    gs232_sim_t *sim = gs232_sim_bound;
+    float elevation;
+
+    if (sim == NULL)
+        return 0;
+
+    pthread_mutex_lock(&sim->lock);
+    gs232_sim_update(sim, gs232_sim_clock());
+    elevation = gs232_sim_sensor(sim, &sim->elevation);
+    pthread_mutex_unlock(&sim->lock);
+
+    return (uint16_t) fminf(fmaxf(roundf(elevation), 0), 180);
+}
+
+// offset calibration: rotator at counter clockwise stop (horizon) reads 0
+static bool gs232_sim_calibrate_offset(gs232_sim_axis_t *axis) {
+    gs232_sim_t *sim = gs232_sim_bound;
+
+    pthread_mutex_lock(&sim->lock);
+    gs232_sim_update(sim, gs232_sim_clock());
+    axis->offset = axis->shaft;
+    sim->calibrations++;
+    pthread_mutex_unlock(&sim->lock);
+
+    return true;
+}
+
+// full scale calibration: rotator at clockwise stop (elevation: 180) reads full scale
+static bool gs232_sim_calibrate_full_scale(gs232_sim_axis_t *axis, float full_scale) {
+    gs232_sim_t *sim = gs232_sim_bound;
+    bool res = false;
+
+    pthread_mutex_lock(&sim->lock);
+    gs232_sim_update(sim, gs232_sim_clock());
+    if (axis->shaft - axis->offset > 1) {
+        axis->gain = full_scale / (axis->shaft - axis->offset);
+        res = true;
+    }
+    sim->calibrations++;
+    pthread_mutex_unlock(&sim->lock);
+
+    return res;
+}
+
+static bool gs232_sim_offset_calibration_azimuth(gs232_t **ctx) {
+    return gs232_sim_bound != NULL && gs232_sim_calibrate_offset(&gs232_sim_bound->azimuth);
+}
+
+static bool gs232_sim_offset_calibration_elevation(gs232_t **ctx) {
+    return gs232_sim_bound != NULL && gs232_sim_calibrate_offset(&gs232_sim_bound->elevation);
+}
+
+static bool gs232_sim_full_scale_calibration_azimuth(gs232_t **ctx) {
+    return gs232_sim_bound != NULL && gs232_sim_calibrate_full_scale(&gs232_sim_bound->azimuth, gs232_sim_span(gs232_sim_bound));
+}
+
+static bool gs232_sim_full_scale_calibration_elevation(gs232_t **ctx) {
+    return gs232_sim_bound != NULL && gs232_sim_calibrate_full_scale(&gs232_sim_bound->elevation, 180);
+}
+
+///////////////// simulator /////////////////
+
+uint8_t gs232_sim_init(gs232_sim_t *sim, gs232_t *ctx, double time_scale) {
+    gs232_sim_t *expected = NULL;
+
+    memset(sim, 0, sizeof(gs232_sim_t));
+    sim->ctx = ctx;
+    sim->time_scale = time_scale;
+    sim->real_start = gs232_sim_real();
+    sim->backlash = GS232_SIM_BACKLASH;
+    sim->noise = GS232_SIM_NOISE;
+    sim->seed = 0x9e3779b9;
+    sim->azimuth.gain = 1;
+    sim->elevation.gain = 1;
+
+    if (pthread_mutex_init(&sim->lock, NULL) != 0)
+        return GS232_FAIL;
+
+    if (!__atomic_compare_exchange_n(&gs232_sim_bound, &expected, sim, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_destroy(&sim->lock);
+        return GS232_FAIL;
+    }
+
+    ctx->fn.set_azimuth = gs232_sim_set_azimuth;
+    ctx->fn.get_azimuth = gs232_sim_get_azimuth;
+    ctx->fn.set_elevation = gs232_sim_set_elevation;
+    ctx->fn.get_elevation = gs232_sim_get_elevation;
+    ctx->fn.offset_calibration_azimuth = gs232_sim_offset_calibration_azimuth;
+    ctx->fn.offset_calibration_elevation = gs232_sim_offset_calibration_elevation;
+    ctx->fn.full_scale_calibration_azimuth = gs232_sim_full_scale_calibration_azimuth;
+    ctx->fn.full_scale_calibration_elevation = gs232_sim_full_scale_calibration_elevation;
+
+    gs232_set_clock(gs232_sim_clock);
+
+    return GS232_OK;
+}
+
+uint8_t gs232_sim_deinit(gs232_sim_t *sim) {
+    if (__atomic_load_n(&gs232_sim_bound, __ATOMIC_ACQUIRE) != sim)
+        return GS232_FAIL;
+
+    gs232_set_clock(NULL);
+    memset(&sim->ctx->fn, 0, sizeof(sim->ctx->fn));
+    __atomic_store_n(&gs232_sim_bound, NULL, __ATOMIC_RELEASE);
+    pthread_mutex_destroy(&sim->lock);
+
+    return GS232_OK;
+}
+
+uint8_t gs232_sim_advance(gs232_sim_t *sim, uint64_t ns) {
+    __atomic_fetch_add(&sim->advanced, ns, __ATOMIC_RELAXED);
+    return GS232_OK;
+}
+
+uint64_t gs232_sim_clock(void) {
+    gs232_sim_t *sim = __atomic_load_n(&gs232_sim_bound, __ATOMIC_ACQUIRE);
+    uint64_t now = 0;
+
+    if (sim == NULL)
+        return gs232_sim_real();
+
+    if (sim->time_scale > 0)
+        now = (uint64_t) ((double) (gs232_sim_real() - sim->real_start) * sim->time_scale);
+
+    return now + __atomic_load_n(&sim->advanced, __ATOMIC_RELAXED);
+}
+
+uint8_t gs232_sim_state(gs232_sim_t *sim, float *azimuth, float *elevation, bool *moving) {
+    pthread_mutex_lock(&sim->lock);
+    gs232_sim_update(sim, gs232_sim_clock());
+    *azimuth = sim->azimuth.shaft;
+    *elevation = sim->elevation.shaft;
+    if (moving != NULL)
+        *moving = !gs232_sim_axis_idle(&sim->azimuth) || !gs232_sim_axis_idle(&sim->elevation);
+    pthread_mutex_unlock(&sim->lock);
+
+    return GS232_OK;
+}
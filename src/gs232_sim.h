@@ -0,0 +1,119 @@
+/**
+ * @gs232_sim.h
+ *
+ * @brief Rotator simulator for libGS232
+ * @details Reference implementation of the eight hardware functions: motor per axis with slew rate of rotation speed (X1 .. X4),
+ *          acceleration, mechanical stops (360/450 degrees), gear backlash and sensor noise, on a virtual clock.
+ *          The virtual clock (gs232_set_clock) runs time_scale times faster than real time, or only with gs232_sim_advance
+ *          (time_scale 0), so tracks of hours are executed in seconds.
+ *          Hardware functions have no context: one simulator is bound at a time.
+ *          Azimuths of hardware functions are gs232_planner values (mechanical position inside the stops).
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#ifndef GS232_SIM_H_
+#define GS232_SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "libGS232.h"
+
+#define GS232_SIM_AZIMUTH_RATE   1.5f       /*!< azimuth slew rate per rotation speed step (degrees/s, X4: 6) */
+#define GS232_SIM_ELEVATION_RATE 0.75f      /*!< elevation slew rate per rotation speed step (degrees/s, X4: 3) */
+#define GS232_SIM_ACCEL          3.0f       /*!< acceleration (degrees/s^2) */
+#define GS232_SIM_BACKLASH       0.5f       /*!< default gear backlash (degrees) */
+#define GS232_SIM_NOISE          0.2f       /*!< default sensor noise (degrees, uniform +-) */
+#define GS232_SIM_STEP           10000000ULL /*!< physics step (virtual ns) */
+
+/**
+ * @typedef gs232_sim_axis_t
+ * @brief Simulated axis
+ *
+ */
+typedef struct gs232_sim_axis_s {
+    float motor;    /*!< motor side position (degrees from counter clockwise stop / horizon) */
+    float shaft;    /*!< antenna side position (follows motor within backlash) */
+    float velocity; /*!< motor velocity (degrees/s) */
+    float target;   /*!< commanded position */
+    float offset;   /*!< sensor offset (degrees), set by offset calibration */
+    float gain;     /*!< sensor gain, set by full scale calibration */
+} gs232_sim_axis_t; /*!< simulated axis */
+
+/**
+ * @typedef gs232_sim_t
+ * @brief Simulator
+ *
+ */
+typedef struct gs232_sim_s {
+            gs232_t *ctx;          /*!< context (rotation speed, 360/450 mode, center) */
+    pthread_mutex_t lock;          /*!< axes lock (hardware functions of any thread) */
+             double time_scale;    /*!< virtual ns per real ns (0: only gs232_sim_advance) */
+           uint64_t real_start;    /*!< real time of virtual time 0 (ns) */
+           uint64_t advanced;      /*!< virtual time added by gs232_sim_advance (ns) */
+           uint64_t updated;       /*!< virtual time of axes (ns) */
+              float backlash;      /*!< gear backlash (degrees) */
+              float noise;         /*!< sensor noise (degrees) */
+           uint32_t seed;          /*!< noise generator state */
+   gs232_sim_axis_t azimuth;       /*!< azimuth axis */
+   gs232_sim_axis_t elevation;     /*!< elevation axis */
+           uint32_t calibrations;  /*!< calibration functions called */
+} gs232_sim_t; /*!< simulator */
+
+/**
+ * @fn uint8_t gs232_sim_init(gs232_sim_t *sim, gs232_t *ctx, double time_scale)
+ * @brief Bind simulator: set hardware functions of context and library clock (virtual)
+ *
+ * @param sim Simulator
+ * @param ctx Context
+ * @param time_scale Virtual time speed (e.g. 1000: 1000 times faster than real time, 0: only gs232_sim_advance)
+ * @return GS232_ERROR (GS232_FAIL: other simulator bound)
+ */
+uint8_t gs232_sim_init(gs232_sim_t *sim, gs232_t *ctx, double time_scale);
+
+/**
+ * @fn uint8_t gs232_sim_deinit(gs232_sim_t *sim)
+ * @brief Unbind simulator: clear hardware functions of context and restore library clock
+ *
+ * @param sim Simulator
+ * @return GS232_ERROR
+ */
+uint8_t gs232_sim_deinit(gs232_sim_t *sim);
+
+/**
+ * @fn uint8_t gs232_sim_advance(gs232_sim_t *sim, uint64_t ns)
+ * @brief Advance virtual clock
+ *
+ * @param sim Simulator
+ * @param ns Virtual time (ns)
+ * @return GS232_ERROR
+ */
+uint8_t gs232_sim_advance(gs232_sim_t *sim, uint64_t ns);
+
+/**
+ * @fn uint64_t gs232_sim_clock(void)
+ * @brief Virtual clock of bound simulator (library clock while bound)
+ *
+ * @return Time (ns)
+ */
+uint64_t gs232_sim_clock(void);
+
+/**
+ * @fn uint8_t gs232_sim_state(gs232_sim_t *sim, float *azimuth, float *elevation, bool *moving)
+ * @brief True antenna position at current virtual time (no noise, no calibration)
+ *
+ * @param sim Simulator
+ * @param azimuth Azimuth (degrees from counter clockwise stop)
+ * @param elevation Elevation
+ * @param moving Any axis moving. Can be NULL
+ * @return GS232_ERROR
+ */
+uint8_t gs232_sim_state(gs232_sim_t *sim, float *azimuth, float *elevation, bool *moving);
+
+#endif /* GS232_SIM_H_ */
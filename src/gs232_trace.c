@@ -0,0 +1,124 @@
+/**
+ * @gs232_trace.c
+ *
+ * @brief Tracing for libGS232
+ * @details Binary trace events with compile-time levels and a runtime pluggable sink.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "libGS232.h"
+#include "gs232_trace.h"
+
+static gs232_trace_sink trace_sink = NULL;
+static void *trace_sink_arg = NULL;
+
+void gs232_trace_set_sink(gs232_trace_sink sink, void *arg) {
+    __atomic_store_n(&trace_sink_arg, arg, __ATOMIC_RELAXED);
+    __atomic_store_n(&trace_sink, sink, __ATOMIC_RELEASE);
+}
+
+void gs232_trace_emit(uint8_t level, uint16_t event, const void *ctx, uint32_t arg0, uint32_t arg1) {
+    gs232_trace_sink sink = __atomic_load_n(&trace_sink, __ATOMIC_ACQUIRE);
+    gs232_trace_event_t trace_event;
+    struct timespec ts;
+
+    if (sink == NULL)
+        return;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    trace_event.timestamp = (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    trace_event.ctx = ctx;
+    trace_event.event = event;
+    trace_event.level = level;
+    trace_event.arg0 = arg0;
+    trace_event.arg1 = arg1;
+
+    sink(&trace_event, __atomic_load_n(&trace_sink_arg, __ATOMIC_RELAXED));
+}
+
+uint8_t gs232_trace_ring_init(gs232_trace_ring_t *ring, uint32_t size) {
+    if (ring == NULL || size == 0 || (size & (size - 1)) != 0)
+        return GS232_FAIL;
+
+    ring->events = gs232_alloc(NULL, size * sizeof(gs232_trace_event_t));
+    ring->sequence = gs232_alloc(NULL, size * sizeof(uint64_t));
+    if (ring->events == NULL || ring->sequence == NULL) {
+        gs232_free(NULL, ring->events, size * sizeof(gs232_trace_event_t));
+        gs232_free(NULL, ring->sequence, size * sizeof(uint64_t));
+        return GS232_FAIL;
+    }
+
+    for (uint32_t n = 0; n < size; n++)
+        ring->sequence[n] = 0;
+
+    ring->size = size;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->lost = 0;
+
+    return GS232_OK;
+}
+
+uint8_t gs232_trace_ring_deinit(gs232_trace_ring_t *ring) {
+    gs232_free(NULL, ring->events, ring->size * sizeof(gs232_trace_event_t));
+    gs232_free(NULL, ring->sequence, ring->size * sizeof(uint64_t));
+    ring->events = NULL;
+    ring->sequence = NULL;
+
+    return GS232_OK;
+}
+
+// slot sequence is 0 while written and position + 1 when complete
+void gs232_trace_ring_sink(const gs232_trace_event_t *event, void *arg) {
+    gs232_trace_ring_t *ring = arg;
+    uint64_t pos = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+    uint32_t slot = pos & (ring->size - 1);
+
+    __atomic_store_n(&ring->sequence[slot], 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    ring->events[slot] = *event;
+    __atomic_store_n(&ring->sequence[slot], pos + 1, __ATOMIC_RELEASE);
+}
+
+uint32_t gs232_trace_ring_read(gs232_trace_ring_t *ring, gs232_trace_event_t *events, uint32_t max_events) {
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t sequence;
+    uint32_t slot, n = 0;
+
+    if (head - ring->tail > ring->size) {
+        ring->lost += head - ring->size - ring->tail;
+        ring->tail = head - ring->size;
+    }
+
+    while (n < max_events && ring->tail < head) {
+        slot = ring->tail & (ring->size - 1);
+        sequence = __atomic_load_n(&ring->sequence[slot], __ATOMIC_ACQUIRE);
+
+        // event still being written
+        if (sequence < ring->tail + 1)
+            break;
+
+        if (sequence == ring->tail + 1) {
+            events[n] = ring->events[slot];
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&ring->sequence[slot], __ATOMIC_RELAXED) == sequence)
+                ++n;
+            else
+                ++ring->lost;
+        } else
+            ++ring->lost;
+
+        ++ring->tail;
+    }
+
+    return n;
+}
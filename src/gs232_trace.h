@@ -0,0 +1,153 @@
+/**
+ * @gs232_trace.h
+ *
+ * @brief Tracing for libGS232
+ * @details Binary trace events with compile-time levels and a runtime pluggable sink.
+ *          With GS232_TRACE_LEVEL = GS232_TRACE_NONE (default) every trace point is removed at compile time.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#ifndef GS232_TRACE_H_
+#define GS232_TRACE_H_
+
+#include <stdint.h>
+
+#define GS232_TRACE_NONE  0 /*!< no trace */
+#define GS232_TRACE_ERROR 1 /*!< errors */
+#define GS232_TRACE_INFO  2 /*!< parsed commands */
+#define GS232_TRACE_DEBUG 3 /*!< internals */
+
+#ifndef GS232_TRACE_LEVEL
+#define GS232_TRACE_LEVEL GS232_TRACE_NONE /*!< compiled trace level */
+#endif
+
+/**
+ * @enum GS232_TRACE_EVENT
+ * @brief Trace events
+ *
+ */
+enum GS232_TRACE_EVENT {
+    GS232_TRACE_EVENT_PARSE,           /*!< command parsed (arg0: command, arg1: buffer length) */
+    GS232_TRACE_EVENT_PARSE_ERROR,     /*!< command parse error (arg0: GS232_ERROR, arg1: buffer length) */
+    GS232_TRACE_EVENT_VALUES,          /*!< values decoded (arg0: value type, arg1: quantity) */
+    GS232_TRACE_EVENT_RESPONSE,        /*!< response created (arg0: command, arg1: response length) */
+    GS232_TRACE_EVENT_STREAM_OVERFLOW, /*!< overlong frame dropped (arg0: 0, arg1: 0) */
+    GS232_TRACE_EVENT_TRACK_POINT,     /*!< timed track point executed (arg0: point, arg1: azimuth << 16 | elevation) */
+    GS232_TRACE_EVENT_POSITION,        /*!< position read from hardware (arg0: 1 azimuth | 2 elevation, arg1: azimuth << 16 | elevation) */
+    GS232_TRACE_EVENT_ACTUATOR_FULL,   /*!< actuation record dropped on full queue (arg0: command, arg1: axes) */
+    GS232_TRACE_EVENT_ARBITRATION,     /*!< gateway control command rejected (arg0: command, arg1: client priority) */
+};
+
+/**
+ * @typedef gs232_trace_event_t
+ * @brief Trace event
+ *
+ */
+typedef struct gs232_trace_event_s {
+    uint64_t timestamp; /*!< monotonic time (ns) */
+  const void *ctx;      /*!< context (stream for stream events) */
+    uint16_t event;     /*!< GS232_TRACE_EVENT */
+     uint8_t level;     /*!< trace level */
+    uint32_t arg0;      /*!< event argument */
+    uint32_t arg1;      /*!< event argument */
+} gs232_trace_event_t; /*!< trace event */
+
+/**
+ * @fn void (*gs232_trace_sink)(const gs232_trace_event_t *event, void *arg)
+ * @brief Trace sink. Called from the traced thread, must not block
+ *
+ * @param event Event
+ * @param arg User argument
+ */
+typedef void (*gs232_trace_sink)(const gs232_trace_event_t *event, void *arg);
+
+/**
+ * @typedef gs232_trace_ring_t
+ * @brief Lock-free trace ring (multiple producers, one consumer). Oldest events are overwritten
+ *
+ */
+typedef struct gs232_trace_ring_s {
+    gs232_trace_event_t *events;   /*!< events */
+               uint64_t *sequence; /*!< event sequence per slot */
+               uint32_t size;      /*!< slots (power of 2) */
+               uint64_t head;      /*!< next event to write */
+               uint64_t tail;      /*!< next event to read */
+               uint64_t lost;      /*!< overwritten events not read */
+} gs232_trace_ring_t; /*!< trace ring */
+
+/**
+ * @fn void gs232_trace_set_sink(gs232_trace_sink sink, void *arg)
+ * @brief Set trace sink (NULL: disable)
+ *
+ * @param sink Sink
+ * @param arg Sink user argument
+ */
+void gs232_trace_set_sink(gs232_trace_sink sink, void *arg);
+
+/**
+ * @fn void gs232_trace_emit(uint8_t level, uint16_t event, const void *ctx, uint32_t arg0, uint32_t arg1)
+ * @brief Emit trace event to sink. Use GS232_TRACE macro
+ *
+ * @param level Trace level
+ * @param event Event
+ * @param ctx Context
+ * @param arg0 Event argument
+ * @param arg1 Event argument
+ */
+void gs232_trace_emit(uint8_t level, uint16_t event, const void *ctx, uint32_t arg0, uint32_t arg1);
+
+/**
+ * @fn uint8_t gs232_trace_ring_init(gs232_trace_ring_t *ring, uint32_t size)
+ * @brief Initialize trace ring
+ *
+ * @param ring Ring
+ * @param size Slots (power of 2)
+ * @return GS232_ERROR
+ */
+uint8_t gs232_trace_ring_init(gs232_trace_ring_t *ring, uint32_t size);
+
+/**
+ * @fn uint8_t gs232_trace_ring_deinit(gs232_trace_ring_t *ring)
+ * @brief Destroy trace ring
+ *
+ * @param ring Ring
+ * @return GS232_ERROR
+ */
+uint8_t gs232_trace_ring_deinit(gs232_trace_ring_t *ring);
+
+/**
+ * @fn void gs232_trace_ring_sink(const gs232_trace_event_t *event, void *arg)
+ * @brief Trace sink for gs232_trace_set_sink writing on ring (arg: gs232_trace_ring_t)
+ *
+ * @param event Event
+ * @param arg Ring
+ */
+void gs232_trace_ring_sink(const gs232_trace_event_t *event, void *arg);
+
+/**
+ * @fn uint32_t gs232_trace_ring_read(gs232_trace_ring_t *ring, gs232_trace_event_t *events, uint32_t max_events)
+ * @brief Read events from ring (single consumer)
+ *
+ * @param ring Ring
+ * @param events Read events
+ * @param max_events Maximum events to read
+ * @return Number of read events
+ */
+uint32_t gs232_trace_ring_read(gs232_trace_ring_t *ring, gs232_trace_event_t *events, uint32_t max_events);
+
+#if GS232_TRACE_LEVEL > GS232_TRACE_NONE
+#define GS232_TRACE(level, event, ctx, arg0, arg1)                                     \
+        do {                                                                           \
+            if ((level) <= GS232_TRACE_LEVEL)                                          \
+                gs232_trace_emit((level), (event), (ctx), (arg0), (arg1));             \
+        } while (0)
+#else
+#define GS232_TRACE(level, event, ctx, arg0, arg1) do { } while (0)
+#endif
+
+#endif /* GS232_TRACE_H_ */
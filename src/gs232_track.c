@@ -0,0 +1,194 @@
+/**
+ * @gs232_track.c
+ *
+ * @brief Timed tracking for libGS232
+ * @details Executes Mttt aaa ... and Wttt aaa eee ... tracks stored on context memory (smoothed trajectory when available)
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "libGS232.h"
+#include "gs232_trace.h"
+#include "gs232_memory.h"
+#include "gs232_track.h"
+#include "gs232_actuator.h"
+#include "gs232_planner.h"
+#include "gs232_trajectory.h"
+#include "gs232_metrics.h"
+#include "gs232_capture.h"
+
+#define NS_PER_SECOND 1000000000ULL
+
+static uint16_t gs232_track_snapshot_points(const gs232_memory_snapshot_t *snapshot) {
+    switch (snapshot->command) {
+        case GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH: // ttt aaa aaa ...
+            return snapshot->qty - 1;
+
+        case GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH_AND_ELEVATION: // ttt aaa eee aaa eee ...
+            return (snapshot->qty - 1) / 2;
+
+        default:
+            return 0;
+    }
+}
+
+uint16_t gs232_track_points(gs232_t *ctx) {
+    gs232_memory_snapshot_t snapshot;
+
+    gs232_memory_snapshot(ctx, &snapshot);
+    return gs232_track_snapshot_points(&snapshot);
+}
+
+bool gs232_track_running(gs232_t *ctx) {
+    return __atomic_load_n(&ctx->track.running, __ATOMIC_RELAXED);
+}
+
+uint8_t gs232_track_start(gs232_t **ctx, uint64_t now) {
+    uint8_t res = GS232_OK;
+
+    pthread_mutex_lock(&(*ctx)->track.lock);
+    __atomic_store_n(&(*ctx)->memory_current_point, 0, __ATOMIC_RELAXED);
+
+    if (gs232_track_points(*ctx) == 0) {
+        __atomic_store_n(&(*ctx)->track.running, false, __ATOMIC_RELAXED);
+        res = GS232_FAIL;
+    } else {
+        (*ctx)->track.start = now;
+        (*ctx)->track.next = now;
+        __atomic_store_n(&(*ctx)->track.running, true, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&(*ctx)->track.lock);
+
+    return res;
+}
+
+// only the parser thread starts tracks: a stopped track stays stopped
+uint8_t gs232_track_stop(gs232_t **ctx) {
+    if (!gs232_track_running(*ctx))
+        return GS232_OK;
+
+    pthread_mutex_lock(&(*ctx)->track.lock);
+    __atomic_store_n(&(*ctx)->track.running, false, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&(*ctx)->track.lock);
+
+    return GS232_OK;
+}
+
+uint8_t gs232_track_clear(gs232_t **ctx) {
+    if (!gs232_track_running(*ctx) && __atomic_load_n(&(*ctx)->memory_current_point, __ATOMIC_RELAXED) == 0)
+        return GS232_OK;
+
+    pthread_mutex_lock(&(*ctx)->track.lock);
+    __atomic_store_n(&(*ctx)->track.running, false, __ATOMIC_RELAXED);
+    __atomic_store_n(&(*ctx)->memory_current_point, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&(*ctx)->track.lock);
+
+    return GS232_OK;
+}
+
+uint8_t gs232_track_tick(gs232_t **ctx, uint64_t now, uint64_t *next) {
+    gs232_t *context = *ctx;
+    gs232_memory_snapshot_t snapshot;
+    uint16_t azimuth, elevation = 0;
+    uint8_t res = GS232_OK;
+    uint16_t points;
+    uint64_t interval, point, sample;
+    bool finished;
+
+    *next = GS232_TRACK_IDLE;
+
+    if (!gs232_track_running(context))
+        return GS232_OK;
+
+    // hardware functions are called out of the lock
+    pthread_mutex_lock(&context->track.lock);
+    gs232_memory_read_lock(context);
+    gs232_memory_snapshot(context, &snapshot);
+    points = gs232_track_snapshot_points(&snapshot);
+
+    if (!context->track.running || points == 0) {
+        // recorded under the lock: replay ticks in the same order relative to track start and stop
+        if (context->track.running && context->capture.log != NULL)
+            gs232_capture_tick(context, now - context->track.start, __atomic_load_n(&context->memory_current_point, __ATOMIC_RELAXED));
+        __atomic_store_n(&context->track.running, false, __ATOMIC_RELAXED);
+        gs232_memory_read_unlock(context);
+        pthread_mutex_unlock(&context->track.lock);
+        return GS232_OK;
+    }
+
+    if (now < context->track.next) {
+        *next = context->track.next;
+        gs232_memory_read_unlock(context);
+        pthread_mutex_unlock(&context->track.lock);
+        return GS232_OK;
+    }
+
+    // due point from start time: late ticks skip stale points
+    interval = snapshot.memory[0] * NS_PER_SECOND;
+    point = (interval == 0) ? points - 1 : (now - context->track.start) / interval;
+    if (point >= points)
+        point = points - 1;
+
+    if (context->trajectory != NULL) {
+        // smoothed: due sample, points only count progress
+        sample = gs232_trajectory_sample(context->trajectory, now - context->track.start, &azimuth, &elevation);
+        finished = sample + 1 >= context->trajectory->samples;
+        if (finished)
+            point = points - 1;
+        else
+            context->track.next = context->track.start + (sample + 1) * context->trajectory->period;
+    } else {
+        if (snapshot.command == GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH) {
+            azimuth = snapshot.memory[1 + point];
+        } else {
+            azimuth = snapshot.memory[1 + 2 * point];
+            elevation = snapshot.memory[2 + 2 * point];
+        }
+
+        finished = point + 1 >= points;
+        if (!finished)
+            context->track.next = context->track.start + (point + 1) * interval;
+    }
+    gs232_memory_read_unlock(context);
+
+    __atomic_store_n(&context->memory_current_point, point + 1, __ATOMIC_RELAXED);
+    if (context->capture.log != NULL)
+        gs232_capture_tick(context, now - context->track.start, point + 1);
+
+    if (finished)
+        __atomic_store_n(&context->track.running, false, __ATOMIC_RELAXED);
+    else
+        *next = context->track.next;
+    pthread_mutex_unlock(&context->track.lock);
+
+    GS232_TRACE(GS232_TRACE_INFO, GS232_TRACE_EVENT_TRACK_POINT, context, point, (uint32_t) azimuth << 16 | elevation);
+
+    if (context->actuator != NULL) {
+        if (gs232_actuator_submit(context->actuator, snapshot.command,
+                GS232_ACTUATOR_AZIMUTH | GS232_ACTUATOR_ROUTE | (snapshot.command == GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH_AND_ELEVATION ? GS232_ACTUATOR_ELEVATION : 0),
+                azimuth, elevation) != GS232_OK)
+            res = GS232_FAIL;
+    } else {
+        uint64_t start = GS232_METRIC_BEGIN(context, GS232_METRICS_HOOK);
+
+        if (context->fn.set_azimuth != NULL && context->fn.set_azimuth(gs232_planner_target(context, azimuth)) != 0)
+            res = GS232_FAIL;
+
+        if (snapshot.command == GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH_AND_ELEVATION && context->fn.set_elevation != NULL
+                && context->fn.set_elevation(elevation) != 0)
+            res = GS232_FAIL;
+
+        GS232_METRIC(gs232_metrics_end(context, GS232_METRICS_HOOK, start));
+    }
+
+    return res;
+}
@@ -0,0 +1,85 @@
+/**
+ * @gs232_track.h
+ *
+ * @brief Timed tracking for libGS232
+ * @details Executes Mttt aaa ... and Wttt aaa eee ... tracks stored on context memory, started with T and stopped with S/A/E.
+ *          Tick driven: call gs232_track_tick at (or after) the returned deadline, e.g. from a poll timeout or a timerfd.
+ *          Points are scheduled from the start time (no drift), late ticks jump to the current point.
+ *          Tick can run on its own thread: track state is locked and memory is read inside a memory read section.
+ *          Uploaded tracks are smoothed (gs232_trajectory): ticks follow the samples of the trajectory.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#ifndef GS232_TRACK_H_
+#define GS232_TRACK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libGS232.h"
+
+#define GS232_TRACK_IDLE UINT64_MAX /*!< no deadline */
+
+/**
+ * @fn uint16_t gs232_track_points(gs232_t *ctx)
+ * @brief Number of points of timed track on memory
+ *
+ * @param ctx Context
+ * @return Points (0: no timed track)
+ */
+uint16_t gs232_track_points(gs232_t *ctx);
+
+/**
+ * @fn bool gs232_track_running(gs232_t *ctx)
+ * @brief Timed track is running
+ *
+ * @param ctx Context
+ * @return true: running
+ */
+bool gs232_track_running(gs232_t *ctx);
+
+/**
+ * @fn uint8_t gs232_track_start(gs232_t **ctx, uint64_t now)
+ * @brief Start timed track on memory (command T)
+ *
+ * @param ctx Context
+ * @param now Current time (ns)
+ * @return GS232_ERROR
+ */
+uint8_t gs232_track_start(gs232_t **ctx, uint64_t now);
+
+/**
+ * @fn uint8_t gs232_track_stop(gs232_t **ctx)
+ * @brief Stop timed track (commands S/A/E)
+ *
+ * @param ctx Context
+ * @return GS232_ERROR
+ */
+uint8_t gs232_track_stop(gs232_t **ctx);
+
+/**
+ * @fn uint8_t gs232_track_clear(gs232_t **ctx)
+ * @brief Stop timed track and reset executed points (memory is being replaced)
+ *
+ * @param ctx Context
+ * @return GS232_ERROR
+ */
+uint8_t gs232_track_clear(gs232_t **ctx);
+
+/**
+ * @fn uint8_t gs232_track_tick(gs232_t **ctx, uint64_t now, uint64_t *next)
+ * @brief Execute due point of timed track calling set_azimuth/set_elevation hardware functions
+ *
+ * @param ctx Context
+ * @param now Current time (ns)
+ * @param next Next point time (ns) or GS232_TRACK_IDLE
+ * @return GS232_ERROR (GS232_FAIL: hardware function error)
+ */
+uint8_t gs232_track_tick(gs232_t **ctx, uint64_t now, uint64_t *next);
+
+#endif /* GS232_TRACK_H_ */
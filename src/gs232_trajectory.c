@@ -0,0 +1,250 @@
+/**
+ * @gs232_trajectory.c
+ *
+ * @brief Timed track trajectories for libGS232
+ * @details Hermite spline through track points followed within rate and acceleration limits, sampled at upload
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "libGS232.h"
+#include "gs232_alloc.h"
+#include "gs232_memory.h"
+#include "gs232_trajectory.h"
+
+#define NS_PER_SECOND 1000000000ULL
+
+// axis of track: points (azimuth unwrapped), spline tangents and follower state
+typedef struct gs232_trajectory_axis_s {
+    const uint16_t *values; // first value of axis on memory
+    uint16_t stride;        // values between points
+    bool azimuth;           // unwrap (nearest direction to previous point)
+    float previous;         // last unwrapped point
+    float position;         // follower position
+    float velocity;         // follower velocity (degrees/s)
+} gs232_trajectory_axis_t;
+
+static float gs232_trajectory_point(gs232_trajectory_axis_t *axis, uint16_t point) {
+    float value = axis->values[point * axis->stride];
+
+    if (axis->azimuth && point != 0) {
+        value = axis->previous + remainderf(value - axis->previous, 360);
+    }
+
+    return axis->previous = value;
+}
+
+// monotone (Fritsch-Carlson) tangent at point from neighbour slopes
+static float gs232_trajectory_tangent(float slope_before, float slope_after) {
+    if (slope_before * slope_after <= 0)
+        return 0;
+
+    return 2 / (1 / slope_before + 1 / slope_after);
+}
+
+// spline value of segment (p0, p1) with tangents (m0, m1) scaled to segment length, at t in [0, 1]
+static float gs232_trajectory_hermite(float p0, float p1, float m0, float m1, float t) {
+    float t2 = t * t, t3 = t2 * t;
+
+    return (2 * t3 - 3 * t2 + 1) * p0 + (t3 - 2 * t2 + t) * m0 + (-2 * t3 + 3 * t2) * p1 + (t3 - t2) * m1;
+}
+
+// follower step towards target: rate limit, braking distance and acceleration limit
+static void gs232_trajectory_follow(gs232_trajectory_axis_t *axis, float target, float dt, float rate, float accel) {
+    float error = target - axis->position;
+    float velocity = error / dt;
+    float braking = sqrtf(2 * accel * fabsf(error));
+
+    if (velocity > rate)
+        velocity = rate;
+    if (velocity < -rate)
+        velocity = -rate;
+    if (fabsf(velocity) > braking)
+        velocity = copysignf(braking, velocity);
+
+    if (velocity > axis->velocity + accel * dt)
+        velocity = axis->velocity + accel * dt;
+    if (velocity < axis->velocity - accel * dt)
+        velocity = axis->velocity - accel * dt;
+
+    axis->velocity = velocity;
+    axis->position += velocity * dt;
+}
+
+static uint16_t gs232_trajectory_value(const gs232_trajectory_axis_t *axis, float value) {
+    long rounded = lroundf(value);
+
+    if (axis->azimuth)
+        return (uint16_t) ((rounded % 360 + 360) % 360);
+
+    return (uint16_t) (rounded < 0 ? 0 : (rounded > 180 ? 180 : rounded));
+}
+
+uint8_t gs232_trajectory_build(gs232_t **ctx) {
+    gs232_trajectory_t *trajectory = NULL, *previous;
+    gs232_trajectory_axis_t axis[2];
+    gs232_memory_snapshot_t snapshot;
+    uint16_t points = 0, axes = 1;
+    uint8_t speed = __atomic_load_n(&(*ctx)->rotation_speed, __ATOMIC_RELAXED);
+    float rate = GS232_TRAJECTORY_RATE * speed, accel = GS232_TRAJECTORY_ACCEL * speed;
+    float interval, dt, p0[2], p1[2], m0[2], m1[2], slope[2];
+    uint32_t n = 0;
+    uint64_t period = GS232_TRAJECTORY_PERIOD;
+    size_t size;
+
+    // parser thread: memory is not replaced meanwhile
+    gs232_memory_snapshot(*ctx, &snapshot);
+
+    switch (snapshot.command) {
+        case GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH: // ttt aaa aaa ...
+            points = snapshot.qty - 1;
+            axis[0] = (gs232_trajectory_axis_t ) { snapshot.memory + 1, 1, true, 0, 0, 0 };
+            break;
+
+        case GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH_AND_ELEVATION: // ttt aaa eee aaa eee ...
+            points = (snapshot.qty - 1) / 2;
+            axis[0] = (gs232_trajectory_axis_t ) { snapshot.memory + 1, 2, true, 0, 0, 0 };
+            axis[1] = (gs232_trajectory_axis_t ) { snapshot.memory + 2, 2, false, 0, 0, 0 };
+            axes = 2;
+            break;
+    }
+
+    if (points != 0 && snapshot.memory[0] != 0) {
+        uint64_t duration = (uint64_t) (points - 1) * snapshot.memory[0] * NS_PER_SECOND;
+
+        if (duration / period >= GS232_TRAJECTORY_SAMPLES / 2)
+            period = duration / (GS232_TRAJECTORY_SAMPLES / 2 - 1) + 1;
+
+        size = sizeof(gs232_trajectory_t) + axes * GS232_TRAJECTORY_SAMPLES * sizeof(uint16_t);
+        trajectory = gs232_alloc((*ctx)->allocator, size);
+    }
+
+    if (trajectory == NULL) {
+        gs232_trajectory_release(ctx);
+        return GS232_FAIL;
+    }
+
+    trajectory->period = period;
+    trajectory->size = size;
+    trajectory->azimuth = (uint16_t*) (trajectory + 1);
+    trajectory->elevation = axes == 2 ? trajectory->azimuth + GS232_TRAJECTORY_SAMPLES : NULL;
+
+    interval = snapshot.memory[0];
+    dt = (float) period / NS_PER_SECOND;
+
+    for (uint16_t a = 0; a < axes; a++) {
+        p0[a] = gs232_trajectory_point(&axis[a], 0);
+        p1[a] = points > 1 ? gs232_trajectory_point(&axis[a], 1) : p0[a];
+        slope[a] = (p1[a] - p0[a]) / interval;
+        m0[a] = 0; // track starts at rest
+        axis[a].position = p0[a];
+    }
+
+    // samples of point segments: spline from point k to k + 1
+    for (uint16_t k = 0; k + 1 < points; k++) {
+        for (uint16_t a = 0; a < axes; a++) {
+            float slope_after = slope[a];
+
+            if (k + 2 < points) {
+                float p2 = gs232_trajectory_point(&axis[a], k + 2);
+
+                slope_after = (p2 - p1[a]) / interval;
+                m1[a] = gs232_trajectory_tangent(slope[a], slope_after);
+            } else {
+                m1[a] = 0; // and ends at rest
+            }
+
+            if (m1[a] > rate)
+                m1[a] = rate;
+            if (m1[a] < -rate)
+                m1[a] = -rate;
+            slope[a] = slope_after;
+        }
+
+        for (; n < GS232_TRAJECTORY_SAMPLES / 2 && (uint64_t) n * period < (uint64_t) (k + 1) * snapshot.memory[0] * NS_PER_SECOND; n++) {
+            float t = ((float) n * dt - (float) k * interval) / interval;
+
+            for (uint16_t a = 0; a < axes; a++) {
+                float target = gs232_trajectory_hermite(p0[a], p1[a], m0[a] * interval, m1[a] * interval, t);
+
+                if (n != 0)
+                    gs232_trajectory_follow(&axis[a], target, dt, rate, accel);
+                (a == 0 ? trajectory->azimuth : trajectory->elevation)[n] = gs232_trajectory_value(&axis[a], axis[a].position);
+            }
+        }
+
+        for (uint16_t a = 0; a < axes; a++) {
+            float p2 = p1[a];
+
+            p0[a] = p1[a];
+            m0[a] = m1[a];
+            if (k + 2 < points)
+                p2 = axis[a].previous;
+            p1[a] = p2;
+        }
+    }
+
+    // settle on last point
+    for (bool settled = false; !settled && n < GS232_TRAJECTORY_SAMPLES - 1; n++) {
+        settled = true;
+        for (uint16_t a = 0; a < axes; a++) {
+            gs232_trajectory_follow(&axis[a], p0[a], dt, rate, accel);
+            (a == 0 ? trajectory->azimuth : trajectory->elevation)[n] = gs232_trajectory_value(&axis[a], axis[a].position);
+            settled &= fabsf(axis[a].position - p0[a]) < 0.5f && fabsf(axis[a].velocity) < accel * dt;
+        }
+    }
+
+    for (uint16_t a = 0; a < axes; a++)
+        (a == 0 ? trajectory->azimuth : trajectory->elevation)[n] = gs232_trajectory_value(&axis[a], p0[a]);
+    trajectory->samples = n + 1;
+
+    pthread_mutex_lock(&(*ctx)->track.lock);
+    previous = (*ctx)->trajectory;
+    (*ctx)->trajectory = trajectory;
+    pthread_mutex_unlock(&(*ctx)->track.lock);
+
+    if (previous != NULL)
+        gs232_free((*ctx)->allocator, previous, previous->size);
+
+    return GS232_OK;
+}
+
+uint8_t gs232_trajectory_release(gs232_t **ctx) {
+    gs232_trajectory_t *trajectory;
+
+    if ((*ctx)->trajectory == NULL)
+        return GS232_OK;
+
+    pthread_mutex_lock(&(*ctx)->track.lock);
+    trajectory = (*ctx)->trajectory;
+    (*ctx)->trajectory = NULL;
+    pthread_mutex_unlock(&(*ctx)->track.lock);
+
+    if (trajectory != NULL)
+        gs232_free((*ctx)->allocator, trajectory, trajectory->size);
+
+    return GS232_OK;
+}
+
+uint32_t gs232_trajectory_sample(const gs232_trajectory_t *trajectory, uint64_t elapsed, uint16_t *azimuth, uint16_t *elevation) {
+    uint64_t sample = elapsed / trajectory->period;
+
+    if (sample >= trajectory->samples)
+        sample = trajectory->samples - 1;
+
+    *azimuth = trajectory->azimuth[sample];
+    if (trajectory->elevation != NULL)
+        *elevation = trajectory->elevation[sample];
+
+    return (uint32_t) sample;
+}
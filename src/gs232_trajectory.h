@@ -0,0 +1,73 @@
+/**
+ * @gs232_trajectory.h
+ *
+ * @brief Timed track trajectories for libGS232
+ * @details Mttt aaa ... and Wttt aaa eee ... points are smoothed once, when uploaded, into a dense trajectory: a monotone cubic
+ *          Hermite spline through the points (no overshoot), followed within per axis rate and acceleration limits of the
+ *          rotation speed (X1 .. X4). Tracking ticks read the due sample by index (O(1)) instead of stepping point to point.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#ifndef GS232_TRAJECTORY_H_
+#define GS232_TRAJECTORY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libGS232.h"
+
+#define GS232_TRAJECTORY_PERIOD  100000000ULL /*!< time between samples (ns), longer when track needs more than GS232_TRAJECTORY_SAMPLES */
+#define GS232_TRAJECTORY_SAMPLES 4096         /*!< maximum samples (half of them for points, half for settling after last point) */
+#define GS232_TRAJECTORY_RATE    2.0f         /*!< rate limit at X1 (degrees/s), X2 .. X4 multiply it */
+#define GS232_TRAJECTORY_ACCEL   1.0f         /*!< acceleration limit at X1 (degrees/s^2), X2 .. X4 multiply it */
+
+/**
+ * @typedef gs232_trajectory_t
+ * @brief Trajectory
+ *
+ */
+typedef struct gs232_trajectory_s {
+    uint64_t period;     /*!< time between samples (ns) */
+    uint32_t samples;    /*!< samples (last one is last point of track) */
+    uint16_t *azimuth;   /*!< azimuth samples */
+    uint16_t *elevation; /*!< elevation samples (NULL: azimuth only track) */
+      size_t size;       /*!< allocation size (trajectory and samples) */
+} gs232_trajectory_t; /*!< trajectory */
+
+/**
+ * @fn uint8_t gs232_trajectory_build(gs232_t **ctx)
+ * @brief Build trajectory of timed track on memory and replace context trajectory (parser thread: after upload and X)
+ *
+ * @param ctx Context
+ * @return GS232_ERROR (no timed track or track without time: context has no trajectory)
+ */
+uint8_t gs232_trajectory_build(gs232_t **ctx);
+
+/**
+ * @fn uint8_t gs232_trajectory_release(gs232_t **ctx)
+ * @brief Release context trajectory
+ *
+ * @param ctx Context
+ * @return GS232_ERROR
+ */
+uint8_t gs232_trajectory_release(gs232_t **ctx);
+
+/**
+ * @fn uint32_t gs232_trajectory_sample(const gs232_trajectory_t *trajectory, uint64_t elapsed, uint16_t *azimuth, uint16_t *elevation)
+ * @brief Due sample of trajectory
+ *
+ * @param trajectory Trajectory
+ * @param elapsed Time from track start (ns)
+ * @param azimuth Azimuth
+ * @param elevation Elevation (unchanged on azimuth only tracks)
+ * @return Sample index (samples - 1: trajectory finished)
+ */
+uint32_t gs232_trajectory_sample(const gs232_trajectory_t *trajectory, uint64_t elapsed, uint16_t *azimuth, uint16_t *elevation);
+
+#endif /* GS232_TRAJECTORY_H_ */
@@ -20,8 +20,21 @@
 #include <ctype.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
 
 #include "libGS232.h"
+#include "gs232_trace.h"
+#include "gs232_track.h"
+#include "gs232_memory.h"
+#include "gs232_seqlock.h"
+#include "gs232_position.h"
+#include "gs232_actuator.h"
+#include "gs232_path.h"
+#include "gs232_trajectory.h"
+#include "gs232_metrics.h"
+#include "gs232_binary.h"
+#include "gs232_persist.h"
+#include "gs232_capture.h"
 
 #ifdef DEBUG
 #define EP(x) [x] = #x
@@ -58,6 +71,7 @@ const char *GS232_COMMAND_STR[] = {
         EP(GS232_TOGGLE_AZIMUTH_NORD_SOUTH),
         EP(GS232_UNKNOWN_COMMAND)
 };
+#define COMMAND_STR(command) ((command) <= GS232_UNKNOWN_COMMAND ? GS232_COMMAND_STR[command] : "GS232_ERROR")
 #define DBG_HEX(str, len)  \
        fprintf(stderr, "DEBUG (fn %s): HEX =", __FUNCTION__); \
        for(uint32_t ___pos___dbg___hex___ = 0; ___pos___dbg___hex___< len;___pos___dbg___hex___++) \
@@ -87,562 +101,1072 @@ const char *GS232_VALUE_TYPE_STR[] = {
 };
 #endif
 
-static uint32_t gs232_values(gs232_t **ctx, char *buffer, uint32_t buffer_len) {
+#define GS232_VALUES_DIGITS_MASK 0x00FFFFFF00FFFFFFULL /*!< digits of two "ddd " groups */
+#define GS232_VALUES_ZERO        0x0030303000303030ULL /*!< '0' on every digit */
+#define GS232_VALUES_HIGH_NIBBLE 0x00F0F0F000F0F0F0ULL /*!< digit high nibble */
+#define GS232_VALUES_NINE_CARRY  0x0006060600060606ULL /*!< moves ':'..'?' out of digit high nibble */
+
+// memory for values: single point commands use the unpublished inline memory, tracks the spare or a new block from memory pool
+static uint16_t* gs232_memory_reserve(gs232_t *ctx, uint32_t values, uint16_t *size) {
+    uint16_t *memory;
+
+    if (values > MEMORY_POINTS)
+        values = MEMORY_POINTS;
+
+    if (values <= GS232_MEMORY_INLINE) {
+        *size = GS232_MEMORY_INLINE;
+        return ctx->memory_inline[ctx->memory == ctx->memory_inline[0] ? 1 : 0];
+    }
+
+    if (ctx->memory_spare != NULL && values <= ctx->memory_spare_size) {
+        memory = ctx->memory_spare;
+        *size = ctx->memory_spare_size;
+        ctx->memory_spare = NULL;
+        return memory;
+    }
+
+    return gs232_memory_acquire(ctx->allocator, values, size);
+}
+
+// limits of values: first value, even and odd values
+static void gs232_values_limits(gs232_t *ctx, uint8_t value_type, uint16_t *limit_first, uint16_t *limit) {
+    uint16_t azimuth_limit = __atomic_load_n(&ctx->is_450_degrees, __ATOMIC_RELAXED) ? 450 : 360;
+
+    switch (value_type) {
+        case GS232_AZIMUTH:
+            *limit_first = azimuth_limit;
+            limit[0] = limit[1] = 999;
+            break;
+
+        case GS232_TIME_AZIMUTH:
+            *limit_first = 999;
+            limit[0] = limit[1] = azimuth_limit;
+            break;
+
+        case GS232_AZIMUTH_ELEVATION:
+            *limit_first = limit[0] = azimuth_limit;
+            limit[1] = 180;
+            break;
+
+        case GS232_TIME_AZIMUTH_ELEVATION:
+        default:
+            *limit_first = 999;
+            limit[0] = 180;
+            limit[1] = azimuth_limit;
+            break;
+    }
+}
+
+// publish values (GS232_UNKNOWN_COMMAND: no timed track), timed tracks are smoothed once here: ticks only read samples
+static void gs232_values_publish(gs232_t **ctx, uint16_t *memory, uint16_t size, uint16_t qty, uint8_t track_command) {
+    gs232_memory_publish(ctx, memory, size, qty, track_command);
+
+    if (track_command != GS232_UNKNOWN_COMMAND)
+        gs232_trajectory_build(ctx);
+    else
+        gs232_trajectory_release(ctx);
+}
+
+/*
+ * Single pass decode and range check of "ddd ddd ... ddd\r" values.
+ * Result is the same of a full decode followed by range check: decode errors (GS232_TOOMANYVALUES, GS232_FAIL) have priority
+ * over GS232_OUTOFRANGE and memory_qty is the number of decoded values.
+ * Values are decoded on unpublished memory and published at once with the timed track command (only on success).
+ */
+static uint8_t gs232_values(gs232_t **ctx, const char *buffer, uint32_t buffer_len, uint8_t value_type, uint8_t track_command) {
+    const uint8_t *buffer_value = (const uint8_t*) buffer + 1;
+    uint16_t *memory, size;
+    uint16_t limit_first, limit[2]; // limit for first value, even and odd values
+    uint32_t groups, n = 0;
+    bool out_of_range = false;
+    uint8_t res = GS232_OK;
+    uint16_t value;
+
     if ((buffer_len - 1) % 4 != 0)
         return GS232_FAIL;
 
-    char *buffer_value = buffer + 1;
-    char val[4];
-    uint16_t cnt = 0;
-    char *end = NULL;
-    long i = 0;
+    groups = (buffer_len - 1) / 4;
+
+    gs232_track_clear(ctx);
 
+    if ((memory = gs232_memory_reserve(*ctx, groups, &size)) == NULL) {
+        gs232_values_publish(ctx, gs232_memory_reserve(*ctx, 0, &size), size, 0, GS232_UNKNOWN_COMMAND);
+        return GS232_FAIL;
+    }
+
+    DBG_PRINT("VALUE TYPE: %s\n", GS232_VALUE_TYPE_STR[value_type]);
     DBG_HEX(buffer_value, buffer_len - 1);
 
-    (*ctx)->memory_qty = 0;
-    val[3] = '\0';
+    gs232_values_limits(*ctx, value_type, &limit_first, limit);
 
-    DBG_PRINT("values:\n");
-    do {
-        if((*ctx)->memory_qty > MEMORY_POINTS) {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ || __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    // two groups per step (SWAR): validate six digits at once, scalar path below reports errors
+    while (n + 2 <= groups && n + 2 <= MEMORY_POINTS) {
+        uint64_t word;
+
+        memcpy(&word, buffer_value + 4 * n, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        word = __builtin_bswap64(word);
+#endif
+        word &= GS232_VALUES_DIGITS_MASK;
+        if ((word & GS232_VALUES_HIGH_NIBBLE) != GS232_VALUES_ZERO || ((word + GS232_VALUES_NINE_CARRY) & GS232_VALUES_HIGH_NIBBLE) != GS232_VALUES_ZERO)
+            break;
+
+        word -= GS232_VALUES_ZERO;
+
+        value = (word & 0xff) * 100 + ((word >> 8) & 0xff) * 10 + ((word >> 16) & 0xff);
+        out_of_range |= value > (n == 0 ? limit_first : limit[n & 1]);
+        memory[n++] = value;
+
+        value = ((word >> 32) & 0xff) * 100 + ((word >> 40) & 0xff) * 10 + ((word >> 48) & 0xff);
+        out_of_range |= value > limit[n & 1];
+        memory[n++] = value;
+    }
+#endif
+
+    for (; n < groups; n++) {
+        const uint8_t *group = buffer_value + 4 * n;
+
+        if (n >= MEMORY_POINTS) {
             DBG_PRINT("GS232_TOOMANYVALUES\n");
-            return GS232_TOOMANYVALUES;
+            res = GS232_TOOMANYVALUES;
+            break;
         }
 
-        if (!isdigit(buffer_value[cnt]) || !isdigit(buffer_value[cnt + 1]) || !isdigit(buffer_value[cnt + 2])) {
-            DBG_PRINT("GS232_FAIL (%c %c %c)\n", buffer_value[cnt], buffer_value[cnt + 1], buffer_value[cnt + 2]);
-            return GS232_FAIL;
+        if (!isdigit(group[0]) || !isdigit(group[1]) || !isdigit(group[2])) {
+            DBG_PRINT("GS232_FAIL (%c %c %c)\n", group[0], group[1], group[2]);
+            res = GS232_FAIL;
+            break;
         }
 
-        val[0] = buffer_value[cnt++];
-        val[1] = buffer_value[cnt++];
-        val[2] = buffer_value[cnt++];
-        ++cnt;
+        value = (group[0] - '0') * 100 + (group[1] - '0') * 10 + (group[2] - '0');
+        out_of_range |= value > (n == 0 ? limit_first : limit[n & 1]);
+        memory[n] = value;
+    }
 
-        errno = 0;
-        i = strtol(val, &end, 10);
-        if (errno == ERANGE) {
-            DBG_PRINT("GS232_OUTOFRANGE\n");
-            return GS232_OUTOFRANGE;
-        }
+    if (res == GS232_OK && out_of_range) {
+        DBG_PRINT("GS232_OUTOFRANGE\n");
+        res = GS232_OUTOFRANGE;
+    }
 
-        (*ctx)->memory[(*ctx)->memory_qty++] = (uint16_t) i;
-        DBG_PRINT("       -> %d\n", (uint16_t) i);
-    } while (buffer_value[cnt - 1] == ' ' || buffer_value[cnt - 1] != '\r' || cnt < buffer_len - 1);
+    gs232_values_publish(ctx, memory, size, n, res == GS232_OK ? track_command : GS232_UNKNOWN_COMMAND);
 
-    DBG_PRINT("GS232_OK\n");
+    if (res != GS232_OK)
+        return res;
+
+    DBG_PRINT("GS232_OK (%d values)\n", n);
+    GS232_TRACE(GS232_TRACE_DEBUG, GS232_TRACE_EVENT_VALUES, *ctx, value_type, n);
     return GS232_OK;
 }
 
-static uint32_t gs232_check_values(gs232_t **ctx, uint8_t value_type) {
-    DBG_PRINT("VALUE TYPE: %s\n", GS232_VALUE_TYPE_STR[value_type]);
-    switch (value_type) {
-        case GS232_AZIMUTH:
-            DBG_PRINT("-- azimuth: %d\n", (*ctx)->memory[0]);
-            if (((*ctx)->is_450_degrees && (*ctx)->memory[0] > 450) || (!(*ctx)->is_450_degrees && (*ctx)->memory[0] > 360)) {
-                DBG_PRINT("GS232_OUTOFRANGE\n");
-                return GS232_OUTOFRANGE;
-            }
-            break;
+/*
+ * Command dispatch: one entry per command byte (upper and lower case). An entry without handler is an unknown command.
+ */
+typedef struct gs232_dispatch_s gs232_dispatch_t;
+struct gs232_dispatch_s {
+    uint8_t (*handler)(gs232_t **ctx, const gs232_dispatch_t *dispatch, const char *buffer, uint32_t buffer_len); /*!< command handler */
+    uint8_t command;                                                                                               /*!< command */
+    uint8_t command_2;                                                                                             /*!< command with suffix 2, timed form or last of range */
+    uint8_t min_len;                                                                                               /*!< minimum length (with \r) */
+    bool b_protocol;                                                                                               /*!< GS-232B only */
+};
 
-        case GS232_TIME_AZIMUTH:
-            DBG_PRINT("-- time: %d\n", (*ctx)->memory[0]);
-            if ((*ctx)->memory[0] > 999) {
-                DBG_PRINT("GS232_OUTOFRANGE\n");
-                return GS232_OUTOFRANGE;
-            }
+static uint8_t gs232_handle_single(gs232_t **ctx, const gs232_dispatch_t *dispatch, const char *buffer, uint32_t buffer_len) {
+    return dispatch->command;
+}
 
-            for (uint16_t val = 1; val < (*ctx)->memory_qty; val++) {
-                DBG_PRINT("-- azimuth: %d\n", (*ctx)->memory[val]);
-                if (((*ctx)->is_450_degrees && (*ctx)->memory[val] > 450) || (!(*ctx)->is_450_degrees && (*ctx)->memory[val] > 360)) {
-                    DBG_PRINT("GS232_OUTOFRANGE\n");
-                    return GS232_OUTOFRANGE;
-                }
-            }
-            break;
+static uint8_t gs232_handle_stop(gs232_t **ctx, const gs232_dispatch_t *dispatch, const char *buffer, uint32_t buffer_len) {
+    gs232_track_stop(ctx);
+    return dispatch->command;
+}
 
-        case GS232_AZIMUTH_ELEVATION:
-            for (uint16_t val = 0; val < (*ctx)->memory_qty; val += 2) {
-                DBG_PRINT("-- azimuth: %d, elevation: %d\n", (*ctx)->memory[0], (*ctx)->memory[1]);
-
-                if (((*ctx)->is_450_degrees && (*ctx)->memory[val] > 450) || (!(*ctx)->is_450_degrees && (*ctx)->memory[val] > 360)
-                        || (*ctx)->memory[val + 1] > 180) {
-                    DBG_PRINT("GS232_OUTOFRANGE\n");
-                    return GS232_OUTOFRANGE;
-                }
-            }
-            break;
+static uint8_t gs232_handle_suffix(gs232_t **ctx, const gs232_dispatch_t *dispatch, const char *buffer, uint32_t buffer_len) {
+    return buffer[1] == '2' ? dispatch->command_2 : dispatch->command;
+}
 
-        case GS232_TIME_AZIMUTH_ELEVATION:
-            DBG_PRINT("-- time: %d\n", (*ctx)->memory[0]);
-            if ((*ctx)->memory[0] > 999) {
-                DBG_PRINT("GS232_OUTOFRANGE\n");
-                return GS232_OUTOFRANGE;
-            }
+static uint8_t gs232_handle_values(gs232_t **ctx, const gs232_dispatch_t *dispatch, const char *buffer, uint32_t buffer_len) {
+    bool single = buffer[4] == '\r';
+    uint8_t value_type, res;
 
-            for (uint16_t val = 1; val < (*ctx)->memory_qty; val += 2) {
-                DBG_PRINT("-- azimuth: %d, elevation: %d\n", (*ctx)->memory[val], (*ctx)->memory[val + 1]);
-                if (((*ctx)->is_450_degrees && (*ctx)->memory[val] > 450) || (!(*ctx)->is_450_degrees && (*ctx)->memory[val] > 360)
-                        || (*ctx)->memory[val + 1] > 180) {
-                    DBG_PRINT("GS232_OUTOFRANGE\n");
-                    return GS232_OUTOFRANGE;
-                }
-            }
-            break;
+    // Maaa\r and Waaa eee\r are turns, longer frames are timed tracks
+    if (dispatch->command == GS232_TURN_DEGREES_AZIMUTH) {
+        value_type = single ? GS232_AZIMUTH : GS232_TIME_AZIMUTH;
+    } else {
+        single = single || buffer_len == 9;
+        value_type = single ? GS232_AZIMUTH_ELEVATION : GS232_TIME_AZIMUTH_ELEVATION;
+    }
 
-        default:
-            DBG_PRINT("GS232_FAIL\n");
-            return GS232_FAIL;
+    // memory overwritten: previous timed track is lost
+    if ((res = gs232_values(ctx, buffer, buffer_len, value_type, single ? GS232_UNKNOWN_COMMAND : dispatch->command_2)) != GS232_OK) {
+        (*ctx)->values_error = res;
+        GS232_TRACE(GS232_TRACE_ERROR, GS232_TRACE_EVENT_PARSE_ERROR, *ctx, res, buffer_len);
+        GS232_METRIC(gs232_metrics_error(*ctx, res));
+        return GS232_UNKNOWN_COMMAND;
     }
 
-    DBG_PRINT("GS232_OK\n");
-    return GS232_OK;
+    return single ? dispatch->command : dispatch->command_2;
 }
 
-uint8_t gs232_parse_command(gs232_t **ctx, char *buffer, uint32_t buffer_len) {
-    DBG_PRINT("buffer[%d]: %s\n", buffer_len, buffer);
+static uint8_t gs232_handle_start(gs232_t **ctx, const gs232_dispatch_t *dispatch, const char *buffer, uint32_t buffer_len) {
+    gs232_track_start(ctx, gs232_now());
+    return dispatch->command;
+}
+
+static uint8_t gs232_handle_speed(gs232_t **ctx, const gs232_dispatch_t *dispatch, const char *buffer, uint32_t buffer_len) {
+    if (buffer[1] < '1' || buffer[1] > '4')
+        return GS232_FAIL;
+
+    __atomic_store_n(&(*ctx)->rotation_speed, buffer[1] - '0', __ATOMIC_RELAXED);
+
+    // limits of trajectory follow rotation speed
+    if ((*ctx)->trajectory != NULL)
+        gs232_trajectory_build(ctx);
+    return dispatch->command + (buffer[1] - '1');
+}
+
+static uint8_t gs232_handle_help(gs232_t **ctx, const gs232_dispatch_t *dispatch, const char *buffer, uint32_t buffer_len) {
+    switch (buffer[1]) {
+        case '\r':
+            return dispatch->command;
+
+        case '2':
+            return dispatch->command_2;
+
+        case '3': // GS-232B
+            return (*ctx)->b_protocol ? GS232_LIST_OF_COMMANDS3 : GS232_UNKNOWN_COMMAND;
+    }
+
+    return GS232_FAIL;
+}
+
+static uint8_t gs232_handle_mode(gs232_t **ctx, const gs232_dispatch_t *dispatch, const char *buffer, uint32_t buffer_len) {
+    if (buffer[1] == '3' && buffer[2] == '6') {
+        __atomic_store_n(&(*ctx)->is_450_degrees, false, __ATOMIC_RELAXED);
+        return GS232_AZIMUTH_TO_360;
+    }
+
+    if (buffer[1] == '4' && buffer[2] == '5') {
+        __atomic_store_n(&(*ctx)->is_450_degrees, true, __ATOMIC_RELAXED);
+        return GS232_AZIMUTH_TO_450;
+    }
+
+    return GS232_FAIL;
+}
+
+static uint8_t gs232_handle_center(gs232_t **ctx, const gs232_dispatch_t *dispatch, const char *buffer, uint32_t buffer_len) {
+    // single parser thread per context: readers see old or new center
+    __atomic_store_n(&(*ctx)->azimuth_nord_south, !(*ctx)->azimuth_nord_south, __ATOMIC_RELAXED);
+    return dispatch->command;
+}
+
+#define DISPATCH(c, fn, cmd, cmd_2, min, b) \
+        [c] = { fn, cmd, cmd_2, min, b },   \
+        [(c) - 'A' + 'a'] = { fn, cmd, cmd_2, min, b }
+
+static const gs232_dispatch_t gs232_dispatch[256] = {
+        DISPATCH('R', gs232_handle_single, GS232_CLOCKWISE_ROTATION, GS232_CLOCKWISE_ROTATION, 2, false),
+        DISPATCH('U', gs232_handle_single, GS232_UP_DIRECTION_ROTATION, GS232_UP_DIRECTION_ROTATION, 2, false),
+        DISPATCH('L', gs232_handle_single, GS232_COUNTER_CLOCKWISE_ROTATION, GS232_COUNTER_CLOCKWISE_ROTATION, 2, false),
+        DISPATCH('D', gs232_handle_single, GS232_DOWN_DIRECTION_ROTATION, GS232_DOWN_DIRECTION_ROTATION, 2, false),
+        DISPATCH('A', gs232_handle_stop, GS232_CW_CCW_ROTATION_STOP, GS232_CW_CCW_ROTATION_STOP, 2, false),
+        DISPATCH('E', gs232_handle_stop, GS232_UP_DOWN_DIRECTION_ROTATION_STOP, GS232_UP_DOWN_DIRECTION_ROTATION_STOP, 2, false),
+        DISPATCH('C', gs232_handle_suffix, GS232_RETURN_CURRENT_AZIMUTH, GS232_RETURN_AZIMUTH_AND_ELEVATION, 2, false),
+        DISPATCH('M', gs232_handle_values, GS232_TURN_DEGREES_AZIMUTH, GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH, 5, false),
+        DISPATCH('W', gs232_handle_values, GS232_TURN_DEGREES_AZIMUTH_AND_ELEVATION, GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH_AND_ELEVATION, 5, false),
+        DISPATCH('N', gs232_handle_single, GS232_TOTAL_NUMBER_OF_SETTING_ANGLES, GS232_TOTAL_NUMBER_OF_SETTING_ANGLES, 2, false),
+        DISPATCH('T', gs232_handle_start, GS232_START_COMMAND_IN_TIME_INTERVAL, GS232_START_COMMAND_IN_TIME_INTERVAL, 2, false),
+        DISPATCH('X', gs232_handle_speed, GS232_ROTATION_SPEED_LOW, GS232_ROTATION_SPEED_HIGH, 2, false),
+        DISPATCH('O', gs232_handle_suffix, GS232_OFFSET_CALIBRATION_AZIMUTH, GS232_OFFSET_CALIBRATION_ELEVATION, 2, false),
+        DISPATCH('F', gs232_handle_suffix, GS232_FULL_SCALE_CALIBRATION_AZIMUTH, GS232_FULL_SCALE_CALIBRATION_ELEVATION, 2, false),
+        DISPATCH('B', gs232_handle_single, GS232_RETURN_CURRENT_ELEVATION, GS232_RETURN_CURRENT_ELEVATION, 2, false),
+        DISPATCH('S', gs232_handle_stop, GS232_ALL_STOP, GS232_ALL_STOP, 2, false),
+        DISPATCH('H', gs232_handle_help, GS232_LIST_OF_COMMANDS1, GS232_LIST_OF_COMMANDS2, 2, false),
+        //////////////////// GS-232B ////////////////////
+        DISPATCH('P', gs232_handle_mode, GS232_AZIMUTH_TO_360, GS232_AZIMUTH_TO_450, 2, true),
+        DISPATCH('Z', gs232_handle_center, GS232_TOGGLE_AZIMUTH_NORD_SOUTH, GS232_TOGGLE_AZIMUTH_NORD_SOUTH, 2, true),
+};
+
+static uint8_t gs232_parse(gs232_t **ctx, const char *buffer, uint32_t buffer_len) {
+    DBG_PRINT("buffer[%d]: %.*s\n", buffer_len, (int) buffer_len, buffer);
     DBG_HEX(buffer, buffer_len);
 
+    (*ctx)->values_error = GS232_OK;
+
     if (buffer[buffer_len - 1] == '\n') // some software (not standard!)
         --buffer_len;
 
     if (buffer == NULL || buffer_len < 2 || buffer[buffer_len - 1] != '\r') {
-        DBG_PRINT("FAIL AT START! (NULL= %s, LEN: %d, END: %02x)\n", (buffer == NULL) ? "true" : "false", buffer_len, buffer[buffer_len]);
+        DBG_PRINT("FAIL AT START! (NULL= %s, LEN: %d, END: %02x)\n", (buffer == NULL) ? "true" : "false", buffer_len, buffer[buffer_len - 1]);
+        GS232_TRACE(GS232_TRACE_ERROR, GS232_TRACE_EVENT_PARSE_ERROR, *ctx, GS232_FAIL, buffer_len);
         return GS232_FAIL;
     }
 
-    uint8_t command = GS232_FAIL;
+    const gs232_dispatch_t *dispatch = &gs232_dispatch[(uint8_t) buffer[0]];
+    uint8_t command;
 
     DBG_PRINT("PARSE COMMAND: %c\n", toupper(buffer[0]));
-    switch (toupper(buffer[0])) {
-        case 'R':
-            command =  GS232_CLOCKWISE_ROTATION;
-            break;
+    if (dispatch->handler == NULL)
+        command = GS232_FAIL;
+    else if ((dispatch->b_protocol && !(*ctx)->b_protocol) || buffer_len < dispatch->min_len)
+        command = GS232_UNKNOWN_COMMAND;
+    else if ((*ctx)->filter.fn != NULL && !(*ctx)->filter.fn(*ctx, dispatch->command, (*ctx)->filter.arg))
+        command = GS232_UNKNOWN_COMMAND;
+    else
+        command = dispatch->handler(ctx, dispatch, buffer, buffer_len);
+
+    if ((*ctx)->actuator != NULL)
+        gs232_actuator_command(ctx, command);
+
+    DBG_PRINT("command: %s\n", COMMAND_STR(command));
+    GS232_TRACE(GS232_TRACE_INFO, GS232_TRACE_EVENT_PARSE, *ctx, command, buffer_len);
+    return command;
+}
 
-        case 'U':
-            command =  GS232_UP_DIRECTION_ROTATION;
-            break;
+uint8_t gs232_parse_command(gs232_t **ctx, const char *buffer, uint32_t buffer_len) {
+    uint64_t start;
+    uint8_t command;
 
-        case 'L':
-            command =  GS232_COUNTER_CLOCKWISE_ROTATION;
-            break;
+    if ((*ctx)->capture.log != NULL)
+        gs232_capture_record(*ctx, GS232_CAPTURE_IN, buffer, buffer_len);
+
+    start = GS232_METRIC_BEGIN(*ctx, GS232_METRICS_PARSE);
+    command = gs232_parse(ctx, buffer, buffer_len);
+
+    GS232_METRIC(gs232_metrics_end(*ctx, GS232_METRICS_PARSE, start));
+    GS232_METRIC(gs232_metrics_command(*ctx, command, buffer_len));
+    if ((*ctx)->persist != NULL && gs232_persist_changed(*ctx, command))
+        gs232_persist_save(ctx);
+    return command;
+}
+
+/*
+ * Commands without values of binary frames run the ASCII command (same handlers), values are copied on unpublished memory.
+ */
+#define FRAME(str) { str, sizeof(str) - 1 }
+
+static const struct {
+    const char *str;
+    uint8_t len;
+} gs232_command_frames[GS232_UNKNOWN_COMMAND] = {
+        [GS232_CLOCKWISE_ROTATION]               = FRAME("R\r"),
+        [GS232_UP_DIRECTION_ROTATION]            = FRAME("U\r"),
+        [GS232_COUNTER_CLOCKWISE_ROTATION]       = FRAME("L\r"),
+        [GS232_DOWN_DIRECTION_ROTATION]          = FRAME("D\r"),
+        [GS232_CW_CCW_ROTATION_STOP]             = FRAME("A\r"),
+        [GS232_UP_DOWN_DIRECTION_ROTATION_STOP]  = FRAME("E\r"),
+        [GS232_RETURN_CURRENT_AZIMUTH]           = FRAME("C\r"),
+        [GS232_RETURN_AZIMUTH_AND_ELEVATION]     = FRAME("C2\r"),
+        [GS232_TOTAL_NUMBER_OF_SETTING_ANGLES]   = FRAME("N\r"),
+        [GS232_START_COMMAND_IN_TIME_INTERVAL]   = FRAME("T\r"),
+        [GS232_ROTATION_SPEED_LOW]               = FRAME("X1\r"),
+        [GS232_ROTATION_SPEED_MIDDLE1]           = FRAME("X2\r"),
+        [GS232_ROTATION_SPEED_MIDDLE2]           = FRAME("X3\r"),
+        [GS232_ROTATION_SPEED_HIGH]              = FRAME("X4\r"),
+        [GS232_OFFSET_CALIBRATION_AZIMUTH]       = FRAME("O\r"),
+        [GS232_OFFSET_CALIBRATION_ELEVATION]     = FRAME("O2\r"),
+        [GS232_FULL_SCALE_CALIBRATION_AZIMUTH]   = FRAME("F\r"),
+        [GS232_FULL_SCALE_CALIBRATION_ELEVATION] = FRAME("F2\r"),
+        [GS232_RETURN_CURRENT_ELEVATION]         = FRAME("B\r"),
+        [GS232_ALL_STOP]                         = FRAME("S\r"),
+        [GS232_LIST_OF_COMMANDS1]                = FRAME("H\r"),
+        [GS232_LIST_OF_COMMANDS2]                = FRAME("H2\r"),
+        [GS232_LIST_OF_COMMANDS3]                = FRAME("H3\r"),
+        [GS232_AZIMUTH_TO_360]                   = FRAME("P36\r"),
+        [GS232_AZIMUTH_TO_450]                   = FRAME("P45\r"),
+        [GS232_TOGGLE_AZIMUTH_NORD_SOUTH]        = FRAME("Z\r"),
+};
+
+static uint8_t gs232_parse_frame(gs232_t **ctx, uint8_t command, const uint8_t *values, uint16_t qty) {
+    uint16_t *memory, size, limit_first, limit[2];
+    uint8_t value_type, track_command = GS232_UNKNOWN_COMMAND;
+    bool valid, out_of_range = false;
 
-        case 'D':
-            command =  GS232_DOWN_DIRECTION_ROTATION;
+    if (command >= GS232_UNKNOWN_COMMAND) {
+        GS232_TRACE(GS232_TRACE_ERROR, GS232_TRACE_EVENT_PARSE_ERROR, *ctx, GS232_FAIL, qty);
+        return GS232_FAIL;
+    }
+
+    if (gs232_command_frames[command].str != NULL)
+        return qty == 0 ? gs232_parse(ctx, gs232_command_frames[command].str, gs232_command_frames[command].len) : GS232_UNKNOWN_COMMAND;
+
+    if ((*ctx)->filter.fn != NULL && !(*ctx)->filter.fn(*ctx, command, (*ctx)->filter.arg))
+        return GS232_UNKNOWN_COMMAND;
+
+    switch (command) {
+        case GS232_TURN_DEGREES_AZIMUTH: // aaa
+            value_type = GS232_AZIMUTH;
+            valid = qty == 1;
             break;
 
-        case 'A':
-            command =  GS232_CW_CCW_ROTATION_STOP;
+        case GS232_TURN_DEGREES_AZIMUTH_AND_ELEVATION: // aaa eee
+            value_type = GS232_AZIMUTH_ELEVATION;
+            valid = qty == 2;
             break;
 
-        case 'E':
-            command =  GS232_UP_DOWN_DIRECTION_ROTATION_STOP;
+        case GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH: // ttt aaa aaa ...
+            value_type = GS232_TIME_AZIMUTH;
+            track_command = command;
+            valid = qty >= 2;
             break;
 
-        case 'C':
-            if (buffer[1] == '2') {
-                command =  GS232_RETURN_AZIMUTH_AND_ELEVATION;
-            } else {
-                command =  GS232_RETURN_CURRENT_AZIMUTH;
-            }
+        case GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH_AND_ELEVATION: // ttt aaa eee aaa eee ...
+        default:
+            value_type = GS232_TIME_AZIMUTH_ELEVATION;
+            track_command = command;
+            valid = qty >= 3;
             break;
+    }
 
-        case 'M': {
-            if (buffer_len < 5 || gs232_values(ctx, buffer, buffer_len) != GS232_OK) {
-                command = GS232_UNKNOWN_COMMAND;
-                break;
-            }
+    if (!valid || qty > MEMORY_POINTS) {
+        GS232_TRACE(GS232_TRACE_ERROR, GS232_TRACE_EVENT_PARSE_ERROR, *ctx, qty > MEMORY_POINTS ? GS232_TOOMANYVALUES : GS232_FAIL, qty);
+        GS232_METRIC(gs232_metrics_error(*ctx, qty > MEMORY_POINTS ? GS232_TOOMANYVALUES : GS232_FAIL));
+        return GS232_UNKNOWN_COMMAND;
+    }
 
-            if (buffer[4] == '\r') {
-                if (gs232_check_values(ctx, GS232_AZIMUTH) != GS232_OK) {
-                    command = GS232_UNKNOWN_COMMAND;
-                    break;
-                }
+    // memory overwritten: previous timed track is lost
+    gs232_track_clear(ctx);
 
-                command = GS232_TURN_DEGREES_AZIMUTH;
-            } else {
-                if (gs232_check_values(ctx, GS232_TIME_AZIMUTH) != GS232_OK) {
-                    command = GS232_UNKNOWN_COMMAND;
-                    break;
-                }
+    if ((memory = gs232_memory_reserve(*ctx, qty, &size)) == NULL) {
+        gs232_values_publish(ctx, gs232_memory_reserve(*ctx, 0, &size), size, 0, GS232_UNKNOWN_COMMAND);
+        GS232_TRACE(GS232_TRACE_ERROR, GS232_TRACE_EVENT_PARSE_ERROR, *ctx, GS232_FAIL, qty);
+        GS232_METRIC(gs232_metrics_error(*ctx, GS232_FAIL));
+        return GS232_UNKNOWN_COMMAND;
+    }
 
-                command = GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH;
-            }
-        }
-            break;
+    // little endian values
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(memory, values, qty * sizeof(uint16_t));
+#else
+    for (uint16_t n = 0; n < qty; n++)
+        memory[n] = values[2 * n] | values[2 * n + 1] << 8;
+#endif
 
-        case 'W':
-            if (buffer_len < 5 || gs232_values(ctx, buffer, buffer_len) != GS232_OK) {
-                command =  GS232_UNKNOWN_COMMAND;
-                break;
-            }
+    gs232_values_limits(*ctx, value_type, &limit_first, limit);
+    // odd and even values in pairs (vectorizable)
+    out_of_range = memory[0] > limit_first || (qty % 2 == 0 && memory[qty - 1] > limit[1]);
+    for (uint16_t n = 1; n + 1 < qty; n += 2)
+        out_of_range |= (memory[n] > limit[1]) | (memory[n + 1] > limit[0]);
 
-            if (buffer[4] == '\r') {
-                if (gs232_check_values(ctx, GS232_AZIMUTH_ELEVATION) != GS232_OK) {
-                    command =  GS232_UNKNOWN_COMMAND;
-                    break;
-                }
+    gs232_values_publish(ctx, memory, size, qty, out_of_range ? GS232_UNKNOWN_COMMAND : track_command);
 
-                command =  GS232_TURN_DEGREES_AZIMUTH_AND_ELEVATION;
-            } else {
-                if (gs232_check_values(ctx, GS232_TIME_AZIMUTH_ELEVATION) != GS232_OK) {
-                    command =  GS232_UNKNOWN_COMMAND;
-                    break;
-                }
+    if (out_of_range) {
+        GS232_TRACE(GS232_TRACE_ERROR, GS232_TRACE_EVENT_PARSE_ERROR, *ctx, GS232_OUTOFRANGE, qty);
+        GS232_METRIC(gs232_metrics_error(*ctx, GS232_OUTOFRANGE));
+        return GS232_UNKNOWN_COMMAND;
+    }
 
-                command =  GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH_AND_ELEVATION;
-            }
-            break;
+    GS232_TRACE(GS232_TRACE_DEBUG, GS232_TRACE_EVENT_VALUES, *ctx, value_type, qty);
 
-        case 'N':
-            command =  GS232_TOTAL_NUMBER_OF_SETTING_ANGLES;
-            break;
+    if ((*ctx)->actuator != NULL)
+        gs232_actuator_command(ctx, command);
 
-        case 'T':
-            command =  GS232_START_COMMAND_IN_TIME_INTERVAL;
-            break;
+    GS232_TRACE(GS232_TRACE_INFO, GS232_TRACE_EVENT_PARSE, *ctx, command, qty);
+    return command;
+}
 
-        case 'X':
-            switch (buffer[1]) {
-                case '1':
-                    (*ctx)->rotation_speed = 1;
-                    command =  GS232_ROTATION_SPEED_LOW;
-                    break;
-                case '2':
-                    (*ctx)->rotation_speed = 2;
-                    command =  GS232_ROTATION_SPEED_MIDDLE1;
-                    break;
-                case '3':
-                    (*ctx)->rotation_speed = 3;
-                    command =  GS232_ROTATION_SPEED_MIDDLE2;
-                    break;
-                case '4':
-                    (*ctx)->rotation_speed = 4;
-                    command =  GS232_ROTATION_SPEED_HIGH;
-                    break;
-            }
-            break;
+uint8_t gs232_parse_binary(gs232_t **ctx, uint8_t command, const uint8_t *values, uint16_t qty) {
+    uint64_t start;
+    uint8_t res;
 
-        case 'O':
-            if (buffer[1] == '2') {
-                command =  GS232_OFFSET_CALIBRATION_AZIMUTH;
-            } else {
-                command =  GS232_OFFSET_CALIBRATION_ELEVATION;
-            }
-            break;
+    if ((*ctx)->capture.log != NULL)
+        gs232_capture_frame(*ctx, command, values, qty);
 
-        case 'F':
-            if (buffer[1] == '2') {
-                command =  GS232_FULL_SCALE_CALIBRATION_ELEVATION;
-            } else {
-                command =  GS232_FULL_SCALE_CALIBRATION_AZIMUTH;
-            }
-            break;
+    start = GS232_METRIC_BEGIN(*ctx, GS232_METRICS_PARSE);
+    res = gs232_parse_frame(ctx, command, values, qty);
 
-        case 'B':
-            command =  GS232_RETURN_CURRENT_ELEVATION;
-            break;
+    GS232_METRIC(gs232_metrics_end(*ctx, GS232_METRICS_PARSE, start));
+    GS232_METRIC(gs232_metrics_command(*ctx, res, GS232_BINARY_HEADER + 2 * (uint32_t) qty));
+    if ((*ctx)->persist != NULL && gs232_persist_changed(*ctx, res))
+        gs232_persist_save(ctx);
+    return res;
+}
 
-        case 'S':
-            command =  GS232_ALL_STOP;
-            break;
+/*
+ * Stream framing: returns GS232_OK when a complete frame is available, GS232_FAIL when more data is needed
+ * and GS232_TOOMANYVALUES when an overlong frame was dropped. Frames complete on a single chunk are not copied.
+ */
+static uint8_t gs232_stream_next(gs232_stream_t *stream, const gs232_allocator_t *allocator, const char *data, uint32_t data_len, uint32_t *used, const char **frame, uint32_t *frame_len) {
+    const char *end;
+    uint32_t pos = 0, chunk;
 
-        case 'H':
-            switch (buffer[1]) {
-                case '\r':
-                    command = GS232_LIST_OF_COMMANDS1;
-                    break;
-
-                case '2':
-                    command = GS232_LIST_OF_COMMANDS2;
-                    break;
-
-                ///////////////// GS-232B /////////////////
-                case '3':
-                    if (!(*ctx)->b_protocol)
-                        command = GS232_UNKNOWN_COMMAND;
-                    else
-                        command = GS232_LIST_OF_COMMANDS3;
-                    break;
-            }
-            break;
+    // skip line feed after carriage return (some software, not standard!)
+    if (stream->len == 0 && !stream->discard)
+        while (pos < data_len && data[pos] == '\n')
+            ++pos;
 
-        //////////////////// GS-232B ////////////////////
-        case 'P':
-            if (!(*ctx)->b_protocol)
-                command = GS232_UNKNOWN_COMMAND;
-            else if (buffer[1] == '3' && buffer[2] == '6') {
-                (*ctx)->is_450_degrees = false;
-                command = GS232_AZIMUTH_TO_360;
-            } else if (buffer[1] == '4' && buffer[2] == '5') {
-                (*ctx)->is_450_degrees = true;
-                command = GS232_AZIMUTH_TO_450;
-            }
-            break;
+    end = memchr(data + pos, '\r', data_len - pos);
+    chunk = (end == NULL ? data_len : (uint32_t) (end - data) + 1) - pos;
+    *used = pos + chunk;
 
-        case 'Z':
-            if (!(*ctx)->b_protocol)
-                command = GS232_UNKNOWN_COMMAND;
-            else {
-                (*ctx)->azimuth_nord_south = !(*ctx)->azimuth_nord_south;
-                command = GS232_TOGGLE_AZIMUTH_NORD_SOUTH;
-            }
-            break;
+    if (chunk == 0)
+        return GS232_FAIL;
+
+    if (!stream->discard && stream->len == 0 && end != NULL) {
+        *frame = data + pos;
+        *frame_len = chunk;
+        return GS232_OK;
     }
 
-    DBG_PRINT("command: %s\n", GS232_COMMAND_STR[command]);
-    return command;
+    if (!stream->discard && stream->len + chunk > GS232_FRAME_MAX) {
+        DBG_PRINT("overlong frame\n");
+        GS232_TRACE(GS232_TRACE_ERROR, GS232_TRACE_EVENT_STREAM_OVERFLOW, stream, 0, 0);
+        stream->discard = true;
+    }
+
+    if (!stream->discard && stream->buffer == NULL && (stream->buffer = gs232_alloc(allocator, GS232_FRAME_MAX)) == NULL)
+        stream->discard = true;
+
+    if (stream->discard) {
+        stream->len = 0;
+        if (end == NULL)
+            return GS232_FAIL;
+
+        stream->discard = false;
+        return GS232_TOOMANYVALUES;
+    }
+
+    memcpy(stream->buffer + stream->len, data + pos, chunk);
+    stream->len += chunk;
+
+    if (end == NULL)
+        return GS232_FAIL;
+
+    *frame = stream->buffer;
+    *frame_len = stream->len;
+    stream->len = 0;
+
+    return GS232_OK;
 }
 
-uint8_t gs232_return_string(gs232_t *ctx, uint8_t command, char **ret_str) {
-    DBG_PRINT("command: %s\n", GS232_COMMAND_STR[command]);
-    switch (command) {
-        case GS232_CLOCKWISE_ROTATION:
-        case GS232_UP_DIRECTION_ROTATION:
-        case GS232_COUNTER_CLOCKWISE_ROTATION:
-        case GS232_DOWN_DIRECTION_ROTATION:
-        case GS232_CW_CCW_ROTATION_STOP:
-        case GS232_UP_DOWN_DIRECTION_ROTATION_STOP:
-        case GS232_TURN_DEGREES_AZIMUTH:
-        case GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH:
-        case GS232_TURN_DEGREES_AZIMUTH_AND_ELEVATION:
-        case GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH_AND_ELEVATION:
-        case GS232_START_COMMAND_IN_TIME_INTERVAL:
-        case GS232_ROTATION_SPEED_LOW:
-        case GS232_ROTATION_SPEED_MIDDLE1:
-        case GS232_ROTATION_SPEED_MIDDLE2:
-        case GS232_ROTATION_SPEED_HIGH:
-        case GS232_ALL_STOP:
-        case GS232_AZIMUTH_TO_360:
-        case GS232_AZIMUTH_TO_450:
-        case GS232_TOGGLE_AZIMUTH_NORD_SOUTH:
-        {
-            const char tmp[] = "\r";
-            (*ret_str) = strdup(tmp);
-        }
-            break;
+uint8_t gs232_stream_feed(gs232_t **ctx, const char *data, uint32_t data_len, gs232_command_callback callback, void *arg) {
+    const char *frame;
+    uint32_t used, frame_len;
+    uint8_t res, command;
 
-        case GS232_LIST_OF_COMMANDS1: // H
-        {
-            const char tmp[] = ""
-                    "---------- COMMAND LIST 1 ----------\n"
-                    "R  Clockwise Rotation\n"
-                    "L  Counter Clockwise Rotation\n"
-                    "A  CW/CCW Rotation Stop\n"
-                    "C  Antenna Direction Value\n"
-                    "M  Antenna Direction Setting. MXXX\n"
-                    "M  Time Interval Direction Setting.\n"
-                    "   MTTT XXX XXX XXX ---\n"
-                    "   (TTT = Step value)\n"
-                    "   (XXX = Horizontal Angle)\n"
-                    "T  Start Command in the time interval direction setting\n"
-                    "   mode.\n"
-                    "N  Total number of setting angles in “M” mode and traced\n"
-                    "   number of all datas (setting angles)\n"
-                    "X1 Rotation Speed 1 (Horizontal) Low\n"
-                    "X2 Rotation Speed 2 (Horizontal) Middle 1\n"
-                    "X3 Rotation Speed 3 (Horizontal) Middle 2\n"
-                    "X4 Rotation Speed 4 (Horizontal) High\n"
-                    "S  All Stop\n"
-                    "O  Offset Calibration\n"
-                    "F  Full Scale Calibration\r\0";
-
-            (*ret_str) = strdup(tmp);
+    if (data == NULL)
+        return GS232_FAIL;
+
+    while (data_len > 0) {
+        res = gs232_stream_next(&(*ctx)->stream, (*ctx)->allocator, data, data_len, &used, &frame, &frame_len);
+        data += used;
+        data_len -= used;
+
+        if (res == GS232_FAIL)
+            continue;
+
+        if (res == GS232_OK)
+            command = gs232_parse_command(ctx, frame, frame_len);
+        else {
+            command = GS232_TOOMANYVALUES;
+            GS232_METRIC(gs232_metrics_command(*ctx, command, 0));
+            if ((*ctx)->capture.log != NULL)
+                gs232_capture_record(*ctx, GS232_CAPTURE_DROP, NULL, 0);
         }
+        if (callback != NULL)
+            callback(ctx, command, arg);
+    }
 
-            break;
+    return GS232_OK;
+}
 
-        case GS232_LIST_OF_COMMANDS2: // H2
-        {
-            const char tmp[] = ""
-                    "---------- HELP COMMAND 2 ----------\n"
-                    "U  UP Direction Rotation\n"
-                    "D  DOWN Direction Rotation\n"
-                    "E  UP/DOWN Direction Rotation Stop\n"
-                    "C2 Antenna Direction Value\n"
-                    "W  Antenna Direction Setting.\n"
-                    "   WXXX YYY\n"
-                    "W  Time Interval Direction Setting.\n"
-                    "   WTTT XXX YYY XXX YYY ---\n"
-                    "   (TTT = Step value)\n"
-                    "   (XXX = Horizontal Angle)\n"
-                    "   (YYY = Elevation Angle)\n"
-                    "T  Start Command in the time interval direction setting\n"
-                    "   mode.\n"
-                    "N  Total number of setting angle in “W” mode and traced\n"
-                    "   number of all datas (setting angles)\n"
-                    "S  All Stop\n"
-                    "02 Offset Calibration\n"
-                    "F2 Full Scale Calibration\n"
-                    "B  Elevation Antenna Direction Value\r\0";
-
-            (*ret_str) = strdup(tmp);
-        }
+uint8_t gs232_stream_batch(gs232_t **ctx, const char *data, uint32_t data_len, uint32_t *data_used, char *response, uint32_t response_size,
+        uint32_t *response_len) {
+    const char *frame, *ret;
+    uint32_t used, frame_len, ret_len;
+    uint8_t res, command;
 
-            break;
+    *data_used = 0;
+    *response_len = 0;
 
-        case GS232_LIST_OF_COMMANDS3: // H3
-        {
-            char *ptr;
-            char tmp[] = ""
-                    "---------- HELP COMMAND 3 ----------\n"
-                    "P45 Set_mode 450 Degree\n"
-                    "P36 Set_mode 360 Degree\n"
-                    "Z   Switch N Center/S Center\n\n"
-                    "--------------- MODE ---------------\n"
-                    "mode ##0 Degree\n"
-                    "@ Center\r\0";
-
-            ptr = strchr(tmp, '@');
-            *ptr = ctx->azimuth_nord_south ? 'S' : 'N';
-            ptr = strchr(tmp, '#');
-            if (ctx->is_450_degrees) {
-                *ptr = '4';
-                *(ptr + 1) = '5';
-            } else {
-                *ptr = '3';
-                *(ptr + 1) = '6';
-            }
+    if (data == NULL || response == NULL)
+        return GS232_FAIL;
 
-            (*ret_str) = strdup(tmp);
-        }
+    while (*data_used < data_len) {
+        if (response_size - *response_len < GS232_RESPONSE_MAX)
+            return GS232_BUFFERTOOSMALL;
 
-            break;
+        res = gs232_stream_next(&(*ctx)->stream, (*ctx)->allocator, data + *data_used, data_len - *data_used, &used, &frame, &frame_len);
+        *data_used += used;
 
-        case GS232_RETURN_CURRENT_AZIMUTH: // C
-        {
-            char tmp[10];
-            sprintf(tmp, "%s%03d\r", ctx->b_protocol ? "AZ=" : "+0", ctx->azimuth);
-            (*ret_str) = strdup(tmp);
+        if (res == GS232_FAIL)
+            continue;
+
+        if (res == GS232_OK)
+            command = gs232_parse_command(ctx, frame, frame_len);
+        else {
+            command = GS232_TOOMANYVALUES;
+            GS232_METRIC(gs232_metrics_command(*ctx, command, 0));
+            if ((*ctx)->capture.log != NULL)
+                gs232_capture_record(*ctx, GS232_CAPTURE_DROP, NULL, 0);
         }
+        if (gs232_return_buffer(*ctx, command, response + *response_len, response_size - *response_len, &ret, &ret_len) != GS232_OK)
+            return GS232_FAIL;
 
-            break;
+        if (ret != response + *response_len)
+            memcpy(response + *response_len, ret, ret_len);
 
-        case GS232_RETURN_AZIMUTH_AND_ELEVATION: // C2
-        {
-            char tmp[19];
-            sprintf(tmp, "%s%03d%s%03d\r\n", ctx->b_protocol ? "AZ=" : "+0", ctx->azimuth, ctx->b_protocol ? "EL=" : "+0", ctx->elevation);
-            (*ret_str) = strdup(tmp);
-        }
+        *response_len += ret_len;
+    }
+
+    return GS232_OK;
+}
+
+uint8_t gs232_stream_reset(gs232_t **ctx) {
+    (*ctx)->stream.len = 0;
+    (*ctx)->stream.discard = false;
+    (*ctx)->stream.protocol = GS232_PROTOCOL_DETECT;
+
+    return GS232_OK;
+}
+
+static const char GS232_RESPONSE_EMPTY[] = "\r";
+static const char GS232_RESPONSE_UNKNOWN[] = "?>\r";
+
+static const char GS232_RESPONSE_LIST_OF_COMMANDS1[] = ""
+        "---------- COMMAND LIST 1 ----------\n"
+        "R  Clockwise Rotation\n"
+        "L  Counter Clockwise Rotation\n"
+        "A  CW/CCW Rotation Stop\n"
+        "C  Antenna Direction Value\n"
+        "M  Antenna Direction Setting. MXXX\n"
+        "M  Time Interval Direction Setting.\n"
+        "   MTTT XXX XXX XXX ---\n"
+        "   (TTT = Step value)\n"
+        "   (XXX = Horizontal Angle)\n"
+        "T  Start Command in the time interval direction setting\n"
+        "   mode.\n"
+        "N  Total number of setting angles in “M” mode and traced\n"
+        "   number of all datas (setting angles)\n"
+        "X1 Rotation Speed 1 (Horizontal) Low\n"
+        "X2 Rotation Speed 2 (Horizontal) Middle 1\n"
+        "X3 Rotation Speed 3 (Horizontal) Middle 2\n"
+        "X4 Rotation Speed 4 (Horizontal) High\n"
+        "S  All Stop\n"
+        "O  Offset Calibration\n"
+        "F  Full Scale Calibration\r";
+
+static const char GS232_RESPONSE_LIST_OF_COMMANDS2[] = ""
+        "---------- HELP COMMAND 2 ----------\n"
+        "U  UP Direction Rotation\n"
+        "D  DOWN Direction Rotation\n"
+        "E  UP/DOWN Direction Rotation Stop\n"
+        "C2 Antenna Direction Value\n"
+        "W  Antenna Direction Setting.\n"
+        "   WXXX YYY\n"
+        "W  Time Interval Direction Setting.\n"
+        "   WTTT XXX YYY XXX YYY ---\n"
+        "   (TTT = Step value)\n"
+        "   (XXX = Horizontal Angle)\n"
+        "   (YYY = Elevation Angle)\n"
+        "T  Start Command in the time interval direction setting\n"
+        "   mode.\n"
+        "N  Total number of setting angle in “W” mode and traced\n"
+        "   number of all datas (setting angles)\n"
+        "S  All Stop\n"
+        "02 Offset Calibration\n"
+        "F2 Full Scale Calibration\n"
+        "B  Elevation Antenna Direction Value\r";
+
+#define GS232_RESPONSE_LIST_OF_COMMANDS3(mode, center) ""  \
+        "---------- HELP COMMAND 3 ----------\n"          \
+        "P45 Set_mode 450 Degree\n"                        \
+        "P36 Set_mode 360 Degree\n"                        \
+        "Z   Switch N Center/S Center\n\n"                 \
+        "--------------- MODE ---------------\n"          \
+        "mode " mode "0 Degree\n"                          \
+        center " Center\r"
+
+typedef struct gs232_response_s {
+    const char *str; /*!< response */
+    uint32_t len;    /*!< response length */
+} gs232_response_t;
+
+#define RESPONSE(s) { s, sizeof(s) - 1 }
+
+// static responses by command, NULL: rendered from context
+static const gs232_response_t gs232_responses[GS232_UNKNOWN_COMMAND + 1] = {
+        [GS232_CLOCKWISE_ROTATION]                             = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_UP_DIRECTION_ROTATION]                          = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_COUNTER_CLOCKWISE_ROTATION]                     = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_DOWN_DIRECTION_ROTATION]                        = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_CW_CCW_ROTATION_STOP]                           = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_UP_DOWN_DIRECTION_ROTATION_STOP]                = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_TURN_DEGREES_AZIMUTH]                           = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH]               = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_TURN_DEGREES_AZIMUTH_AND_ELEVATION]             = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH_AND_ELEVATION] = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_START_COMMAND_IN_TIME_INTERVAL]                 = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_ROTATION_SPEED_LOW]                             = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_ROTATION_SPEED_MIDDLE1]                         = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_ROTATION_SPEED_MIDDLE2]                         = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_ROTATION_SPEED_HIGH]                            = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_OFFSET_CALIBRATION_AZIMUTH]                     = RESPONSE(GS232_RESPONSE_EMPTY), // O  (external command)
+        [GS232_OFFSET_CALIBRATION_ELEVATION]                   = RESPONSE(GS232_RESPONSE_EMPTY), // O2 (external command)
+        [GS232_FULL_SCALE_CALIBRATION_AZIMUTH]                 = RESPONSE(GS232_RESPONSE_EMPTY), // F  (external command)
+        [GS232_FULL_SCALE_CALIBRATION_ELEVATION]               = RESPONSE(GS232_RESPONSE_EMPTY), // F2 (external command)
+        [GS232_ALL_STOP]                                       = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_LIST_OF_COMMANDS1]                              = RESPONSE(GS232_RESPONSE_LIST_OF_COMMANDS1),
+        [GS232_LIST_OF_COMMANDS2]                              = RESPONSE(GS232_RESPONSE_LIST_OF_COMMANDS2),
+        [GS232_AZIMUTH_TO_360]                                 = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_AZIMUTH_TO_450]                                 = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_TOGGLE_AZIMUTH_NORD_SOUTH]                      = RESPONSE(GS232_RESPONSE_EMPTY),
+        [GS232_UNKNOWN_COMMAND]                                = RESPONSE(GS232_RESPONSE_UNKNOWN),
+};
+
+// H3 by [is_450_degrees][azimuth_nord_south]
+static const gs232_response_t gs232_responses_list_of_commands3[2][2] = {
+        { RESPONSE(GS232_RESPONSE_LIST_OF_COMMANDS3("36", "N")), RESPONSE(GS232_RESPONSE_LIST_OF_COMMANDS3("36", "S")) },
+        { RESPONSE(GS232_RESPONSE_LIST_OF_COMMANDS3("45", "N")), RESPONSE(GS232_RESPONSE_LIST_OF_COMMANDS3("45", "S")) },
+};
 
+static const char gs232_digits[200] = ""
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+// zero padded value of 3 or 4 digits (wider values are written in full as printf "%03d"/"%04d")
+static inline char* gs232_format_value(char *p, uint16_t value, uint8_t width) {
+    if (value >= 10000) {
+        *p++ = '0' + value / 10000;
+        value %= 10000;
+        width = 4;
+    } else if (value >= 1000)
+        width = 4;
+
+    if (width == 4) {
+        memcpy(p, gs232_digits + 2 * (value / 100), 2);
+        p += 2;
+    } else
+        *p++ = '0' + value / 100;
+
+    memcpy(p, gs232_digits + 2 * (value % 100), 2);
+    return p + 2;
+}
+
+static inline char* gs232_format_prefix(char *p, const char *prefix) {
+    memcpy(p, prefix, 3);
+    return p + (prefix[2] == '\0' ? 2 : 3);
+}
+
+// hardware functions through position cache (no clock read without them)
+static inline void gs232_position_refresh(gs232_t *ctx, bool azimuth, bool elevation) {
+    if ((azimuth && ctx->fn.get_azimuth != NULL) || (elevation && ctx->fn.get_elevation != NULL))
+        gs232_position_sample(&ctx, gs232_now(), azimuth, elevation);
+}
+
+/*
+ * Position replies (C, C2, B, N) are rendered on reply and kept on the context reply cache, reused while command,
+ * protocol and values are unchanged. The cache is a sequence lock: concurrent pollers never wait for each other.
+ */
+static uint32_t gs232_render_reply(gs232_t *ctx, uint8_t command, char *reply) {
+    bool b_protocol = __atomic_load_n(&ctx->b_protocol, __ATOMIC_RELAXED);
+    uint16_t a = 0, b = 0, azimuth, elevation;
+    uint32_t sequence, len;
+    uint64_t key;
+    bool hit;
+    char *p;
+
+    switch (command) {
+        case GS232_RETURN_CURRENT_AZIMUTH:
+            gs232_position_refresh(ctx, true, false);
+            gs232_position_get(ctx, &azimuth, &elevation);
+            a = azimuth;
             break;
 
-        case GS232_RETURN_CURRENT_ELEVATION: // B
-        {
-            char tmp[10];
-            sprintf(tmp, "%s%03d\r", ctx->b_protocol ? "EL=" : "+0", ctx->elevation);
-            (*ret_str) = strdup(tmp);
-        }
+        case GS232_RETURN_AZIMUTH_AND_ELEVATION:
+            gs232_position_refresh(ctx, true, true);
+            gs232_position_get(ctx, &azimuth, &elevation);
+            a = azimuth;
+            b = elevation;
             break;
 
-        case GS232_OFFSET_CALIBRATION_AZIMUTH: // O
-        {
-            // external command
-            const char tmp[] = "\r\0";
-            (*ret_str) = strdup(tmp);
-        }
+        case GS232_RETURN_CURRENT_ELEVATION:
+            gs232_position_refresh(ctx, false, true);
+            gs232_position_get(ctx, &azimuth, &elevation);
+            b = elevation;
+            break;
 
+        case GS232_TOTAL_NUMBER_OF_SETTING_ANGLES:
+            a = __atomic_load_n(&ctx->memory_current_point, __ATOMIC_RELAXED);
+            b = gs232_track_points(ctx);
             break;
+    }
 
-        case GS232_OFFSET_CALIBRATION_ELEVATION: // O2
-        {
-            // external command
-            const char tmp[] = "\r\0";
-            (*ret_str) = strdup(tmp);
-        }
+    key = ((uint64_t) command << 40) | ((uint64_t) b_protocol << 32) | ((uint32_t) a << 16) | b;
 
-            break;
+    do {
+        sequence = gs232_seqlock_read_begin(&ctx->reply.sequence);
+        len = __atomic_load_n(&ctx->reply.len, __ATOMIC_RELAXED);
+        hit = len != 0 && __atomic_load_n(&ctx->reply.key, __ATOMIC_RELAXED) == key;
+        if (hit)
+            memcpy(reply, ctx->reply.buffer, len);
+    } while (gs232_seqlock_read_retry(&ctx->reply.sequence, sequence));
 
-        case GS232_FULL_SCALE_CALIBRATION_AZIMUTH: // F
-        {
-            // external command
-            const char tmp[] = "\r\0";
-            (*ret_str) = strdup(tmp);
-        }
+    if (hit)
+        return len;
 
+    p = reply;
+    switch (command) {
+        case GS232_RETURN_CURRENT_AZIMUTH: // C
+            p = gs232_format_prefix(p, b_protocol ? "AZ=" : "+0");
+            p = gs232_format_value(p, a, 3);
+            *p++ = '\r';
             break;
 
-        case GS232_FULL_SCALE_CALIBRATION_ELEVATION: // F2
-        {
-            // external command
-            const char tmp[] = "\r\0";
-            (*ret_str) = strdup(tmp);
-        }
-
+        case GS232_RETURN_AZIMUTH_AND_ELEVATION: // C2
+            p = gs232_format_prefix(p, b_protocol ? "AZ=" : "+0");
+            p = gs232_format_value(p, a, 3);
+            p = gs232_format_prefix(p, b_protocol ? "EL=" : "+0");
+            p = gs232_format_value(p, b, 3);
+            *p++ = '\r';
+            *p++ = '\n';
             break;
 
-        case GS232_TOTAL_NUMBER_OF_SETTING_ANGLES: // N
-        {
-            char tmp[16];
-            // TODO: current used point start on 0 or 1 ??
-            sprintf(tmp, "%s%04d%s%04d\r\n", ctx->b_protocol ? "=" : "+", ctx->memory_current_point + 1, ctx->b_protocol ? "=" : "+", ctx->memory_qty);
-            (*ret_str) = strdup(tmp);
-        }
+        case GS232_RETURN_CURRENT_ELEVATION: // B
+            p = gs232_format_prefix(p, b_protocol ? "EL=" : "+0");
+            p = gs232_format_value(p, b, 3);
+            *p++ = '\r';
+            break;
 
+        case GS232_TOTAL_NUMBER_OF_SETTING_ANGLES: // N (traced points, total points)
+            *p++ = b_protocol ? '=' : '+';
+            p = gs232_format_value(p, a, 4);
+            *p++ = b_protocol ? '=' : '+';
+            p = gs232_format_value(p, b, 4);
+            *p++ = '\r';
+            *p++ = '\n';
             break;
+    }
+    len = p - reply;
+
+    // cache is updated only when no other poller is writing it
+    if (gs232_seqlock_write_try(&ctx->reply.sequence)) {
+        __atomic_store_n(&ctx->reply.key, key, __ATOMIC_RELAXED);
+        __atomic_store_n(&ctx->reply.len, len, __ATOMIC_RELAXED);
+        memcpy(ctx->reply.buffer, reply, len);
+        gs232_seqlock_write_end(&ctx->reply.sequence);
+    }
+
+    return len;
+}
+
+static uint8_t gs232_response(gs232_t *ctx, uint8_t command, char *buffer, uint32_t buffer_size, const char **response, uint32_t *response_len) {
+    DBG_PRINT("command: %s\n", COMMAND_STR(command));
+    const gs232_response_t *static_response = &gs232_responses[GS232_UNKNOWN_COMMAND];
+    uint32_t len = 0;
+
+    if (command <= GS232_UNKNOWN_COMMAND && gs232_responses[command].str != NULL)
+        static_response = &gs232_responses[command];
+    else
+        switch (command) {
+            case GS232_LIST_OF_COMMANDS3: // H3
+                static_response = &gs232_responses_list_of_commands3[__atomic_load_n(&ctx->is_450_degrees, __ATOMIC_RELAXED)][__atomic_load_n(
+                        &ctx->azimuth_nord_south, __ATOMIC_RELAXED)];
+                break;
+
+            case GS232_RETURN_CURRENT_AZIMUTH:         // C
+            case GS232_RETURN_AZIMUTH_AND_ELEVATION:   // C2
+            case GS232_RETURN_CURRENT_ELEVATION:       // B
+            case GS232_TOTAL_NUMBER_OF_SETTING_ANGLES: // N
+            {
+                char reply[GS232_REPLY_MAX];
 
-        default: {
-            const char tmp[] = "?>\r\0";
-            (*ret_str) = strdup(tmp);
+                len = gs232_render_reply(ctx, command, reply);
+                if (buffer_size < len)
+                    return GS232_BUFFERTOOSMALL;
+
+                memcpy(buffer, reply, len);
+            }
+                break;
         }
-            break;
+
+    if (len != 0) {
+        *response = buffer;
+        *response_len = len;
+    } else {
+        *response = static_response->str;
+        *response_len = static_response->len;
     }
 
-    DBG_PRINT("return string: %s\n", (*ret_str));
-    DBG_HEX((*ret_str), strlen((*ret_str)));
+    DBG_PRINT("return string: %.*s\n", (int) (*response_len), (*response));
+    DBG_HEX((*response), (*response_len));
+    GS232_TRACE(GS232_TRACE_DEBUG, GS232_TRACE_EVENT_RESPONSE, ctx, command, *response_len);
+    return GS232_OK;
+}
+
+uint8_t gs232_return_buffer(gs232_t *ctx, uint8_t command, char *buffer, uint32_t buffer_size, const char **response, uint32_t *response_len) {
+    uint64_t start = GS232_METRIC_BEGIN(ctx, GS232_METRICS_RESPOND);
+    uint8_t res = gs232_response(ctx, command, buffer, buffer_size, response, response_len);
+
+    GS232_METRIC(gs232_metrics_end(ctx, GS232_METRICS_RESPOND, start));
+    if (res == GS232_OK)
+        GS232_METRIC(gs232_metrics_response(ctx, *response_len));
+    if (res == GS232_OK && ctx->capture.log != NULL)
+        gs232_capture_record(ctx, GS232_CAPTURE_OUT, *response, *response_len);
+    return res;
+}
+
+uint8_t gs232_return_string(gs232_t *ctx, uint8_t command, char **ret_str) {
+    char buffer[GS232_RESPONSE_MAX];
+    const char *response;
+    uint32_t response_len;
+    uint8_t res;
+
+    if ((res = gs232_return_buffer(ctx, command, buffer, sizeof(buffer), &response, &response_len)) != GS232_OK)
+        return res;
+
+    (*ret_str) = gs232_alloc(ctx->allocator, response_len + 1);
+    if ((*ret_str) == NULL)
+        return GS232_FAIL;
+
+    memcpy((*ret_str), response, response_len);
+    (*ret_str)[response_len] = '\0';
+
     return GS232_OK;
 }
 
+void gs232_return_string_free(gs232_t *ctx, char *ret_str) {
+    if (ret_str != NULL)
+        gs232_free(ctx->allocator, ret_str, strlen(ret_str) + 1);
+}
+
 uint8_t gs232_init(gs232_t **ctx) {
-    *ctx = malloc(sizeof(gs232_t));
+    return gs232_init_allocator(ctx, NULL);
+}
+
+uint8_t gs232_init_allocator(gs232_t **ctx, const gs232_allocator_t *allocator) {
+    *ctx = gs232_alloc(allocator, sizeof(gs232_t));
     if (*ctx == NULL)
         return GS232_FAIL;
 
+    (*ctx)->allocator = allocator;
+    (*ctx)->actuator = NULL;
+    (*ctx)->trajectory = NULL;
+
     (*ctx)->azimuth = 0;
     (*ctx)->elevation = 0;
     (*ctx)->b_protocol = false;
     (*ctx)->azimuth_nord_south = false;
     (*ctx)->is_450_degrees = false;
     (*ctx)->rotation_speed = 1;
+    (*ctx)->memory = (*ctx)->memory_inline[0];
     (*ctx)->memory_qty = 0;
+    (*ctx)->memory_size = GS232_MEMORY_INLINE;
+    (*ctx)->memory_spare = NULL;
+    (*ctx)->memory_spare_size = 0;
     (*ctx)->memory_current_point = 0;
+    (*ctx)->memory_sequence = 0;
+    (*ctx)->memory_readers = 0;
+    (*ctx)->values_error = GS232_OK;
+    (*ctx)->track.running = false;
+    (*ctx)->track.command = GS232_UNKNOWN_COMMAND;
+    (*ctx)->track.start = 0;
+    (*ctx)->track.next = 0;
+    pthread_mutex_init(&(*ctx)->track.lock, NULL);
+    (*ctx)->fn.set_azimuth = NULL;
+    (*ctx)->fn.get_azimuth = NULL;
+    (*ctx)->fn.set_elevation = NULL;
+    (*ctx)->fn.get_elevation = NULL;
+    (*ctx)->fn.offset_calibration_azimuth = NULL;
+    (*ctx)->fn.offset_calibration_elevation = NULL;
+    (*ctx)->fn.full_scale_calibration_azimuth = NULL;
+    (*ctx)->fn.full_scale_calibration_elevation = NULL;
+    (*ctx)->stream.buffer = NULL;
+    (*ctx)->stream.len = 0;
+    (*ctx)->stream.discard = false;
+    (*ctx)->stream.protocol = GS232_PROTOCOL_DETECT;
+    (*ctx)->filter.fn = NULL;
+    (*ctx)->filter.arg = NULL;
+    (*ctx)->persist = NULL;
+    (*ctx)->capture.log = NULL;
+    (*ctx)->capture.context = 0;
+    (*ctx)->capture.session = 0;
+    (*ctx)->reply.sequence = 0;
+    (*ctx)->reply.key = 0;
+    (*ctx)->reply.len = 0;
+    (*ctx)->position.sequence = 0;
+    (*ctx)->position.sampling = false;
+    (*ctx)->position.max_age = GS232_POSITION_MAX_AGE;
+    (*ctx)->position.azimuth_time = 0;
+    (*ctx)->position.elevation_time = 0;
+    (*ctx)->position.azimuth_valid = false;
+    (*ctx)->position.elevation_valid = false;
+#if GS232_METRICS
+    (*ctx)->metrics = NULL;
+#endif
 
-    for (uint16_t n = 0; n < MEMORY_POINTS; n++)
-        (*ctx)->memory[n] = 0;
+    for (uint16_t n = 0; n < GS232_MEMORY_INLINE; n++) {
+        (*ctx)->memory_inline[0][n] = 0;
+        (*ctx)->memory_inline[1][n] = 0;
+    }
 
     return GS232_OK;
 }
 
 uint8_t gs232_deinit(gs232_t **ctx) {
-    if (*ctx != NULL)
-        free(*ctx);
+    if (*ctx != NULL) {
+        if ((*ctx)->memory != (*ctx)->memory_inline[0] && (*ctx)->memory != (*ctx)->memory_inline[1])
+            gs232_memory_release((*ctx)->allocator, (*ctx)->memory, (*ctx)->memory_size);
+
+        gs232_memory_release((*ctx)->allocator, (*ctx)->memory_spare, (*ctx)->memory_spare_size);
+        gs232_trajectory_release(ctx);
+        pthread_mutex_destroy(&(*ctx)->track.lock);
+#if GS232_METRICS
+        gs232_free((*ctx)->allocator, (*ctx)->metrics, sizeof(gs232_metrics_t));
+#endif
+
+        gs232_free((*ctx)->allocator, (*ctx)->stream.buffer, GS232_FRAME_MAX);
+        gs232_free((*ctx)->allocator, *ctx, sizeof(gs232_t));
+    }
 
     return GS232_OK;
 }
 
 /////////////////// utils ///////////////////
 
-uint32_t shortest_path(float start_azimuth, float start_elevation, float end_azimuth, float end_elevation, float **intermediatePoints_azimuth,
-        float **intermediatePoints_elevation, float *azimuth, float *elevation) {
-    float azimuthDiff = end_azimuth - start_azimuth;
-    float elevationDiff = end_elevation - start_elevation;
-    float distance = sqrt(azimuthDiff * azimuthDiff + elevationDiff * elevationDiff);
+static uint64_t gs232_clock_monotonic(void) {
+    struct timespec ts;
 
-    *azimuth = atan2f(azimuthDiff, elevationDiff);
-    *elevation = distance;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static gs232_clock clock_ns = gs232_clock_monotonic;
+
+void gs232_set_clock(gs232_clock clock) {
+    clock_ns = (clock == NULL) ? gs232_clock_monotonic : clock;
+}
 
-    uint32_t numIntermediatePoints = (uint32_t) ceil(distance);
+uint64_t gs232_now(void) {
+    return clock_ns();
+}
+
+uint32_t shortest_path(float start_azimuth, float start_elevation, float end_azimuth, float end_elevation, float **intermediatePoints_azimuth,
+        float **intermediatePoints_elevation, float *azimuth, float *elevation) {
+    gs232_path_t path;
 
-    *intermediatePoints_azimuth = (float*) malloc(numIntermediatePoints * sizeof(float));
-    *intermediatePoints_elevation = (float*) malloc(numIntermediatePoints * sizeof(float));
+    gs232_path_init(&path, start_azimuth, start_elevation, end_azimuth, end_elevation, GS232_PATH_RESOLUTION);
 
-    float azimuthStep = azimuthDiff / numIntermediatePoints;
-    float elevationStep = elevationDiff / numIntermediatePoints;
+    // legacy outputs: direction (radians) and distance
+    *azimuth = atan2f(end_azimuth - start_azimuth, end_elevation - start_elevation);
+    *elevation = path.distance;
 
-    for (int i = 0; i < numIntermediatePoints; i++) {
-        (*intermediatePoints_azimuth)[i] = start_azimuth + i * azimuthStep;
-        (*intermediatePoints_elevation)[i] = start_elevation + i * elevationStep;
+    *intermediatePoints_azimuth = (float*) gs232_alloc(NULL, path.points * sizeof(float));
+    *intermediatePoints_elevation = (float*) gs232_alloc(NULL, path.points * sizeof(float));
+    if (*intermediatePoints_azimuth == NULL || *intermediatePoints_elevation == NULL) {
+        gs232_free(NULL, *intermediatePoints_azimuth, path.points * sizeof(float));
+        gs232_free(NULL, *intermediatePoints_elevation, path.points * sizeof(float));
+        *intermediatePoints_azimuth = *intermediatePoints_elevation = NULL;
+        return 0;
     }
 
-    return numIntermediatePoints;
+    // start included, end excluded
+    return gs232_path_fill(&path, 0, path.points, *intermediatePoints_azimuth, *intermediatePoints_elevation);
 }
@@ -16,9 +16,16 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <pthread.h>
+
+#include "gs232_alloc.h"
+#include "gs232_memory.h"
+#include "gs232_metrics.h"
 
-#define DEBUG               /*!< debug mode */
 #define MEMORY_POINTS  3800 /*!< total memory points */
+#define GS232_RESPONSE_MAX 1024 /*!< maximum response length */
+#define GS232_FRAME_MAX    (4 * MEMORY_POINTS + 2) /*!< maximum command frame length (Wttt aaa eee ...\r\n) */
+#define GS232_REPLY_MAX    20 /*!< maximum position reply length (AZ=aaaaaEL=eeeee\r\n) */
 
 /**
  * @enum GS232_ERROR
@@ -26,11 +33,12 @@
  *
  */
 enum GS232_ERROR {
-    GS232_FAIL          = 250, /*!< generic error */
-    GS232_TOOMANYVALUES = 251, /*!< too many values */
-    GS232_OUTOFRANGE    = 252, /*!< value out of range */
-    //----------------------//
-    GS232_OK            = 255, /*!< ok */
+    GS232_FAIL           = 250, /*!< generic error */
+    GS232_TOOMANYVALUES  = 251, /*!< too many values */
+    GS232_OUTOFRANGE     = 252, /*!< value out of range */
+    GS232_BUFFERTOOSMALL = 253, /*!< buffer too small */
+    //-----------------------//
+    GS232_OK             = 255, /*!< ok */
 };
 
 /**
@@ -145,6 +153,57 @@ typedef bool (*rotator_full_scale_calibration_azimuth)(gs232_t **ctx);
  */
 typedef bool (*rotator_full_scale_calibration_elevation)(gs232_t **ctx);
 
+/**
+ * @fn void (*gs232_command_callback)(gs232_t **ctx, uint8_t command, void *arg)
+ * @brief Parsed command from stream
+ *
+ * @param ctx gs232 context
+ * @param command Parsed command or GS232_ERROR
+ * @param arg User argument
+ */
+typedef void (*gs232_command_callback)(gs232_t **ctx, uint8_t command, void *arg);
+
+/**
+ * @fn bool (*gs232_command_filter)(gs232_t *ctx, uint8_t command, void *arg)
+ * @brief Command admission, called before a command is executed
+ *
+ * @param ctx gs232 context
+ * @param command Command (ASCII: first command of letter, e.g. GS232_TURN_DEGREES_AZIMUTH for every M command)
+ * @param arg User argument
+ * @return false: command is not executed (parsed as GS232_UNKNOWN_COMMAND)
+ */
+typedef bool (*gs232_command_filter)(gs232_t *ctx, uint8_t command, void *arg);
+
+/**
+ * @fn uint64_t (*gs232_clock)(void)
+ * @brief Monotonic clock
+ *
+ * @return Time (ns)
+ */
+typedef uint64_t (*gs232_clock)(void);
+
+/**
+ * @enum GS232_PROTOCOL
+ * @brief Stream protocol
+ *
+ */
+enum GS232_PROTOCOL {
+    GS232_PROTOCOL_DETECT, /*!< not detected (no data received) */
+    GS232_PROTOCOL_ASCII,  /*!< GS-232 commands */
+    GS232_PROTOCOL_BINARY, /*!< binary frames (gs232_binary.h) */
+};
+
+/**
+ * @typedef gs232_stream_t
+ * @brief Stream framing state
+ *
+ */
+typedef struct gs232_stream_s {
+        char *buffer;  /*!< partial frame (allocated on first split frame) */
+    uint32_t len;      /*!< partial frame length */
+        bool discard;  /*!< dropping overlong frame until end */
+     uint8_t protocol; /*!< GS232_PROTOCOL of connection (gs232_binary_detect) */
+} gs232_stream_t; /*!< stream */
 
 /**
  * @typedef gs232_t
@@ -156,11 +215,28 @@ typedef struct gs232_s {
         bool is_450_degrees;          /*!< is 450 degrees mode */
         bool azimuth_nord_south;      /*!< center [0:north, 1:south] */
      uint8_t rotation_speed;          /*!< from command X */
-    uint16_t azimuth;                 /*!< actual azimuth */
-    uint16_t elevation;               /*!< actual elevation */
-    uint16_t memory[MEMORY_POINTS];   /*!< memory */
+    uint16_t azimuth;                 /*!< actual azimuth (last read of get_azimuth) */
+    uint16_t elevation;               /*!< actual elevation (last read of get_elevation) */
+    uint16_t *memory;                 /*!< memory (memory_inline or block from memory pool), replaced with gs232_memory_publish */
     uint16_t memory_qty;              /*!< memory used */
-    uint16_t memory_current_point;    /*!< currently selected memorized point */
+    uint16_t memory_size;             /*!< memory capacity */
+    uint16_t *memory_spare;           /*!< retired memory block kept for next upload */
+    uint16_t memory_spare_size;       /*!< retired memory block capacity */
+    uint16_t memory_current_point;    /*!< executed points of timed track */
+    uint32_t memory_sequence;         /*!< memory, memory_size, memory_qty and track.command sequence lock */
+    uint32_t memory_readers;          /*!< memory read sections */
+     uint8_t values_error;            /*!< GS232_ERROR of values of last parsed frame (GS232_OK: valid or no values) */
+    struct {
+            bool running;             /*!< timed track running */
+         uint8_t command;             /*!< timed track command on memory (GS232_UNKNOWN_COMMAND: none) */
+        uint64_t start;               /*!< start time (ns) */
+        uint64_t next;                /*!< next point time (ns) */
+ pthread_mutex_t lock;                /*!< running, start, next and memory_current_point lock */
+    } track; /*!< timed tracking */
+    uint16_t memory_inline[2][GS232_MEMORY_INLINE]; /*!< memory for single point commands (published and next) */
+    const gs232_allocator_t *allocator; /*!< context allocator (NULL: global allocator) */
+    struct gs232_actuator_s *actuator;  /*!< asynchronous actuator (NULL: hardware functions are not called on parse) */
+    struct gs232_trajectory_s *trajectory; /*!< smoothed timed track on memory (NULL: points are executed as uploaded), track.lock */
     struct {
                              rotator_set_azimuth set_azimuth;                      /*!< hardware function: set azimuth */
                              rotator_get_azimuth get_azimuth;                      /*!< hardware function: get azimuth */
@@ -171,6 +247,35 @@ typedef struct gs232_s {
           rotator_full_scale_calibration_azimuth full_scale_calibration_azimuth;   /*!< hardware function: azimuth full scale calibration */
         rotator_full_scale_calibration_elevation full_scale_calibration_elevation; /*!< hardware function: elevation full scale calibration */
     } fn; /*!< hardware functions */
+    gs232_stream_t stream;            /*!< stream framing state */
+    struct {
+        gs232_command_filter fn;      /*!< admission of commands (NULL: all commands are executed) */
+                        void *arg;    /*!< filter user argument */
+    } filter; /*!< command filter (gs232_gateway.h) */
+    struct gs232_persist_s *persist;  /*!< persistent state (NULL: not saved, gs232_persist.h) */
+    struct {
+        struct gs232_capture_s *log;     /*!< capture log (NULL: not captured, gs232_capture.h) */
+                      uint32_t context; /*!< context number on log */
+                      uint32_t session; /*!< session of records */
+    } capture; /*!< session capture */
+    struct {
+        uint32_t sequence;            /*!< reply sequence lock */
+        uint64_t key;                 /*!< command, protocol and values of rendered reply */
+         uint8_t len;                 /*!< reply length (0: none) */
+            char buffer[GS232_REPLY_MAX]; /*!< rendered reply */
+    } reply; /*!< last position reply (C, C2, B, N) */
+    struct {
+        uint32_t sequence;            /*!< azimuth and elevation sequence lock */
+            bool sampling;            /*!< hardware read in progress */
+        uint64_t max_age;             /*!< maximum age of hardware reads (ns) */
+        uint64_t azimuth_time;        /*!< azimuth read time (ns) */
+        uint64_t elevation_time;      /*!< elevation read time (ns) */
+            bool azimuth_valid;       /*!< azimuth read from hardware */
+            bool elevation_valid;     /*!< elevation read from hardware */
+    } position; /*!< position cache of get_azimuth/get_elevation hardware functions */
+#if GS232_METRICS
+    gs232_metrics_t *metrics;         /*!< context metrics, allocated on first update (gs232_metrics_snapshot) */
+#endif
 } gs232_t; /*!< context */
 
 /**
@@ -182,6 +287,16 @@ typedef struct gs232_s {
  */
 uint8_t gs232_init(gs232_t **ctx);
 
+/**
+ * @fn uint8_t gs232_init_allocator(gs232_t **ctx, const gs232_allocator_t *allocator)
+ * @brief Initialize context, all context allocations (context included) use allocator
+ *
+ * @param ctx Context
+ * @param allocator Allocator (NULL: global allocator). Must be valid until context is destroyed
+ * @return GS232_ERROR
+ */
+uint8_t gs232_init_allocator(gs232_t **ctx, const gs232_allocator_t *allocator);
+
 /**
  * @fn uint8_t gs232_deinit(gs232_t **gs232)
  * @brief Destroy context
@@ -192,7 +307,7 @@ uint8_t gs232_init(gs232_t **ctx);
 uint8_t gs232_deinit(gs232_t **ctx);
 
 /**
- * @fn uint8_t gs232_parse_command(gs232_t **ctx, char *buffer, uint32_t buffer_len)
+ * @fn uint8_t gs232_parse_command(gs232_t **ctx, const char *buffer, uint32_t buffer_len)
  * @brief Parse received command buffer
  *
  * @param context Context
@@ -200,11 +315,85 @@ uint8_t gs232_deinit(gs232_t **ctx);
  * @param buffer_len Received command buffer length
  * @return Command or GS232_ERROR
  */
-uint8_t gs232_parse_command(gs232_t **ctx, char *buffer, uint32_t buffer_len);
+uint8_t gs232_parse_command(gs232_t **ctx, const char *buffer, uint32_t buffer_len);
 
 /**
- * @fn uint8_t gs232_return_string(gs232_t *ctx, uint8_t command, char *ret_str)
+ * @fn uint8_t gs232_parse_binary(gs232_t **ctx, uint8_t command, const uint8_t *values, uint16_t qty)
+ * @brief Execute decoded command (binary protocol): same result of the ASCII command
+ *
+ * @param ctx Context
+ * @param command Command (GS232_COMMAND)
+ * @param values Values of M/W commands (little endian uint16, same order of ASCII values)
+ * @param qty Values (0 for commands without values)
+ * @return Command or GS232_ERROR
+ */
+uint8_t gs232_parse_binary(gs232_t **ctx, uint8_t command, const uint8_t *values, uint16_t qty);
+
+/**
+ * @fn uint8_t gs232_stream_feed(gs232_t **ctx, const char *data, uint32_t data_len, gs232_command_callback callback, void *arg)
+ * @brief Feed received bytes to stream parser
+ * @details Bytes can contain any number of commands and partial commands. Partial commands are kept on context until completed.
+ *          Every complete command is parsed and passed to callback. Overlong commands are dropped and reported as GS232_TOOMANYVALUES.
+ *
+ * @param ctx Context
+ * @param data Received bytes
+ * @param data_len Received bytes length
+ * @param callback Parsed command callback
+ * @param arg Callback user argument
+ * @return GS232_ERROR
+ */
+uint8_t gs232_stream_feed(gs232_t **ctx, const char *data, uint32_t data_len, gs232_command_callback callback, void *arg);
+
+/**
+ * @fn uint8_t gs232_stream_batch(gs232_t **ctx, const char *data, uint32_t data_len, uint32_t *data_used, char *response, uint32_t response_size,
+        uint32_t *response_len)
+ * @brief Parse all commands on received bytes and create all responses on a single buffer
+ * @details Like gs232_stream_feed but responses are appended on response buffer, ready for a single write.
+ *          Stops when less than GS232_RESPONSE_MAX bytes are free on response buffer, then call again with the remaining data.
+ *
+ * @param ctx Context
+ * @param data Received bytes
+ * @param data_len Received bytes length
+ * @param data_used Consumed bytes
+ * @param response Responses buffer
+ * @param response_size Responses buffer size
+ * @param response_len Responses length
+ * @return GS232_OK if all data was consumed, GS232_BUFFERTOOSMALL if response buffer is full
+ */
+uint8_t gs232_stream_batch(gs232_t **ctx, const char *data, uint32_t data_len, uint32_t *data_used, char *response, uint32_t response_size,
+        uint32_t *response_len);
+
+/**
+ * @fn uint8_t gs232_stream_reset(gs232_t **ctx)
+ * @brief Discard partial command on stream parser (protocol of connection is detected again)
+ *
+ * @param ctx Context
+ * @return GS232_ERROR
+ */
+uint8_t gs232_stream_reset(gs232_t **ctx);
+
+/**
+ * @fn uint8_t gs232_return_buffer(gs232_t *ctx, uint8_t command, char *buffer, uint32_t buffer_size, const char **response, uint32_t *response_len)
+ * @brief Create response for parsed command without allocation
+ * @details Static responses point to internal read-only storage, the other ones are written on buffer (not null terminated).
+ *          A buffer of GS232_RESPONSE_MAX bytes is always enough. Position replies (C, C2, B, N) are rendered once on the
+ *          context reply cache and reused while their values are unchanged.
+ *
+ * @param context Context
+ * @param command Parsed command
+ * @param buffer Caller buffer for rendered responses
+ * @param buffer_size Caller buffer size
+ * @param response Response (on buffer or static storage)
+ * @param response_len Response length
+ * @return GS232_ERROR
+ */
+uint8_t gs232_return_buffer(gs232_t *ctx, uint8_t command, char *buffer, uint32_t buffer_size, const char **response, uint32_t *response_len);
+
+/**
+ * @fn uint8_t gs232_return_string(gs232_t *ctx, uint8_t command, char **ret_str)
  * @brief Create return string for parsed command buffer
+ * @details Wrapper of gs232_return_buffer. Return string must be released with gs232_return_string_free
+ *          (or free when using the default allocator)
  *
  * @param context Context
  * @param command Parsed command
@@ -213,12 +402,39 @@ uint8_t gs232_parse_command(gs232_t **ctx, char *buffer, uint32_t buffer_len);
  */
 uint8_t gs232_return_string(gs232_t *ctx, uint8_t command, char **ret_str);
 
+/**
+ * @fn void gs232_return_string_free(gs232_t *ctx, char *ret_str)
+ * @brief Release string from gs232_return_string
+ *
+ * @param ctx Context
+ * @param ret_str Return string
+ */
+void gs232_return_string_free(gs232_t *ctx, char *ret_str);
+
 /////////////////// utils ///////////////////
 
+/**
+ * @fn void gs232_set_clock(gs232_clock clock)
+ * @brief Set clock used by library (NULL: CLOCK_MONOTONIC)
+ *
+ * @param clock Clock
+ */
+void gs232_set_clock(gs232_clock clock);
+
+/**
+ * @fn uint64_t gs232_now(void)
+ * @brief Current time from library clock
+ *
+ * @return Time (ns)
+ */
+uint64_t gs232_now(void);
+
 /**
  * @fn uint32_t shortest_path(float start_azimuth, float start_elevation, float end_azimuth, float end_elevation, float **intermediatePoints_azimuth,
         float **intermediatePoints_elevation, float *azimuth, float *elevation)
  * @brief Calculate the shortest path between two points, return intermediate points
+ * @details Intermediate points are allocated with global allocator: gs232_free(NULL, points, number_of_points * sizeof(float)).
+ *          Legacy interface: gs232_path_init/gs232_path_fill/gs232_path_next work on caller buffers without allocation
  *
  * @param start_azimuth Azimuth start point
  * @param start_elevation Elevation start point
@@ -226,8 +442,8 @@ uint8_t gs232_return_string(gs232_t *ctx, uint8_t command, char **ret_str);
  * @param end_elevation elevation end point
  * @param intermediatePoints_azimuth Azimuth intermediate points
  * @param intermediatePoints_elevation Elevation intermediate points
- * @param azimuth Azimuth
- * @param elevation Elevation
+ * @param azimuth Direction of travel (radians, atan2 of azimuth and elevation differences)
+ * @param elevation Distance (degrees)
  * @return Number of intermediate points
  */
 uint32_t shortest_path(float start_azimuth, float start_elevation, float end_azimuth, float end_elevation, float **intermediatePoints_azimuth,
@@ -0,0 +1,108 @@
+/**
+ * @planner.c
+ *
+ * @brief Azimuth route planner test
+ * @details Table of routes on north/south center and 360/450 degrees mode: azimuth to command and mechanical travel.
+ *          Every mechanical position of every mode must map to a value in the range of the mode and back to itself.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libGS232.h"
+#include "gs232_planner.h"
+
+typedef struct planner_case_s {
+        bool south_center;   /*!< azimuth_nord_south (counter clockwise stop at north) */
+        bool is_450_degrees; /*!< 450 degrees mode */
+    uint16_t current;        /*!< current azimuth */
+    uint16_t target;         /*!< target azimuth */
+    uint16_t azimuth;        /*!< azimuth to command */
+     int16_t travel;         /*!< mechanical travel */
+} planner_case_t;
+
+static const planner_case_t cases[] = {
+        // from counter clockwise stop
+        { true, false, 0, 0, 0, 0 },
+        { true, false, 0, 359, 359, 359 },
+        { true, false, 0, 360, 360, 360 },
+        { true, false, 0, 450, 90, 90 },
+        { true, true, 0, 0, 0, 0 },
+        { true, true, 0, 359, 359, 359 },
+        { true, true, 0, 360, 360, 360 },
+        { true, true, 0, 450, 450, 450 },
+        { false, false, 180, 0, 0, 180 },
+        { false, false, 180, 359, 359, 179 },
+        { false, false, 180, 360, 360, 360 },
+        { false, false, 180, 450, 90, 270 },
+        { false, true, 180, 0, 0, 180 },
+        { false, true, 180, 359, 359, 179 },
+        { false, true, 180, 360, 360, 360 },
+        { false, true, 180, 450, 450, 450 },
+        // from the overlap: same direction on the second turn when nearer
+        { true, true, 400, 0, 360, -40 },
+        { true, true, 400, 30, 390, -10 },
+        { true, true, 400, 400, 400, 0 },
+        { false, true, 400, 200, 380, -20 },
+        { false, true, 400, 0, 0, -220 },
+        { false, true, 450, 270, 450, 0 },
+};
+
+static uint32_t failures;
+
+static void fail(const planner_case_t *c, const char *what, int32_t expected, int32_t got) {
+    if (failures++ < 20)
+        printf("FAIL %s center, %u degrees, %u -> %u: %s expected %d, got %d\n", c->south_center ? "south" : "north",
+                c->is_450_degrees ? 450 : 360, c->current, c->target, what, expected, got);
+}
+
+int main(void) {
+    uint32_t checks = 0;
+    uint16_t azimuth, span;
+    int16_t travel;
+    gs232_t *ctx;
+
+    if (gs232_init(&ctx) != GS232_OK)
+        return 1;
+
+    for (uint32_t n = 0; n < sizeof(cases) / sizeof(cases[0]); n++, checks++) {
+        ctx->azimuth_nord_south = cases[n].south_center;
+        ctx->is_450_degrees = cases[n].is_450_degrees;
+
+        azimuth = gs232_planner_azimuth(ctx, cases[n].current, cases[n].target, &travel);
+        if (azimuth != cases[n].azimuth)
+            fail(&cases[n], "azimuth", cases[n].azimuth, azimuth);
+        if (travel != cases[n].travel)
+            fail(&cases[n], "travel", cases[n].travel, travel);
+    }
+
+    // every mechanical position: value in range of mode, same position back
+    for (uint8_t mode = 0; mode < 4; mode++) {
+        planner_case_t c = { mode & 1, mode & 2, 0, 0, 0, 0 };
+
+        ctx->azimuth_nord_south = c.south_center;
+        ctx->is_450_degrees = c.is_450_degrees;
+        span = c.is_450_degrees ? 450 : 360;
+
+        for (uint16_t mechanical = 0; mechanical <= span; mechanical++, checks++) {
+            c.current = c.target = mechanical;
+            azimuth = gs232_planner_value(ctx, mechanical);
+            if (azimuth > span)
+                fail(&c, "value in range", span, azimuth);
+            if (gs232_planner_mechanical(ctx, azimuth) != mechanical)
+                fail(&c, "mechanical of value", mechanical, gs232_planner_mechanical(ctx, azimuth));
+        }
+    }
+
+    gs232_deinit(&ctx);
+
+    printf("planner: %u checks, %u failures\n", checks, failures);
+    return failures == 0 ? 0 : 1;
+}
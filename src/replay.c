@@ -0,0 +1,423 @@
+/**
+ * @replay.c
+ *
+ * @brief Capture replay
+ * @details Feeds the sessions of a capture log (gs232_capture.h) into new contexts, at original timing or as fast as
+ *          possible, and verifies that every response is byte-identical to the captured one. Every captured context
+ *          can be replayed on many copies (load generator). Output: mismatches and one JSON object line.
+ *
+ *          The library clock runs on capture time: timed tracks, arbitration holds and position cache ages are the
+ *          captured ones at any replay speed. Captured positions are stored on the contexts before the frames whose
+ *          responses reported them, replay contexts have no hardware functions. Timed tracks are ticked only where
+ *          the capture recorded a tick, at the captured time from track start, and must reach the same point.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libGS232.h"
+#include "gs232_track.h"
+#include "gs232_binary.h"
+#include "gs232_position.h"
+#include "gs232_gateway.h"
+#include "gs232_metrics.h"
+#include "gs232_capture.h"
+
+#define REPLAY_MISMATCHES  10   /*!< default reported mismatches */
+#define REPLAY_OUTPUT_SIZE 4096 /*!< response buffer */
+
+typedef struct replay_context_s {
+               bool valid;    /*!< context record seen */
+               bool shared;   /*!< gateway context */
+            gs232_t **ctx;    /*!< copies */
+    gs232_gateway_t *gateway; /*!< gateways of copies (shared) */
+} replay_context_t;
+
+typedef struct replay_session_s {
+          uint32_t context;  /*!< context number */
+           uint8_t priority; /*!< client priority */
+    gs232_stream_t *stream;  /*!< streams of copies (shared) */
+} replay_session_t;
+
+static uint64_t replay_clock_now;
+static uint32_t copies = 1;
+static replay_context_t *contexts;
+static uint32_t contexts_qty;
+static replay_session_t *sessions;
+static uint32_t sessions_qty;
+
+static uint64_t replay_clock(void) {
+    return replay_clock_now;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+    return (uint16_t) (p[0] | p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static uint64_t get_u64(const uint8_t *p) {
+    return (uint64_t) get_u32(p) | (uint64_t) get_u32(p + 4) << 32;
+}
+
+static void print_escaped(const char *title, const uint8_t *data, uint32_t len) {
+    printf("  %s (%u): \"", title, len);
+    for (uint32_t n = 0; n < len; n++) {
+        if (data[n] >= 0x20 && data[n] < 0x7f && data[n] != '"' && data[n] != '\\')
+            putchar(data[n]);
+        else
+            printf("\\x%02x", data[n]);
+    }
+    printf("\"\n");
+}
+
+static replay_context_t* replay_context(uint32_t number) {
+    return (number != 0 && number <= contexts_qty && contexts[number - 1].valid) ? &contexts[number - 1] : NULL;
+}
+
+static replay_session_t* replay_session(uint32_t number) {
+    return (number != 0 && number <= sessions_qty && sessions[number - 1].context != 0) ? &sessions[number - 1] : NULL;
+}
+
+static bool replay_context_create(const gs232_capture_record_t *record) {
+    replay_context_t *context;
+    uint8_t policy;
+
+    if (record->session == 0 || record->len < 17)
+        return false;
+
+    if (record->session > contexts_qty) {
+        contexts = realloc(contexts, record->session * sizeof(replay_context_t));
+        memset(contexts + contexts_qty, 0, (record->session - contexts_qty) * sizeof(replay_context_t));
+        contexts_qty = record->session;
+    }
+
+    context = &contexts[record->session - 1];
+    context->valid = true;
+    context->ctx = calloc(copies, sizeof(gs232_t*));
+    policy = record->data[8];
+    context->shared = policy != GS232_CAPTURE_NONE;
+    if (context->shared)
+        context->gateway = calloc(copies, sizeof(gs232_gateway_t));
+
+    for (uint32_t c = 0; c < copies; c++) {
+        if (gs232_init(&context->ctx[c]) != GS232_OK)
+            return false;
+
+        context->ctx[c]->b_protocol = record->data[0];
+        context->ctx[c]->is_450_degrees = record->data[1];
+        context->ctx[c]->azimuth_nord_south = record->data[2];
+        context->ctx[c]->rotation_speed = record->data[3];
+        gs232_position_set(&context->ctx[c], get_u16(record->data + 4), get_u16(record->data + 6));
+
+        if (context->shared && gs232_gateway_init(&context->gateway[c], context->ctx[c], policy, 0, get_u64(record->data + 9)) != GS232_OK)
+            return false;
+    }
+
+    return true;
+}
+
+static bool replay_session_open(const gs232_capture_record_t *record) {
+    if (record->session == 0 || record->len < 5)
+        return false;
+
+    if (record->session > sessions_qty) {
+        sessions = realloc(sessions, record->session * sizeof(replay_session_t));
+        memset(sessions + sessions_qty, 0, (record->session - sessions_qty) * sizeof(replay_session_t));
+        sessions_qty = record->session;
+    }
+
+    sessions[record->session - 1].context = get_u32(record->data);
+    sessions[record->session - 1].priority = record->data[4];
+    sessions[record->session - 1].stream = calloc(copies, sizeof(gs232_stream_t));
+
+    return true;
+}
+
+static void replay_position(replay_context_t *context, const gs232_capture_record_t *record) {
+    uint16_t azimuth, elevation;
+
+    if (record->len < 5)
+        return;
+
+    for (uint32_t c = 0; c < copies; c++) {
+        gs232_position_get(context->ctx[c], &azimuth, &elevation);
+        if (record->data[4] & 1)
+            azimuth = get_u16(record->data);
+        if (record->data[4] & 2)
+            elevation = get_u16(record->data + 2);
+        gs232_position_set(&context->ctx[c], azimuth, elevation);
+    }
+}
+
+// captured tick on every copy: false if a copy executed another point
+static bool replay_tick(replay_context_t *context, const gs232_capture_record_t *record, uint32_t *copy) {
+    uint64_t next;
+
+    if (record->len < 10)
+        return true;
+
+    for (*copy = 0; *copy < copies; (*copy)++) {
+        gs232_t *ctx = context->ctx[*copy];
+
+        gs232_track_tick(&ctx, ctx->track.start + get_u64(record->data), &next);
+        if (ctx->memory_current_point != get_u16(record->data + 8))
+            return false;
+    }
+
+    return true;
+}
+
+// responses of one frame on one copy
+static uint32_t replay_frame(replay_context_t *context, replay_session_t *session, uint32_t copy, const gs232_capture_record_t *record, char *output) {
+    gs232_t *ctx = context->ctx[copy];
+    const char *response;
+    uint32_t used, len = 0;
+
+    if (context->shared)
+        gs232_gateway_begin(&context->gateway[copy], &session->stream[copy], session, session->priority);
+
+    if (record->type == GS232_CAPTURE_DROP) {
+        if (ctx->stream.protocol == GS232_PROTOCOL_BINARY)
+            gs232_binary_reply(ctx, GS232_TOOMANYVALUES, output, REPLAY_OUTPUT_SIZE, &len);
+        else if (gs232_return_buffer(ctx, GS232_TOOMANYVALUES, output, REPLAY_OUTPUT_SIZE, &response, &len) == GS232_OK && response != output)
+            memcpy(output, response, len);
+    } else if (gs232_binary_detect(&ctx, (const char*) record->data, record->len))
+        gs232_binary_batch(&ctx, (const char*) record->data, record->len, &used, output, REPLAY_OUTPUT_SIZE, &len);
+    else
+        gs232_stream_batch(&ctx, (const char*) record->data, record->len, &used, output, REPLAY_OUTPUT_SIZE, &len);
+
+    if (context->shared)
+        gs232_gateway_end(&context->gateway[copy], &session->stream[copy]);
+
+    return len;
+}
+
+int main(int argc, char *const argv[]) {
+    gs232_capture_reader_t reader;
+    gs232_capture_record_t *records = NULL, record;
+    replay_context_t *context;
+    replay_session_t *session, *other;
+    gs232_histogram_t latency;
+    uint8_t *expected = NULL, *done = NULL;
+    char output[REPLAY_OUTPUT_SIZE];
+    uint32_t records_qty = 0, records_max = 0, expected_len, len, last_out, copy, max_mismatches = REPLAY_MISMATCHES;
+    uint64_t frames = 0, mismatches = 0, responses_bytes = 0, wall_start, start, elapsed;
+    bool original_timing = false, quiet = false;
+    uint8_t res;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "rn:m:q")) != -1) {
+        switch (opt) {
+            case 'r':
+                original_timing = true;
+                break;
+            case 'n':
+                copies = atoi(optarg) > 0 ? atoi(optarg) : 1;
+                break;
+            case 'm':
+                max_mismatches = atoi(optarg);
+                break;
+            case 'q':
+                quiet = true;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-r (original timing)] [-n copies_per_context] [-m reported_mismatches] [-q] capture_file\n", argv[0]);
+                return 2;
+        }
+    }
+
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-r (original timing)] [-n copies_per_context] [-m reported_mismatches] [-q] capture_file\n", argv[0]);
+        return 2;
+    }
+
+    if ((res = gs232_capture_reader_open(&reader, argv[optind])) != GS232_OK) {
+        fprintf(stderr, "Error: %s is %s\n", argv[optind], res == GS232_OUTOFRANGE ? "not a capture log" : "not readable");
+        return 2;
+    }
+
+    // whole log: responses and positions of a frame follow it
+    while ((res = gs232_capture_read(&reader, &record)) == GS232_OK) {
+        if (records_qty == records_max) {
+            records_max = records_max == 0 ? 4096 : 2 * records_max;
+            records = realloc(records, records_max * sizeof(gs232_capture_record_t));
+        }
+        records[records_qty++] = record;
+
+        if (record.type == GS232_CAPTURE_OPEN && !replay_session_open(&record)) {
+            fprintf(stderr, "Error: bad session record\n");
+            return 2;
+        }
+    }
+
+    if (res == GS232_OUTOFRANGE)
+        fprintf(stderr, "Warning: truncated log, %u records replayed\n", records_qty);
+
+    done = calloc(records_qty + 1, 1);
+    expected = malloc(REPLAY_OUTPUT_SIZE);
+    memset(&latency, 0, sizeof(latency));
+    gs232_set_clock(replay_clock);
+    replay_clock_now = reader.start;
+    wall_start = now_ns();
+
+    for (uint32_t i = 0; i < records_qty; i++) {
+        if (done[i])
+            continue;
+
+        replay_clock_now = records[i].time;
+
+        switch (records[i].type) {
+            case GS232_CAPTURE_CONTEXT:
+                if (!replay_context_create(&records[i])) {
+                    fprintf(stderr, "Error: bad context record\n");
+                    return 2;
+                }
+                continue;
+
+            case GS232_CAPTURE_POSITION:
+                if ((session = replay_session(records[i].session)) != NULL && (context = replay_context(session->context)) != NULL)
+                    replay_position(context, &records[i]);
+                continue;
+
+            case GS232_CAPTURE_TICK:
+                if ((session = replay_session(records[i].session)) != NULL && (context = replay_context(session->context)) != NULL
+                        && !replay_tick(context, &records[i], &copy) && mismatches++ < max_mismatches && !quiet)
+                    printf("MISMATCH session %u copy %u at %.6f s\n  tick: expected point %u, replayed %u\n", records[i].session, copy,
+                            (records[i].time - reader.start) / 1e9, get_u16(records[i].data + 8), context->ctx[copy]->memory_current_point);
+                continue;
+
+            case GS232_CAPTURE_CLOSE:
+                if ((session = replay_session(records[i].session)) != NULL && (context = replay_context(session->context)) != NULL && context->shared)
+                    for (uint32_t c = 0; c < copies; c++)
+                        gs232_gateway_leave(&context->gateway[c], &session->stream[c], session);
+                continue;
+
+            case GS232_CAPTURE_IN:
+            case GS232_CAPTURE_DROP:
+                break;
+
+            default:
+                continue;
+        }
+
+        if ((session = replay_session(records[i].session)) == NULL || (context = replay_context(session->context)) == NULL)
+            continue;
+
+        // captured responses of frame: until next frame on the same context
+        expected_len = 0;
+        last_out = i;
+        for (uint32_t j = i + 1; j < records_qty; j++) {
+            if ((other = replay_session(records[j].session)) == NULL || other->context != session->context)
+                continue;
+
+            if (records[j].type == GS232_CAPTURE_IN || records[j].type == GS232_CAPTURE_DROP)
+                break;
+
+            if (records[j].type == GS232_CAPTURE_OUT && other == session && expected_len + records[j].len <= REPLAY_OUTPUT_SIZE) {
+                memcpy(expected + expected_len, records[j].data, records[j].len);
+                expected_len += records[j].len;
+                done[j] = 1;
+                last_out = j;
+            }
+        }
+
+        // positions read while responding
+        for (uint32_t j = i + 1; j < last_out; j++)
+            if (!done[j] && records[j].type == GS232_CAPTURE_POSITION && (other = replay_session(records[j].session)) != NULL
+                    && other->context == session->context) {
+                replay_position(context, &records[j]);
+                done[j] = 1;
+            }
+
+        if (original_timing) {
+            elapsed = now_ns() - wall_start;
+            if (records[i].time - reader.start > elapsed)
+                usleep((records[i].time - reader.start - elapsed) / 1000);
+        }
+
+        for (uint32_t c = 0; c < copies; c++) {
+            start = now_ns();
+            len = replay_frame(context, session, c, &records[i], output);
+            elapsed = now_ns() - start;
+
+            latency.count++;
+            latency.sum += elapsed;
+            latency.buckets[gs232_histogram_bucket(elapsed)]++;
+            frames++;
+            responses_bytes += len;
+
+            if (len == expected_len && memcmp(output, expected, len) == 0)
+                continue;
+
+            if (mismatches++ < max_mismatches && !quiet) {
+                printf("MISMATCH session %u copy %u at %.6f s\n", records[i].session, c, (records[i].time - reader.start) / 1e9);
+                if (records[i].type == GS232_CAPTURE_DROP)
+                    printf("  frame: dropped (overlong)\n");
+                else
+                    print_escaped("frame", records[i].data, records[i].len);
+                print_escaped("expected", expected, expected_len);
+                print_escaped("replayed", (const uint8_t*) output, len);
+            }
+        }
+    }
+
+    elapsed = now_ns() - wall_start;
+    printf("{\"replay\":\"%s\",\"contexts\":%u,\"sessions\":%u,\"copies\":%u,\"frames\":%lu,\"mismatches\":%lu,\"response_bytes\":%lu,"
+            "\"seconds\":%.6f,\"frames_per_sec\":%.0f,\"frame_p50_ns\":%lu,\"frame_p99_ns\":%lu,\"frame_max_bucket_ns\":%lu}\n", argv[optind],
+            contexts_qty, sessions_qty, copies, (unsigned long) frames, (unsigned long) mismatches, (unsigned long) responses_bytes,
+            elapsed / 1e9, frames * 1e9 / (elapsed ? elapsed : 1), (unsigned long) gs232_histogram_percentile(&latency, 50),
+            (unsigned long) gs232_histogram_percentile(&latency, 99), (unsigned long) gs232_histogram_percentile(&latency, 100));
+
+    // session streams are released before contexts (allocator)
+    for (uint32_t n = 0; n < sessions_qty; n++) {
+        if (sessions[n].stream == NULL)
+            continue;
+
+        for (uint32_t c = 0; c < copies; c++)
+            gs232_free(NULL, sessions[n].stream[c].buffer, GS232_FRAME_MAX);
+        free(sessions[n].stream);
+    }
+
+    for (uint32_t n = 0; n < contexts_qty; n++) {
+        if (!contexts[n].valid)
+            continue;
+
+        for (uint32_t c = 0; c < copies; c++) {
+            if (contexts[n].shared)
+                gs232_gateway_deinit(&contexts[n].gateway[c]);
+            gs232_deinit(&contexts[n].ctx[c]);
+        }
+        free(contexts[n].ctx);
+        free(contexts[n].gateway);
+    }
+
+    free(contexts);
+    free(sessions);
+    free(records);
+    free(done);
+    free(expected);
+    gs232_capture_reader_close(&reader);
+
+    return mismatches == 0 ? 0 : 1;
+}
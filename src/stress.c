@@ -0,0 +1,201 @@
+/**
+ * @stress.c
+ *
+ * @brief Multithreaded stress test
+ * @details One context shared by a controller (parser) thread, a tracking thread, a hardware thread publishing position
+ *          and several polling threads. Parser and tracking thread both queue targets on the actuator. Every value pair
+ *          carries an invariant (elevation = azimuth / 2): a torn read of position, reply cache, track memory or actuator
+ *          record breaks it, and every queued record must be applied or skipped.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "libGS232.h"
+#include "gs232_track.h"
+#include "gs232_position.h"
+#include "gs232_actuator.h"
+
+#define STRESS_POLLERS    4   /*!< polling threads */
+#define STRESS_MAX_POINTS 100 /*!< maximum points of uploaded tracks */
+
+static gs232_t *ctx;
+static gs232_actuator_t actuator;
+static bool stop;
+static uint64_t errors;
+static uint64_t uploads, ticks, points, polls, position_reads, position_writes;
+static __thread uint16_t track_azimuth;
+
+static void error(const char *what, uint32_t a, uint32_t b) {
+    if (__atomic_fetch_add(&errors, 1, __ATOMIC_RELAXED) < 10)
+        fprintf(stderr, "ERROR: %s (%u, %u)\n", what, a, b);
+}
+
+static void parse(const char *command) {
+    char buffer[GS232_FRAME_MAX];
+    uint32_t len = strlen(command);
+
+    memcpy(buffer, command, len);
+    gs232_parse_command(&ctx, buffer, len);
+}
+
+///////////////// hardware functions (actuator thread) /////////////////
+
+static uint8_t set_azimuth(uint16_t azimuth) {
+    track_azimuth = azimuth;
+    return 0;
+}
+
+static uint8_t set_elevation(uint16_t elevation) {
+    // azimuth is routed by the planner: same direction, maybe on the second turn
+    if (elevation != track_azimuth % 360 / 2 && elevation != (track_azimuth % 360 + 360) / 2)
+        error("track point", track_azimuth, elevation);
+
+    __atomic_fetch_add(&points, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+///////////////////////////// threads /////////////////////////////
+
+// uploads tracks (inline and pool memory) and changes modes
+static void* controller(void *arg) {
+    char command[GS232_FRAME_MAX];
+
+    for (uint32_t generation = 0; !__atomic_load_n(&stop, __ATOMIC_RELAXED); generation++) {
+        uint16_t azimuth = generation % 361, pairs = 1 + generation % STRESS_MAX_POINTS;
+        uint32_t len = sprintf(command, "W000");
+
+        for (uint16_t n = 0; n < pairs; n++)
+            len += sprintf(command + len, " %03u %03u", azimuth, azimuth / 2);
+        sprintf(command + len, "\r");
+
+        parse(command);
+        parse("T\r");
+        __atomic_fetch_add(&uploads, 1, __ATOMIC_RELAXED);
+
+        switch (generation % 8) {
+            case 1:
+                parse("S\r");
+                break;
+            case 3:
+                parse("M123\r");
+                break;
+            case 5:
+                parse(generation & 8 ? "P45\r" : "P36\r");
+                parse("Z\r");
+                break;
+            case 7:
+                parse("X2\r");
+                break;
+        }
+    }
+
+    return NULL;
+}
+
+static void* tracker(void *arg) {
+    uint64_t next;
+
+    while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+        gs232_track_tick(&ctx, gs232_now(), &next);
+        __atomic_fetch_add(&ticks, 1, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+static void* hardware(void *arg) {
+    for (uint32_t n = 0; !__atomic_load_n(&stop, __ATOMIC_RELAXED); n++) {
+        gs232_position_set(&ctx, n % 361, (n % 361) / 2);
+        __atomic_fetch_add(&position_writes, 1, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+static void* poller(void *arg) {
+    char buffer[GS232_RESPONSE_MAX];
+    const char *response;
+    uint32_t response_len;
+    uint16_t azimuth, elevation;
+    unsigned a, b;
+
+    while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+        gs232_position_get(ctx, &azimuth, &elevation);
+        if (elevation != azimuth / 2)
+            error("position", azimuth, elevation);
+        __atomic_fetch_add(&position_reads, 1, __ATOMIC_RELAXED);
+
+        if (gs232_return_buffer(ctx, GS232_RETURN_AZIMUTH_AND_ELEVATION, buffer, sizeof(buffer), &response, &response_len) != GS232_OK
+                || response_len != 12 || sscanf(response, "+0%3u+0%3u", &a, &b) != 2 || b != a / 2)
+            error("C2 reply", response_len, 0);
+
+        if (gs232_return_buffer(ctx, GS232_TOTAL_NUMBER_OF_SETTING_ANGLES, buffer, sizeof(buffer), &response, &response_len) != GS232_OK
+                || response_len != 12 || sscanf(response, "+%4u+%4u", &a, &b) != 2 || a > STRESS_MAX_POINTS || b > STRESS_MAX_POINTS)
+            error("N reply", a, b);
+
+        __atomic_fetch_add(&polls, 1, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    pthread_t threads[3 + STRESS_POLLERS];
+    double seconds = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:")) != -1) {
+        if (opt == 't')
+            seconds = atof(optarg);
+        else {
+            fprintf(stderr, "usage: %s [-t seconds]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (gs232_init(&ctx) != GS232_OK)
+        return 1;
+
+    ctx->fn.set_azimuth = set_azimuth;
+    ctx->fn.set_elevation = set_elevation;
+
+    if (gs232_actuator_init(&actuator, ctx) != GS232_OK)
+        return 1;
+
+    pthread_create(&threads[0], NULL, controller, NULL);
+    pthread_create(&threads[1], NULL, tracker, NULL);
+    pthread_create(&threads[2], NULL, hardware, NULL);
+    for (int n = 0; n < STRESS_POLLERS; n++)
+        pthread_create(&threads[3 + n], NULL, poller, NULL);
+
+    usleep(seconds * 1000000);
+    __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+
+    for (int n = 0; n < 3 + STRESS_POLLERS; n++)
+        pthread_join(threads[n], NULL);
+
+    // pending records are applied before the worker ends
+    gs232_actuator_deinit(&actuator);
+    if (actuator.applied + actuator.skipped != actuator.submitted)
+        error("actuator records", actuator.submitted, actuator.applied + actuator.skipped);
+
+    gs232_deinit(&ctx);
+
+    printf("uploads: %lu, ticks: %lu, track points: %lu, polls: %lu, position reads: %lu, position writes: %lu, actuator records: %lu, errors: %lu\n",
+            (unsigned long) uploads, (unsigned long) ticks, (unsigned long) points, (unsigned long) polls, (unsigned long) position_reads,
+            (unsigned long) position_writes, (unsigned long) actuator.submitted, (unsigned long) errors);
+
+    return errors == 0 && uploads != 0 && polls != 0 ? 0 : 1;
+}
@@ -18,23 +18,183 @@
 #include <unistd.h>
 #include <errno.h>
 #include <stdio.h>
+#include <poll.h>
 #include <pty.h>
 #include <termios.h>
 
 #include "libGS232.h"
+#include "gs232_track.h"
+#include "gs232_actuator.h"
+#include "gs232_sim.h"
+#include "gs232_metrics.h"
+#include "gs232_server.h"
+#include "gs232_gateway.h"
+#include "gs232_persist.h"
+#include "gs232_capture.h"
 
 #define BUF_SIZE (32768)
 
-int main(int, char const*[]) {
+static void command_callback(gs232_t **ctx, uint8_t command, void *arg) {
+    gs232_t *context = *ctx;
+    int master = *(int*) arg;
+    const char *response;
+    uint32_t response_len;
+    char response_buf[GS232_RESPONSE_MAX];
+    gs232_metrics_t metrics;
+    uint64_t commands = 0;
+
+    gs232_return_buffer(context, command, response_buf, sizeof(response_buf), &response, &response_len);
+    write(master, response, response_len);
+
+    printf("CONTEXT:\n");
+    printf("  azimuth: %d\n", context->azimuth);
+    printf("  elevation: %d\n", context->elevation);
+    printf("  b_protocol: %d\n", context->b_protocol);
+    printf("  azimuth_nord_south: %d\n", context->azimuth_nord_south);
+    printf("  is_450_degrees: %d\n", context->is_450_degrees);
+    printf("  rotation_speed: %d\n", context->rotation_speed);
+    printf("  memory used: %d\n", context->memory_qty);
+    printf("  memory current_point: %d\n", context->memory_current_point);
+
+    for (uint16_t n = 0; n < context->memory_qty; n++)
+        printf("  memory[%d]: %d\n", n, context->memory[n]);
+
+    gs232_metrics_snapshot(context, &metrics);
+    for (uint8_t n = 0; n < GS232_METRICS_COMMANDS; n++)
+        commands += metrics.commands[n];
+    printf("METRICS:\n");
+    printf("  commands: %lu (fail: %lu, too many values: %lu, out of range: %lu)\n", (unsigned long) commands,
+            (unsigned long) metrics.errors[GS232_FAIL - GS232_FAIL], (unsigned long) metrics.errors[GS232_TOOMANYVALUES - GS232_FAIL],
+            (unsigned long) metrics.errors[GS232_OUTOFRANGE - GS232_FAIL]);
+    printf("  bytes in: %lu, bytes out: %lu\n", (unsigned long) metrics.bytes_in, (unsigned long) metrics.bytes_out);
+    printf("  parse p50/p99: %lu/%lu ns\n", (unsigned long) gs232_histogram_percentile(&metrics.latency[GS232_METRICS_PARSE], 50),
+            (unsigned long) gs232_histogram_percentile(&metrics.latency[GS232_METRICS_PARSE], 99));
+
+    printf("\n");
+}
+
+// gateway: the context is served on clients ptys (connection index is the arbitration priority)
+static int gateway_run(gs232_t *context, int clients, int policy, double time_scale, gs232_capture_t *capture) {
+    gs232_server_t *server = NULL;
+    gs232_connection_t *connection;
+    gs232_gateway_t gateway;
+    struct termios tty = { 0 };
+    char name[256];
+    int master, slave;
+
+    tty.c_cflag = CS8;
+
+    if (gs232_gateway_init(&gateway, context, policy, GS232_GATEWAY_WINDOW, GS232_GATEWAY_HOLD) != GS232_OK
+            || gs232_server_init(&server, clients) != GS232_OK || gs232_server_gateway(&server, &gateway) != GS232_OK
+            || gs232_server_capture(&server, capture) != GS232_OK) {
+        printf("Error: gateway\n");
+        return -1;
+    }
+
+    for (int n = 0; n < clients; n++) {
+        if (openpty(&master, &slave, name, &tty, NULL) < 0 || gs232_server_add(&server, master, &connection) != GS232_OK) {
+            printf("Error: %s\n", strerror(errno));
+            return -1;
+        }
+
+        connection->priority = n;
+        printf("Slave PTY %d: %s\n", n, name);
+    }
+
+    // the simulator clock runs faster than the poll timeout
+    while (gs232_server_run(&server, time_scale > 0 ? 10 : -1) >= 0)
+        ;
+
+    gs232_server_deinit(&server);
+    gs232_gateway_deinit(&gateway);
+
+    return 0;
+}
+
+int main(int argc, char *const argv[]) {
     gs232_t *context = NULL;
-    uint8_t command;
-    char *ret_str;
-    int master, slave, r;
+    gs232_actuator_t actuator;
+    gs232_sim_t sim;
+    gs232_persist_t persist;
+    gs232_capture_t capture;
+    const char *state_file = NULL, *capture_file = NULL;
+    bool restored;
+    double time_scale = 0;
+    int master, slave, r, timeout, opt, clients = 0, policy = GS232_GATEWAY_SHARED;
+    uint64_t next, now;
+    struct pollfd pfd;
     char buf[BUF_SIZE];
     struct termios tty;
 
+    while ((opt = getopt(argc, argv, "s:n:p:f:c:")) != -1) {
+        switch (opt) {
+            case 's':
+                time_scale = atof(optarg);
+                break;
+            case 'n':
+                clients = atoi(optarg);
+                break;
+            case 'p':
+                policy = atoi(optarg);
+                break;
+            case 'f':
+                state_file = optarg;
+                break;
+            case 'c':
+                capture_file = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-s simulator_time_scale] [-n gateway_clients] [-p policy (0: shared, 1: exclusive, 2: priority)] [-f state_file] [-c capture_file]\n", argv[0]);
+                return 1;
+        }
+    }
+
     gs232_init(&context);
 
+    // simulated rotator: commands are applied by the actuator, time runs time_scale times faster
+    if (time_scale > 0 && (gs232_sim_init(&sim, context, time_scale) != GS232_OK || gs232_actuator_init(&actuator, context) != GS232_OK)) {
+        printf("Error: simulator\n");
+        return -1;
+    }
+
+    // modes, values and timed track survive restarts
+    if (state_file != NULL) {
+        if (gs232_persist_open(&persist, &context, state_file, false, &restored) != GS232_OK) {
+            printf("Error: state file %s\n", state_file);
+            return -1;
+        }
+        printf("State file: %s (%s)\n", state_file, restored ? "restored" : "new");
+    }
+
+    // I/O log for gs232_replay
+    if (capture_file != NULL) {
+        if (gs232_capture_open(&capture, capture_file) != GS232_OK) {
+            printf("Error: capture file %s\n", capture_file);
+            return -1;
+        }
+        printf("Capture file: %s\n", capture_file);
+    }
+
+    if (clients > 0) {
+        r = gateway_run(context, clients, policy, time_scale, capture_file != NULL ? &capture : NULL);
+
+        if (capture_file != NULL) {
+            gs232_capture_detach(&context);
+            gs232_capture_close(&capture);
+        }
+
+        if (state_file != NULL)
+            gs232_persist_close(&persist);
+
+        if (time_scale > 0) {
+            gs232_actuator_deinit(&actuator);
+            gs232_sim_deinit(&sim);
+        }
+
+        gs232_deinit(&context);
+        return r;
+    }
+
     tty.c_iflag = (tcflag_t) 0;
     tty.c_lflag = (tcflag_t) 0;
     tty.c_cflag = CS8;
@@ -48,34 +208,59 @@ int main(int, char const*[]) {
 
     printf("Slave PTY: %s\n", buf);
 
-    memset(buf, 0, sizeof(buf));
-    while ((r = read(master, buf, BUF_SIZE)) > 0) {
-        command = gs232_parse_command(&context, buf, r);
-        gs232_return_string(context, command, &ret_str);
-        write(master, ret_str, strlen(ret_str));
-
-        free(ret_str);
-        memset(buf, 0, sizeof(buf));
-
-        printf("CONTEXT:\n");
-        printf("  azimuth: %d\n", context->azimuth);
-        printf("  elevation: %d\n", context->elevation);
-        printf("  b_protocol: %d\n", context->b_protocol);
-        printf("  azimuth_nord_south: %d\n", context->azimuth_nord_south);
-        printf("  is_450_degrees: %d\n", context->is_450_degrees);
-        printf("  rotation_speed: %d\n", context->rotation_speed);
-        printf("  memory used: %d\n", context->memory_qty);
-        printf("  memory current_point: %d\n", context->memory_current_point);
-
-        for (uint16_t n = 0; n < context->memory_qty; n++)
-            printf("  memory[%d]: %d\n", n, context->memory[n]);
-
-        printf("\n");
+    if (capture_file != NULL) {
+        gs232_capture_attach(&context, &capture, NULL);
+        gs232_capture_connect(&context, 0);
+    }
+
+    pfd.fd = master;
+    pfd.events = POLLIN;
+
+    for (;;) {
+        // timed tracking runs between commands
+        gs232_track_tick(&context, gs232_now(), &next);
+        now = gs232_now();
+
+        // next point may be already due (fast simulator clock): no wait
+        if (next == GS232_TRACK_IDLE)
+            timeout = -1;
+        else if (next <= now)
+            timeout = 0;
+        else
+            timeout = (int) ((next - now) / 1000000 / (time_scale > 0 ? time_scale : 1)) + 1;
+
+        if (poll(&pfd, 1, timeout) < 0)
+            break;
+
+        if (!(pfd.revents & POLLIN))
+            continue;
+
+        if ((r = read(master, buf, BUF_SIZE)) <= 0)
+            break;
+
+        gs232_stream_feed(&context, buf, r, command_callback, &master);
+
+        // the test server is usually stopped with a signal
+        if (capture_file != NULL)
+            gs232_capture_flush(&capture);
     }
 
     close(slave);
     close(master);
 
+    if (state_file != NULL)
+        gs232_persist_close(&persist);
+
+    if (capture_file != NULL) {
+        gs232_capture_detach(&context);
+        gs232_capture_close(&capture);
+    }
+
+    if (time_scale > 0) {
+        gs232_actuator_deinit(&actuator);
+        gs232_sim_deinit(&sim);
+    }
+
     gs232_deinit(&context);
 
     return 0;
@@ -0,0 +1,392 @@
+/**
+ * @values.c
+ *
+ * @brief M/W values decoder test
+ * @details Table of boundary frames parsed on a new context: parsed command, values error (values_error of context),
+ *          memory_qty and decoded values. Frames with a non-digit on every position of every group (SWAR lanes and
+ *          scalar tail) and frames of 3799, 3800 and 3801 values are generated. Binary frame streams (garbage before sync,
+ *          overlong frames) are fed in reads of every size: replies and decoded values must not depend on the split.
+ *          Modes, values and timed track are restored from a state file after restart, from the older slot when the newest
+ *          slot is lost or has a bad checksum.
+ *
+ * @author Emiliano Gonzalez (egonzalez . hiperion @ gmail . com))
+ * @version 0.1
+ * @date 2023
+ * @copyright MIT License
+ * @see https://github.com/hiperiondev/libGS232
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "libGS232.h"
+#include "gs232_binary.h"
+#include "gs232_track.h"
+#include "gs232_persist.h"
+
+#define VALUES_MAX 6 /*!< checked values of table frames */
+
+typedef struct values_case_s {
+    const char *prepare;            /*!< frame parsed before (stale memory), NULL: none */
+    const char *frame;              /*!< frame */
+          bool is_450_degrees;      /*!< 450 degrees mode */
+       uint8_t command;             /*!< parsed command */
+       uint8_t error;               /*!< values error (GS232_OK: none) */
+      uint16_t qty;                 /*!< memory_qty */
+      uint16_t values[VALUES_MAX];  /*!< first values of memory */
+} values_case_t;
+
+#define M_TURN  GS232_TURN_DEGREES_AZIMUTH
+#define M_TRACK GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH
+#define W_TURN  GS232_TURN_DEGREES_AZIMUTH_AND_ELEVATION
+#define W_TRACK GS232_AUTOMATIC_TIMED_TRACKING_AZIMUTH_AND_ELEVATION
+#define UNKNOWN GS232_UNKNOWN_COMMAND
+
+static const values_case_t cases[] = {
+        // Maaa
+        { NULL, "M000\r", false, M_TURN, GS232_OK, 1, { 0 } },
+        { NULL, "M360\r", false, M_TURN, GS232_OK, 1, { 360 } },
+        { NULL, "M361\r", false, UNKNOWN, GS232_OUTOFRANGE, 1, { 361 } },
+        { NULL, "M450\r", true, M_TURN, GS232_OK, 1, { 450 } },
+        { NULL, "M451\r", true, UNKNOWN, GS232_OUTOFRANGE, 1, { 451 } },
+        { NULL, "M999\r", false, UNKNOWN, GS232_OUTOFRANGE, 1, { 999 } },
+        // Mttt aaa ...: time up to 999, azimuth on odd and even indices
+        { NULL, "M999 360 360\r", false, M_TRACK, GS232_OK, 3, { 999, 360, 360 } },
+        { NULL, "M001 361 000\r", false, UNKNOWN, GS232_OUTOFRANGE, 3, { 1, 361, 0 } },
+        { NULL, "M001 000 361\r", false, UNKNOWN, GS232_OUTOFRANGE, 3, { 1, 0, 361 } },
+        { NULL, "M001 000 000 361 000\r", false, UNKNOWN, GS232_OUTOFRANGE, 5, { 1, 0, 0, 361, 0 } },
+        { NULL, "M001 000 000 000 361\r", false, UNKNOWN, GS232_OUTOFRANGE, 5, { 1, 0, 0, 0, 361 } },
+        { NULL, "M001 000 000 000 450\r", true, M_TRACK, GS232_OK, 5, { 1, 0, 0, 0, 450 } },
+        // Waaa eee
+        { NULL, "W123 045\r", false, W_TURN, GS232_OK, 2, { 123, 45 } },
+        { NULL, "W360 180\r", false, W_TURN, GS232_OK, 2, { 360, 180 } },
+        { NULL, "W361 000\r", false, UNKNOWN, GS232_OUTOFRANGE, 2, { 361, 0 } },
+        { NULL, "W000 181\r", false, UNKNOWN, GS232_OUTOFRANGE, 2, { 0, 181 } },
+        { NULL, "W450 180\r", true, W_TURN, GS232_OK, 2, { 450, 180 } },
+        { NULL, "W123\r", false, W_TURN, GS232_OK, 1, { 123 } },
+        // Wttt aaa eee ...: azimuth on odd indices, elevation on even indices
+        { NULL, "W001 360 180\r", false, W_TRACK, GS232_OK, 3, { 1, 360, 180 } },
+        { NULL, "W999 000 000 360 180\r", false, W_TRACK, GS232_OK, 5, { 999, 0, 0, 360, 180 } },
+        { NULL, "W001 361 000\r", false, UNKNOWN, GS232_OUTOFRANGE, 3, { 1, 361, 0 } },
+        { NULL, "W001 000 181\r", false, UNKNOWN, GS232_OUTOFRANGE, 3, { 1, 0, 181 } },
+        { NULL, "W001 000 000 361 000\r", false, UNKNOWN, GS232_OUTOFRANGE, 5, { 1, 0, 0, 361, 0 } },
+        { NULL, "W001 000 000 000 181\r", false, UNKNOWN, GS232_OUTOFRANGE, 5, { 1, 0, 0, 0, 181 } },
+        // decode errors have priority over range errors
+        { NULL, "W001 361 0a0\r", false, UNKNOWN, GS232_FAIL, 2, { 1, 361 } },
+        { NULL, "M361 000 00a\r", false, UNKNOWN, GS232_FAIL, 2, { 361, 0 } },
+        // frame length: not checked (too short) or not a list of values (memory unchanged)
+        { "M100\r", "M12\r", false, UNKNOWN, GS232_OK, 1, { 100 } },
+        { "M100\r", "M1234\r", false, UNKNOWN, GS232_FAIL, 1, { 100 } },
+        { "M100\r", "M001 002 03\r", false, UNKNOWN, GS232_FAIL, 1, { 100 } },
+        // separators are not checked
+        { NULL, "M001x002\r", false, M_TRACK, GS232_OK, 2, { 1, 2 } },
+        // only decoded values are range checked: stale memory of a previous command is ignored
+        { "M001 200 300\r", "W123\r", false, W_TURN, GS232_OK, 1, { 123 } },
+        { "M001 000 000 000 300\r", "W001 100 050 200\r", false, W_TRACK, GS232_OK, 4, { 1, 100, 50, 200 } },
+};
+
+static uint32_t failures;
+
+static void fail(const char *frame, const char *what, uint32_t expected, uint32_t got) {
+    if (failures++ < 20)
+        printf("FAIL %.40s: %s expected %u, got %u\n", frame, what, expected, got);
+}
+
+static void check(const char *prepare, const char *frame, uint32_t frame_len, bool is_450_degrees, uint8_t command, uint8_t error,
+        uint16_t qty, const uint16_t *values, uint16_t values_qty) {
+    static char buffer[4 * (MEMORY_POINTS + 1) + 2];
+    gs232_t *ctx;
+    uint8_t res;
+
+    if (gs232_init(&ctx) != GS232_OK) {
+        fail(frame, "init", GS232_OK, GS232_FAIL);
+        return;
+    }
+    ctx->is_450_degrees = is_450_degrees;
+
+    if (prepare != NULL) {
+        memcpy(buffer, prepare, strlen(prepare));
+        gs232_parse_command(&ctx, buffer, strlen(prepare));
+    }
+
+    memcpy(buffer, frame, frame_len);
+    if ((res = gs232_parse_command(&ctx, buffer, frame_len)) != command)
+        fail(frame, "command", command, res);
+
+    if (ctx->values_error != error)
+        fail(frame, "error", error, ctx->values_error);
+
+    if (ctx->memory_qty != qty)
+        fail(frame, "memory_qty", qty, ctx->memory_qty);
+
+    for (uint16_t n = 0; n < values_qty && n < ctx->memory_qty; n++)
+        if (ctx->memory[n] != values[n]) {
+            fail(frame, "value", values[n], ctx->memory[n]);
+            break;
+        }
+
+    gs232_deinit(&ctx);
+}
+
+// binary frame: sync, command, quantity, values
+static uint32_t binary_frame(char *frame, uint8_t command, const uint16_t *values, uint16_t qty) {
+    frame[0] = (char) GS232_BINARY_SYNC;
+    frame[1] = command;
+    frame[2] = qty & 0xff;
+    frame[3] = qty >> 8;
+    for (uint16_t n = 0; n < qty; n++) {
+        frame[GS232_BINARY_HEADER + 2 * n] = values[n] & 0xff;
+        frame[GS232_BINARY_HEADER + 2 * n + 1] = values[n] >> 8;
+    }
+
+    return GS232_BINARY_HEADER + 2 * qty;
+}
+
+// stream fed in reads of read_size bytes: replied command of every frame
+static uint32_t binary_feed(gs232_t **ctx, const char *data, uint32_t data_len, uint32_t read_size, uint8_t *replies, uint32_t replies_max) {
+    char response[4 * GS232_BINARY_REPLY_MAX];
+    uint32_t qty = 0, pos = 0, chunk, used, response_len;
+
+    while (pos < data_len) {
+        chunk = data_len - pos < read_size ? data_len - pos : read_size;
+        gs232_binary_batch(ctx, data + pos, chunk, &used, response, sizeof(response), &response_len);
+        pos += used;
+
+        for (uint32_t n = 0; n + GS232_BINARY_HEADER <= response_len; n += GS232_BINARY_HEADER + ((uint8_t) response[n + 2] | (uint8_t) response[n + 3] << 8))
+            if (qty < replies_max)
+                replies[qty++] = response[n + 1];
+    }
+
+    return qty;
+}
+
+static void binary_check(const char *name, const char *data, uint32_t data_len, const uint8_t *replies, uint32_t replies_qty,
+        const uint16_t *values, uint16_t qty) {
+    static const uint32_t read_sizes[] = { 1, 2, 3, 5, GS232_BINARY_HEADER + 1, 4096, UINT32_MAX };
+    uint8_t got[8];
+    uint32_t got_qty;
+    gs232_t *ctx;
+
+    for (uint32_t r = 0; r < sizeof(read_sizes) / sizeof(read_sizes[0]); r++) {
+        if (gs232_init(&ctx) != GS232_OK) {
+            fail(name, "init", GS232_OK, GS232_FAIL);
+            return;
+        }
+
+        got_qty = binary_feed(&ctx, data, data_len, read_sizes[r], got, sizeof(got));
+        if (got_qty != replies_qty)
+            fail(name, "replies", replies_qty, got_qty);
+
+        for (uint32_t n = 0; n < got_qty && n < replies_qty; n++)
+            if (got[n] != replies[n])
+                fail(name, "reply", replies[n], got[n]);
+
+        if (ctx->memory_qty != qty)
+            fail(name, "memory_qty", qty, ctx->memory_qty);
+
+        for (uint16_t n = 0; n < qty && n < ctx->memory_qty; n++)
+            if (ctx->memory[n] != values[n]) {
+                fail(name, "value", values[n], ctx->memory[n]);
+                break;
+            }
+
+        gs232_deinit(&ctx);
+    }
+}
+
+typedef struct persist_expect_s {
+        bool restored;            /*!< state restored */
+        bool is_450_degrees;      /*!< 450 degrees mode */
+     uint8_t rotation_speed;      /*!< rotation speed */
+    uint16_t qty;                 /*!< memory_qty */
+        bool running;             /*!< timed track running */
+    uint16_t current_point;       /*!< executed points of timed track */
+} persist_expect_t;
+
+static uint64_t persist_now = 1000000000000ULL;
+
+static uint64_t persist_clock(void) {
+    return persist_now;
+}
+
+static void persist_parse(gs232_t **ctx, const char *command) {
+    char buffer[64];
+
+    memcpy(buffer, command, strlen(command));
+    gs232_parse_command(ctx, buffer, strlen(command));
+}
+
+// slot state starts with its sequence (0: never written), any other byte is covered by the state checksum
+static void persist_corrupt(const char *path, const gs232_persist_t *persist, uint8_t slot, bool lost) {
+    static const uint8_t zero[8] = { 0 };
+    uint8_t byte;
+    int fd;
+
+    if ((fd = open(path, O_RDWR)) < 0)
+        return;
+
+    if (lost)
+        pwrite(fd, zero, sizeof(zero), persist->stride * (1 + slot));
+    else if (pread(fd, &byte, 1, persist->stride * (1 + slot) + 8) == 1) {
+        byte ^= 0x01;
+        pwrite(fd, &byte, 1, persist->stride * (1 + slot) + 8);
+    }
+
+    close(fd);
+}
+
+// restart: new context restored from state file
+static void persist_check(const char *name, const char *path, const persist_expect_t *expect, gs232_persist_t *persist) {
+    bool restored;
+    gs232_t *ctx;
+
+    if (gs232_init(&ctx) != GS232_OK || gs232_persist_open(persist, &ctx, path, false, &restored) != GS232_OK) {
+        fail(name, "open", GS232_OK, GS232_FAIL);
+        return;
+    }
+
+    if (restored != expect->restored)
+        fail(name, "restored", expect->restored, restored);
+    if (ctx->is_450_degrees != expect->is_450_degrees)
+        fail(name, "450 degrees", expect->is_450_degrees, ctx->is_450_degrees);
+    if (ctx->rotation_speed != expect->rotation_speed)
+        fail(name, "rotation speed", expect->rotation_speed, ctx->rotation_speed);
+    if (ctx->memory_qty != expect->qty)
+        fail(name, "memory_qty", expect->qty, ctx->memory_qty);
+    if (gs232_track_running(ctx) != expect->running)
+        fail(name, "track running", expect->running, gs232_track_running(ctx));
+    if (ctx->memory_current_point != expect->current_point)
+        fail(name, "executed points", expect->current_point, ctx->memory_current_point);
+
+    gs232_persist_close(persist);
+    gs232_deinit(&ctx);
+}
+
+int main(void) {
+    static char frame[4 * (MEMORY_POINTS + 1) + 2];
+    static uint16_t values[MEMORY_POINTS + 1];
+    static const char non_digits[] = { '/', ':', 'a', ' ' };
+    static const uint16_t counts[] = { MEMORY_POINTS - 1, MEMORY_POINTS, MEMORY_POINTS + 1 };
+    uint32_t checks = 0, len;
+
+    for (uint32_t n = 0; n < sizeof(cases) / sizeof(cases[0]); n++, checks++)
+        check(cases[n].prepare, cases[n].frame, strlen(cases[n].frame), cases[n].is_450_degrees, cases[n].command, cases[n].error,
+                cases[n].qty, cases[n].values, VALUES_MAX);
+
+    // non-digit on every position of "M001 002 003 004 005\r": paired groups (0 .. 3) and scalar tail (4)
+    for (uint16_t group = 0; group < 5; group++)
+        for (uint16_t position = 0; position < 3; position++)
+            for (uint32_t c = 0; c < sizeof(non_digits); c++, checks++) {
+                len = sprintf(frame, "M001 002 003 004 005\r");
+                frame[1 + 4 * group + position] = non_digits[c];
+                for (uint16_t n = 0; n < group; n++)
+                    values[n] = n + 1;
+                check(NULL, frame, len, false, UNKNOWN, GS232_FAIL, group, values, group);
+            }
+
+    // values up to memory size: "M001 000 000 ...\r"
+    memset(values, 0, sizeof(values));
+    values[0] = 1;
+    for (uint32_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++, checks++) {
+        len = sprintf(frame, "M001");
+        for (uint16_t n = 1; n < counts[c]; n++)
+            len += sprintf(frame + len, " 000");
+        len += sprintf(frame + len, "\r");
+
+        if (counts[c] <= MEMORY_POINTS)
+            check(NULL, frame, len, false, M_TRACK, GS232_OK, counts[c], values, counts[c]);
+        else
+            check(NULL, frame, len, false, UNKNOWN, GS232_TOOMANYVALUES, MEMORY_POINTS, values, MEMORY_POINTS);
+    }
+
+    // binary: garbage before sync and between frames
+    {
+        static const uint16_t turn[] = { 100 }, turn_2[] = { 123, 45 };
+        static const uint8_t replies[] = { M_TURN, W_TURN };
+
+        len = sprintf(frame, "xyz\r");
+        len += binary_frame(frame + len, M_TURN, turn, 1);
+        len += sprintf(frame + len, "M1\r");
+        len += binary_frame(frame + len, W_TURN, turn_2, 2);
+        binary_check("binary: garbage before sync", frame, len, replies, 2, turn_2, 2);
+        checks++;
+    }
+
+    // binary: overlong frame (sync bytes on its values) is dropped, next frame is parsed
+    {
+        static const uint16_t turn[] = { 200 };
+        static const uint8_t replies[] = { GS232_TOOMANYVALUES, M_TURN };
+
+        len = binary_frame(frame, M_TRACK, values, 0);
+        frame[2] = (MEMORY_POINTS + 1) & 0xff;
+        frame[3] = (MEMORY_POINTS + 1) >> 8;
+        memset(frame + len, GS232_BINARY_SYNC, 2 * (MEMORY_POINTS + 1));
+        len += 2 * (MEMORY_POINTS + 1);
+        len += binary_frame(frame + len, M_TURN, turn, 1);
+        binary_check("binary: overlong frame", frame, len, replies, 2, turn, 1);
+        checks++;
+    }
+
+    // persist: state file of a running timed track (library clock is fake, restart uses wall clock elapsed time)
+    {
+        static const persist_expect_t resumed = { true, true, 2, 7, true, 1 };
+        static const persist_expect_t older = { true, true, 1, 7, true, 0 };
+        static const persist_expect_t empty = { false, false, 1, 0, false, 0 };
+        static const persist_expect_t ended = { true, false, 3, 3, false, 2 };
+        char path[] = "/tmp/gs232_values_XXXXXX";
+        gs232_persist_t persist;
+        uint8_t newest, older_slot;
+        uint64_t next;
+        bool restored;
+        gs232_t *ctx;
+        int fd;
+
+        if ((fd = mkstemp(path)) < 0 || gs232_init(&ctx) != GS232_OK || gs232_persist_open(&persist, &ctx, path, false, &restored) != GS232_OK) {
+            fail("persist", "open", GS232_OK, GS232_FAIL);
+            return 1;
+        }
+        close(fd);
+        gs232_set_clock(persist_clock);
+
+        // every command is saved on the other slot: track start (older), first point executed and speed (newest)
+        ctx->b_protocol = true;
+        persist_parse(&ctx, "P45\r");
+        persist_parse(&ctx, "W001 010 005 020 010 030 015\r");
+        persist_parse(&ctx, "T\r");
+        older_slot = persist.slot;
+        gs232_track_tick(&ctx, persist_now, &next);
+        persist_parse(&ctx, "X2\r");
+        newest = persist.slot;
+        gs232_persist_close(&persist);
+        gs232_deinit(&ctx);
+
+        persist_check("persist: running track", path, &resumed, &persist);
+        persist_corrupt(path, &persist, newest, false);
+        persist_check("persist: bad checksum", path, &older, &persist);
+        persist_corrupt(path, &persist, older_slot, true);
+        persist_check("persist: lost slots", path, &empty, &persist);
+
+        // track ended while stopped: all points executed
+        gs232_init(&ctx);
+        gs232_persist_open(&persist, &ctx, path, false, &restored);
+        persist_parse(&ctx, "M002 010 020\r");
+        persist_parse(&ctx, "T\r");
+        persist_now += 100 * 1000000000ULL;
+        persist_parse(&ctx, "X3\r");
+        gs232_persist_close(&persist);
+        gs232_deinit(&ctx);
+        persist_check("persist: ended track", path, &ended, &persist);
+
+        gs232_set_clock(NULL);
+        unlink(path);
+        checks += 4;
+    }
+
+    printf("values: %u checks, %u failures\n", checks, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -1,3 +1,5 @@
 #!/bin/bash
 
-valgrind --leak-check=full --show-leak-kinds=all --track-origins=yes --verbose  Release/libGS232 -g function-within-function-bugfix.tb
+BUILD_DIR=${1:-build}
+
+valgrind --leak-check=full --show-leak-kinds=all --track-origins=yes --verbose ${BUILD_DIR}/gs232_bench -t 0.001